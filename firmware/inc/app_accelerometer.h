@@ -5,11 +5,42 @@
 #pragma once
 
 #include "app_common.h"
+#include "bma400_defs.h"
+#include "app_callbacks.h"
 
-#define ACCELEROMETER_N_SAMPLES   18  // for some reason this results in 16 valid samples
+#define ACCELEROMETER_N_SAMPLES   18  // default burst length
+#define ACCELEROMETER_FIFO_BYTES  1024
+#define ACCELEROMETER_MAX_SAMPLES (ACCELEROMETER_FIFO_BYTES / 4)       // 8 bit XYZ frame = header + 3 * 8 bit
+
+// accelerometer_fetch_data() reads the FIFO straight into the caller's
+// buffer: up to ACCELEROMETER_FETCH_LEN bytes, plus ACCELEROMETER_FETCH_HEADROOM
+// bytes in front of it that take the SPI framing and are restored
+#define ACCELEROMETER_FETCH_LEN      (ACCELEROMETER_FIFO_BYTES + BMA400_FIFO_BYTES_OVERREAD)
+#define ACCELEROMETER_FETCH_HEADROOM 12   // register byte, dummy byte, SENSOR_TIME0 .. FIFO_LENGTH1
+
+// BMA400 sensor time: 24 bit counter, 39.0625 us per tick. samples are taken
+// on the sensor time grid, one every accelerometer_odr_ticks(odr) ticks
+#define ACCELEROMETER_TICK_HZ        25600
+#define ACCELEROMETER_TICK_MASK      0xFFFFFF
+
+// sample format in the FIFO and in the payload
+typedef enum {
+    ACCELEROMETER_FORMAT_12_BIT,    // int16 x, y, z little-endian -- 12 bit significant, 1.95 mg/LSB at 4g
+    ACCELEROMETER_FORMAT_8_BIT,     // int8 x, y, z -- the 8 MSBs, 31.25 mg/LSB at 4g
+} accelerometer_format_t;
 
 int accelerometer_init(void);
+void accelerometer_set_rate(uint8_t odr, uint16_t burst_samples);
+void accelerometer_set_format(accelerometer_format_t format);
+accelerometer_format_t accelerometer_get_format(void);
+uint8_t accelerometer_sample_size(accelerometer_format_t format);
+uint16_t accelerometer_max_samples(accelerometer_format_t format);
 void accelerometer_wake(bool init_spi, bool deinit_spi);
 void accelerometer_sleep(bool init_spi, bool deinit_spi);
-uint16_t accelerometer_fetch_data(bool init_spi, bool deinit_spi, bool sleep);
-void accelerometer_copy_data(uint8_t *data_ptr, uint16_t data_len);
+uint16_t accelerometer_fetch_data(uint8_t *data_ptr, uint16_t max_len, bool init_spi, bool deinit_spi, bool sleep,
+                                  callback_t fetch_done);
+uint16_t accelerometer_fetch_len(void);
+uint32_t accelerometer_fetch_time(void);
+uint8_t accelerometer_fetch_odr(void);
+uint16_t accelerometer_odr_ticks(uint8_t odr);
+uint16_t accelerometer_pack_fifo(uint8_t *data_ptr, uint16_t fifo_len, accelerometer_format_t format);
@@ -10,4 +10,5 @@ void ble_all_services_init(void);
 void advertising_start(bool erase_bonds);
 void advertising_stop(void);
 ret_code_t ble_send(uint8_t *data, uint16_t length);
+uint16_t ble_get_max_data_len(void);
 void ble_disconnect(bool stop_advertising);
@@ -20,5 +20,16 @@
 #define CALLBACK_FUNC(name) \
         callback_##name
 
+// callbacks that hand over event data: it is copied into the scheduler queue,
+// so every event is handled with its own data
+#define WEAK_CALLBACK_DATA_DEF(name) \
+        __WEAK void callback_##name(void const *p_data, uint16_t len) { return; }
+#define CALLBACK_DATA_DEF_APP_SCHED(name, p_data, len) \
+        static void app_sched_callback_##name(void *p_data, uint16_t len); \
+        void callback_##name(void const *_p_data, uint16_t _len) { \
+            app_sched_event_put(_p_data, _len, app_sched_callback_##name); \
+        } \
+        static void app_sched_callback_##name(void *p_data, uint16_t len)
+
 typedef void (* callback_t)(void);
 
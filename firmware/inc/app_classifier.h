@@ -0,0 +1,83 @@
+/**
+ * on-device activity classifier, sent in place of the features
+ * (FRAME_FORMAT_ACTIVITY)
+ *
+ * every app_features.h window is classified by a decision tree on integer
+ * inputs derived from its features. rates and frequencies are scaled by the
+ * window's duration, so one model serves every window length and ODR:
+ *
+ *   mean             per axis, LSB
+ *   variance         per axis and summed over the axes, LSB^2
+ *   zero crossings   per axis, per 10 s
+ *   dominant freq.   per axis, dominant bin * ODR / n in 0.01 Hz
+ *
+ * the tree is a table in preorder: an inner node sends inputs at or below
+ * its threshold to the next node and the others to node `right`, a leaf
+ * holds the activity in `threshold`. the table in app_classifier_model.c is
+ * generated by the host simulator (keh_sim --train), do not edit it by hand.
+ *
+ * an activity record is ACTIVITY_LEN bytes: the window length n, the
+ * ACTIVITY_* the windows from the record on are classified as, and the
+ * windows classified since the previous record (saturating). records are
+ * sent when the activity changes, ACTIVITY_DEBOUNCE windows in a row, and as
+ * a keep-alive every ACTIVITY_KEEPALIVE windows otherwise. the window a
+ * record's mark points at is classified as the record's activity: the first
+ * window of the new activity, or the keep-alive's own window.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_features.h"
+
+#define ACTIVITY_DESK           0
+#define ACTIVITY_WALKING        1
+#define ACTIVITY_RUNNING        2
+#define ACTIVITY_COUNT          3
+#define ACTIVITY_UNKNOWN        0xFF    // before the first record
+
+#define ACTIVITY_LEN            3
+#define ACTIVITY_DEBOUNCE       2       // windows in a row before a change is sent
+#define ACTIVITY_KEEPALIVE      16      // windows between records of an unchanged activity
+
+#define CLASSIFIER_TICK_HZ      25600   // BMA400 sensor time, see accelerometer_odr_ticks()
+#define CLASSIFIER_LEAF         0xFF    // node input of a leaf
+
+typedef enum {
+    CLASSIFIER_IN_MEAN_X,
+    CLASSIFIER_IN_MEAN_Y,
+    CLASSIFIER_IN_MEAN_Z,
+    CLASSIFIER_IN_VAR_X,
+    CLASSIFIER_IN_VAR_Y,
+    CLASSIFIER_IN_VAR_Z,
+    CLASSIFIER_IN_VAR_SUM,
+    CLASSIFIER_IN_ZC_X,
+    CLASSIFIER_IN_ZC_Y,
+    CLASSIFIER_IN_ZC_Z,
+    CLASSIFIER_IN_FREQ_X,
+    CLASSIFIER_IN_FREQ_Y,
+    CLASSIFIER_IN_FREQ_Z,
+    CLASSIFIER_INPUTS
+} classifier_input_t;
+
+typedef struct {
+    uint8_t window;             // samples
+    uint8_t activity;           // ACTIVITY_*
+    uint8_t windows;            // classified since the previous record, up to 255
+} activity_record_t;
+
+typedef struct {
+    uint8_t input;              // CLASSIFIER_IN_*, CLASSIFIER_LEAF
+    uint8_t right;              // node for inputs above the threshold
+    int32_t threshold;          // ACTIVITY_* for a leaf
+} classifier_node_t;
+
+extern const classifier_node_t classifier_model[];
+extern const uint8_t classifier_model_len;
+
+void classifier_inputs(features_t const *p_features, uint16_t odr_ticks, int32_t *p_inputs);
+uint8_t classifier_predict(int32_t const *p_inputs);
+uint8_t classifier_run(features_t const *p_features, uint16_t odr_ticks);
+void activity_encode(activity_record_t const *p_record, uint8_t *p_buf);
+bool activity_decode(uint8_t const *p_buf, activity_record_t *p_record);
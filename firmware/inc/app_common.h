@@ -17,13 +17,16 @@
 // config
 #define V_STORE_DIV_INV         3           // v_store_div = v_store / V_STORE_DIV_INV
 #define V_STORE_SAMP_PERIOD_MS  100
+#define V_STORE_LPCOMP_ENABLED  1           // wait for v_store on LPCOMP crossings instead of polling it (app_voltage.h)
+#define V_STORE_SAMP_RING_ENABLED 1         // sample on RTC1 compare events through PPI, CPU woken per ring (app_voltage.h)
 
-// voltage thresholds. resolution is ~21mV
+// voltage thresholds. resolution is ~1.3mV (app_voltage.h)
 #define V_STORE_LVL_BLE_INIT    2200        // run BLE init once storage cap is at 2.2V = 242uJ
 #define V_STORE_LVL_SAMPLE      1800        // sample + send once storage cap is at 1.8V = 162uJ
 
 // GPIO config
 #define GPIO_V_STORE_DIV_IN     NRF_SAADC_INPUT_AIN2    // capacitor voltage -- this is on P.04/AIN2 (which expands to 3...)
+#define GPIO_V_STORE_LPCOMP_IN  NRF_LPCOMP_INPUT_2     // the same pin as LPCOMP input
 #define GPIO_DIV_EN             5           // enable capacitor voltage divider
 
 #define SPI_SCK                 9
@@ -41,6 +44,12 @@
 // BLE config
 #define DEVICE_NAME_DEFAULT     "test"      // device name in BLE advertising
 #define ENABLE_DEVICE_NAME      1           // enable device name in advertising
+#define BLE_HVN_TX_QUEUE_SIZE   4           // notifications queued in the SoftDevice -- sent back to back in one connection event
+#define BLE_RX_DATA_MAX_LEN     20          // longest command written by the central
+
+// commands written by the central to the NUS RX characteristic: opcode, argument
+#define BLE_CMD_SET_FORMAT      0x01        // FRAME_FORMAT_*, applied from the next burst
+#define BLE_CMD_SET_WINDOW      0x02        // feature window in samples, a power of two (app_features.h)
 
 #define APP_ADV_INTERVAL        MSEC_TO_UNITS(20, UNIT_0_625_MS)    // advertising interval (in units of 0.625 ms)
 #define APP_ADV_DURATION        MSEC_TO_UNITS(200, UNIT_10_MS)      // advertising duration (in units of 10 milliseconds)
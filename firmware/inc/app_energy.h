@@ -0,0 +1,64 @@
+/**
+ * energy-aware sampling scheduler
+ */
+
+#pragma once
+
+#include "app_common.h"
+
+// storage capacitor -- 2.2V = 242uJ, see V_STORE_LVL_BLE_INIT
+#define ENERGY_CAP_UF               100
+#define ENERGY_V_STORE_MAX_MV       5000        // highest threshold we ask for
+#define ENERGY_V_STORE_CLAMP_MV     5200        // LTC3109 clamps at 5.25V -- the harvest is not observable
+
+// measured costs, see README power table
+#define ENERGY_BLE_INIT_UJ          620         // stack init, advertising, connection setup
+#define ENERGY_BLE_INIT_MS          1000        // time the central takes to connect and subscribe
+#define ENERGY_BURST_FIXED_UJ       2           // SPI session + wake-ups, independent of burst size
+#define ENERGY_BURST_SAMPLE_NJ      750         // per sample in a burst, independent of the format
+#define ENERGY_FIFO_BYTE_NJ         3           // SPI at 8 MHz (APP_SPI_FREQ_FIFO), per FIFO byte read
+#define ENERGY_PAYLOAD_BYTE_NJ      80          // radio on-air time per payload byte
+#define ENERGY_BLE_EVENT_UJ         64          // connection event carrying data: HFXO, radio ramp-up
+#define ENERGY_BLE_PACKET_UJ        15          // per notification in that event
+#define ENERGY_BLE_PACKET_US        2500        // air time of a full notification + empty ack at 1M PHY
+#define ENERGY_ACCEL_NW             6300        // BMA400 normal mode on top of sleep current
+#if V_STORE_SAMP_RING_ENABLED
+#define ENERGY_ADC_SAMPLE_NJ        380         // conversion + a third of the wake-up collecting the ring
+#else
+#define ENERGY_ADC_SAMPLE_NJ        880         // conversion + timer and done wake-ups
+#endif
+#define ENERGY_ADC_OVERSAMPLE_NJ    15          // per further conversion averaged into a sample
+#define ENERGY_IDLE_NW              8600        // 9.2uW measured, less the divider (then always on) at ~3V
+#define ENERGY_LPCOMP_NW            1200        // 0.5uA while watching v_store (datasheet)
+
+// harvest estimate
+#define ENERGY_TAU_MS               2000        // averaging time constant of the power estimate
+#define ENERGY_HARVEST_MARGIN_PCT   80          // plan with this share of the estimate
+
+// v_store poll period bounds
+#define ENERGY_POLL_MIN_MS          V_STORE_SAMP_PERIOD_MS
+#define ENERGY_POLL_MAX_MS          30000       // v_store not expected to reach the level
+#define ENERGY_POLL_UNSETTLED_MS    1000        // until the harvest estimate has settled
+#define ENERGY_POLL_WAKE_MS         5000        // backstop while the LPCOMP watches v_store
+#define ENERGY_WAKE_MARGIN_MV       50          // LPCOMP level above the last sample, so the crossing is ahead
+
+typedef struct {
+    uint8_t odr;                // BMA400_ODR_*
+    uint16_t burst_samples;     // samples per burst, a multiple of one notification
+    uint16_t poll_ms;           // v_store sample period
+    int32_t wake_mv;            // LPCOMP level v_store is waited for, 0 while polling
+} energy_plan_t;
+
+void energy_update(int32_t v_store_uv);
+void energy_note_spend(uint32_t energy_uj);
+void energy_note_burst_start(void);
+void energy_note_burst(uint16_t n_samples);
+void energy_note_payload(uint16_t n_samples, uint16_t n_bytes);
+void energy_note_notifications(uint8_t n_packets);
+void energy_note_backlog(uint16_t n_samples);
+void energy_set_window(uint16_t n_samples);
+bool energy_burst_ready(void);
+energy_plan_t const *energy_get_plan(void);
+int32_t energy_get_harvest_uw(void);
+int32_t energy_ble_init_thresh_mv(void);
+void energy_wait_for_ble_init(void);
@@ -0,0 +1,54 @@
+/**
+ * windowed activity recognition features, sent in place of the samples
+ * (FRAME_FORMAT_FEATURES)
+ *
+ * a window of n 12 bit samples, n a power of two from FEATURES_WINDOW_MIN to
+ * FEATURES_WINDOW_MAX, is reduced per axis to the values below. integer
+ * arithmetic only, so a receiver recomputing them from the samples gets the
+ * same bits:
+ *
+ *   mean             sum / n, truncated toward zero
+ *   variance         (n * sum(x^2) - sum^2) / n^2, truncated
+ *   energy           sum(x^2) / n, truncated
+ *   zero crossings   sign changes of n * x - sum (around the exact mean),
+ *                    samples on the mean keep the previous sign
+ *   dominant bin     the k in 1 .. n/2 with the largest re^2 + im^2, where
+ *                    re, im = sum of (x - mean) * cos, sin(2 pi k i / n), the
+ *                    table values round(4096 * sin(2 pi j / 128)). the first
+ *                    of equal ones, 0 if the window is flat. the frequency is
+ *                    k * ODR / n
+ *
+ * a record is FEATURES_LEN bytes: the window length n, then for x, y, z the
+ * mean (int16), variance and energy (uint24, LSB^2) little-endian, the zero
+ * crossings and the dominant bin. the DFT is done directly, n^2 / 2
+ * multiply-adds per axis on 32 bit sums -- 12 bit values keep them in range.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FEATURES_WINDOW_MIN     16
+#define FEATURES_WINDOW_MAX     128     // fits the 12 bit FIFO
+#define FEATURES_WINDOW_DEFAULT 64      // 2.56 s at 25 Hz
+#define FEATURES_AXIS_LEN       10
+#define FEATURES_LEN            (1 + 3 * FEATURES_AXIS_LEN)
+
+typedef struct {
+    int16_t mean;               // LSB
+    uint32_t variance;          // LSB^2
+    uint32_t energy;            // LSB^2
+    uint8_t zero_crossings;
+    uint8_t dominant_bin;
+} features_axis_t;
+
+typedef struct {
+    uint8_t window;             // samples
+    features_axis_t axis[3];
+} features_t;
+
+bool features_window_valid(uint16_t n_samples);
+void features_compute(uint8_t const *p_raw, uint8_t n_samples, features_t *p_features);
+void features_encode(features_t const *p_features, uint8_t *p_buf);
+bool features_decode(uint8_t const *p_buf, features_t *p_features);
@@ -0,0 +1,102 @@
+/**
+ * notification payload framing, shared by the firmware and host receivers
+ *
+ * every notification is one frame: a fixed header, up to FRAME_MARKS_MAX
+ * time marks, then n_samples samples in the frame's format.
+ *
+ *   byte 0     version (high nibble) | flags (low nibble)
+ *   byte 1     sequence number, +1 per notification, wraps
+ *   byte 2     format (high nibble) | number of time marks (low nibble)
+ *   byte 3     number of samples
+ *   marks      5 bytes each: sample index, BMA400_ODR_*, 24 bit sensor time LE
+ *   samples    frame_sample_len(format) bytes each, or a Rice coded bit
+ *              stream filling the rest of the frame (FRAME_FORMAT_12_BIT_RICE)
+ *
+ * FRAME_FORMAT_FEATURES frames carry app_features.h records instead of
+ * samples: the sample count counts records, a mark gives the sensor time of
+ * a record's first sample, and a record without a mark starts right after
+ * the previous record's window.
+ *
+ * FRAME_FORMAT_ACTIVITY frames carry app_classifier.h records, one mark each:
+ * the sensor time of the first window the record's activity holds for.
+ *
+ * a time mark puts a burst's first sample on the sensor time line, samples
+ * without a mark continue one sample period after the previous one. receivers
+ * reject frames of another version; flags they do not know are ignored.
+ *
+ * FRAME_FORMAT_12_BIT_RICE codes the 12 bit samples losslessly, MSB first:
+ * the first sample as three 12 bit two's complement values, then per axis the
+ * difference to the previous sample, zig-zag mapped (0, -1, 1, -2, ... to
+ * 0, 1, 2, 3, ...) and Rice coded: u >> k in unary (ones, then a zero), then
+ * the k low bits. k adapts per axis like in JPEG-LS: the smallest k with
+ * n << k >= a, where a sums the coded values (starting at FRAME_RICE_A_INIT)
+ * and n counts them (starting at 1), both halved when n reaches
+ * FRAME_RICE_N_RESET. a value with u >> k >= FRAME_RICE_ESCAPE is sent as
+ * FRAME_RICE_ESCAPE ones and 13 plain bits instead. the last byte is padded
+ * with zeros. every frame starts afresh, so a lost frame costs nothing else.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FRAME_VERSION           1
+#define FRAME_HEADER_LEN        4
+#define FRAME_MARK_LEN          5
+#define FRAME_MARKS_MAX         3
+#define FRAME_HEADER_MAX_LEN    (FRAME_HEADER_LEN + FRAME_MARKS_MAX * FRAME_MARK_LEN)
+#define FRAME_SAMPLES_MAX       255
+
+// sample formats. the raw ones take the values of accelerometer_format_t
+#define FRAME_FORMAT_12_BIT     0       // int16 x, y, z little-endian
+#define FRAME_FORMAT_8_BIT      1       // int8 x, y, z
+#define FRAME_FORMAT_12_BIT_RICE 2      // 12 bit x, y, z, delta + Rice coded
+#define FRAME_FORMAT_FEATURES   3       // one app_features.h record per window
+#define FRAME_FORMAT_ACTIVITY   4       // app_classifier.h records, on changes and keep-alives
+
+#define FRAME_RICE_A_INIT       16
+#define FRAME_RICE_N_RESET      32
+#define FRAME_RICE_ESCAPE       16
+
+// samples were discarded in front of this frame (power-on, format switch,
+// dropped backlog): the timeline restarts at the frame's first mark even if
+// no sequence number is missing
+#define FRAME_FLAG_RESYNC       0x01
+
+typedef struct {
+    uint8_t index;              // sample in the frame
+    uint8_t odr;                // BMA400_ODR_*
+    uint32_t time;              // 24 bit sensor time of that sample
+} frame_mark_t;
+
+typedef struct {
+    uint8_t seq;
+    uint8_t flags;              // FRAME_FLAG_*
+    uint8_t format;             // FRAME_FORMAT_*
+    uint8_t n_samples;
+    uint8_t n_marks;
+    frame_mark_t marks[FRAME_MARKS_MAX];    // increasing index
+    uint8_t const *p_samples;   // decode: points into the payload
+    uint16_t data_len;          // bytes at p_samples
+} frame_t;
+
+typedef enum {
+    FRAME_OK,
+    FRAME_ERR_SHORT,            // shorter than the header and its marks
+    FRAME_ERR_VERSION,
+    FRAME_ERR_FORMAT,
+    FRAME_ERR_LENGTH,           // sample bytes do not match the sample count
+    FRAME_ERR_MARK,             // mark count, index order or range, activity record without one
+    FRAME_ERR_CODE,             // Rice coded samples do not decode
+} frame_result_t;
+
+uint8_t frame_sample_len(uint8_t format);
+uint16_t frame_header_len(uint8_t n_marks);
+uint16_t frame_write_header(frame_t const *p_frame, uint8_t *p_buf);
+uint16_t frame_encode(frame_t const *p_frame, uint8_t *p_buf, uint16_t size);
+frame_result_t frame_decode(uint8_t const *p_buf, uint16_t len, frame_t *p_frame);
+frame_result_t frame_samples(frame_t const *p_frame, int16_t *p_xyz);
+uint8_t frame_rice_encode(uint8_t const *p_raw, uint8_t n_raw, uint8_t *p_out, uint16_t out_len,
+                          uint16_t *p_data_len);
+int16_t frame_seq_gap(uint8_t last_seq, uint8_t seq);
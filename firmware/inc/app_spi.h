@@ -6,10 +6,24 @@
 
 #include "app_common.h"
 #include "app_callbacks.h"
+#include "nrf_spim.h"
 
-#define APP_SPI_MAX_TRANSFER_LEN        256
+#define APP_SPI_MAX_TRANSFER_LEN        256     // register access through the driver's buffers
+// longest single EasyDMA transfer: MAXCNT is 15 bit on the nRF52811, so a
+// direct read drains the whole 1 KB FIFO in one go
+#define APP_SPI_MAX_DMA_LEN             ((1UL << SPIM1_EASYDMA_MAXCNT_SIZE) - 1)
+
+// SPI clock per kind of traffic. the BMA400 takes up to 10 MHz, the SPIM
+// tops out at 8 MHz; HFCLK stays on for as long as the bytes take to clock.
+#define APP_SPI_FREQ_REG                NRF_SPIM_FREQ_4M    // register access, default after init
+#define APP_SPI_FREQ_FIFO               NRF_SPIM_FREQ_8M    // FIFO bulk reads
 
 void app_spi_init(void);
 void app_spi_deinit(void);
+void app_spi_session_begin(void);
+void app_spi_session_end(void);
+void app_spi_set_frequency(nrf_spim_frequency_t frequency);
 int app_spi_readwrite(uint8_t *tx, uint8_t *rx, uint8_t len, callback_t xfer_done);
 int app_spi_readwrite_reg(uint8_t reg, uint8_t *tx, uint8_t *rx, uint8_t len, callback_t xfer_done);
+int app_spi_read_reg_direct(uint8_t reg, uint8_t *rx, uint16_t len, callback_t xfer_done);
+int app_spi_write_regs(uint8_t const *pairs, uint8_t n_pairs, callback_t xfer_done);
@@ -0,0 +1,26 @@
+/**
+ * sample stream: the buffered samples and the notifications made from them
+ */
+
+#pragma once
+
+#include "app_common.h"
+#include "app_callbacks.h"
+#include "app_accelerometer.h"
+#include "app_frame.h"
+#include "sdk_config.h"
+
+// send buffer: a FIFO read straight into it behind the samples carried over,
+// with headroom in front for the SPI framing and the frame header. a Rice
+// coded notification is only sent once the samples overfill it, so up to
+// FRAME_SAMPLES_MAX 12 bit samples are carried over, otherwise less than one
+// notification
+#define STREAM_CARRY_LEN        MAX(NRF_SDH_BLE_GATT_MAX_MTU_SIZE, FRAME_SAMPLES_MAX * 6)
+#define STREAM_SEND_BUF_LEN     (ACCELEROMETER_FETCH_LEN + STREAM_CARRY_LEN)
+#define STREAM_SEND_HEADROOM    MAX(ACCELEROMETER_FETCH_HEADROOM, FRAME_HEADER_MAX_LEN)
+
+void stream_set_format(uint8_t format);
+void stream_set_window(uint8_t n_samples);
+void stream_fetch_start(callback_t fetch_done);
+uint16_t stream_fetch_done(void);
+uint8_t stream_send(void);
@@ -1,5 +1,45 @@
 /**
  * measure capacitor storage voltage
+ *
+ * v_store is sampled by the SAADC on a timer. with V_STORE_SAMP_RING_ENABLED
+ * the RTC1 compare channels app_timer leaves free (CC1-CC3) trigger the
+ * samples through PPI instead, into a ring of VOLTAGE_RING_SAMPLES that the
+ * SAADC fills without the CPU: it only wakes once per ring to re-arm the
+ * compares, instead of twice per sample. the nRF52811 has no spare RTC to
+ * repeat a compare on its own, so one ring is as many samples as there are
+ * free channels. a sample reaching the level set with voltage_report_above()
+ * raises the SAADC's LIMIT event and is reported at once, read from the
+ * part of the ring filled so far. the SAADC stays initialized, in normal mode
+ * (low power mode would wait for a START from the CPU before each sample).
+ *
+ * the sample period counts from the last sample reported, so setting it
+ * after a sample sets when the next one comes. voltage_request_sample()
+ * brings the next sample forward when the schedule would deliver it too
+ * late, voltage_force_sample() also waits for it.
+ *
+ * samples are 12 bit and average 4 conversions by default (one SAMPLE task
+ * runs them all in burst mode), ~1.3mV of v_store per LSB. the SAADC
+ * calibrates its offset once at init, and the offset left over is read off
+ * the divider output while that is still switched off and discharged, kept
+ * in RAM and taken off every sample. there is no reference on the board to
+ * calibrate the gain against: VDD is the LTC3109's output, and the divider
+ * resistors' tolerance dominates anyway.
+ *
+ * while v_store only has to rise past a level, the LPCOMP can watch it
+ * instead and trigger a sample when it gets there (voltage_wake_above()). the
+ * LPCOMP compares the divided v_store with a fraction of VDD, and VDD is the
+ * LTC3109's VOUT: regulated at VOLTAGE_LPCOMP_VDD_MV, and following v_store
+ * below that. v_store / 3 then stays under 6/16 VDD, so the usable levels are
+ * 6/16 to 11/16 of the regulated VDD, ~2.64V to ~4.85V in ~440mV steps --
+ * 12/16 lies above the LTC3109 clamp.
+ *
+ * the divider leaks v_store through 15M while it is on, as much as the rest
+ * of the device on a full capacitor. it is switched on only around each
+ * sample, VOLTAGE_DIV_SETTLE_US ahead of it, once samples are far enough
+ * apart (VOLTAGE_DIV_GATE_MIN_MS) for that to pay: C20 charges through the
+ * divider for (resolution + 1) ln 2 time constants of R1 || R2, ~300ms at
+ * 12 bit. it stays on while samples come quicker and while the LPCOMP
+ * watches it.
  */
 
 #pragma once
@@ -9,8 +49,41 @@
 #define VOLTAGE_SAADC_REF_MV        600
 #define VOLTAGE_SAADC_GAIN_INVERSE  3
 #define VOLTAGE_SAADC_GAIN          CONCAT_2(NRF_SAADC_GAIN1_, VOLTAGE_SAADC_GAIN_INVERSE)
-#define VOLTAGE_SAADC_ACQ_TIME      NRF_SAADC_ACQTIME_3US
-#define VOLTAGE_SAADC_RESOLUTION    8
+#define VOLTAGE_SAADC_ACQ_US        3
+#define VOLTAGE_SAADC_ACQ_TIME      CONCAT_3(NRF_SAADC_ACQTIME_, VOLTAGE_SAADC_ACQ_US, US)
+#define VOLTAGE_SAADC_RESOLUTION    12          // 8, 10 or 12 bit
+#define VOLTAGE_SAADC_OVERSAMPLE    2           // log2 of the conversions averaged into a sample, 0 for none
+#define VOLTAGE_SAADC_OFFSET_MAX    ((1 << VOLTAGE_SAADC_RESOLUTION) / 64)  // plausible offset on the discharged divider
+
+// v_store divider R1 / R2, C20 on its output
+#define VOLTAGE_DIV_R_TOP_KOHM      10000
+#define VOLTAGE_DIV_R_BOTTOM_KOHM   5000
+#define VOLTAGE_DIV_C_NF            10
+// switched on, C20 charges through R1 || R2 and has to come within half an
+// LSB, ln(2^(resolution + 1)) time constants, before the acquisition starts
+#define VOLTAGE_DIV_TAU_US          (VOLTAGE_DIV_R_TOP_KOHM * VOLTAGE_DIV_R_BOTTOM_KOHM \
+                                     / (VOLTAGE_DIV_R_TOP_KOHM + VOLTAGE_DIV_R_BOTTOM_KOHM) * VOLTAGE_DIV_C_NF)
+#define VOLTAGE_DIV_SETTLE_US       (VOLTAGE_DIV_TAU_US * (VOLTAGE_SAADC_RESOLUTION + 1) * 693 / 1000 \
+                                     + VOLTAGE_SAADC_ACQ_US)
+
+#if V_STORE_SAMP_RING_ENABLED
+#define VOLTAGE_RING_SAMPLES        3           // samples per wake-up, one per free RTC1 compare channel
+#define VOLTAGE_RING_CC_FIRST       1           // CC0 is app_timer's
+#else
+#define VOLTAGE_RING_SAMPLES        1
+#endif
+
+// shortest sample period the divider is switched off in between: a gated
+// sample costs the leakage while settling plus the wake-up switching it on
+#if V_STORE_SAMP_RING_ENABLED
+#define VOLTAGE_DIV_GATE_MIN_MS     2000        // and it fills a whole ring, 3 conversions
+#else
+#define VOLTAGE_DIV_GATE_MIN_MS     1000
+#endif
+
+#define VOLTAGE_LPCOMP_VDD_MV       2350        // LTC3109 VOUT setting
+#define VOLTAGE_LPCOMP_MIN_16THS    6           // lowest reference v_store / 3 can reach, in 1/16 VDD
+#define VOLTAGE_LPCOMP_MAX_16THS    11
 
 typedef enum {
     VOLTAGE_RET_PREV_SAMPLE = 0,
@@ -19,7 +92,15 @@ typedef enum {
 } voltage_ret_t;
 
 void voltage_init(void);
+void voltage_set_sample_period(uint32_t period_ms);
+voltage_ret_t voltage_request_sample(uint32_t staleness_ticks, uint32_t wait_ticks);
 voltage_ret_t voltage_force_sample(uint32_t staleness_ticks, uint32_t wait_ticks, uint32_t *age);
 int32_t voltage_read_v_store(void);
+int32_t voltage_read_v_store_uv(void);
 void voltage_wait_for_v_store_thresh(int32_t thresh_mv);
 uint32_t voltage_get_measurement_age_ticks();
+int32_t voltage_wake_level_mv(int32_t max_mv);
+bool voltage_wake_above(int32_t level_mv);
+void voltage_report_above(int32_t thresh_mv);
+bool voltage_divider_gated(uint32_t period_ms, bool lpcomp);
+void voltage_divider_gating(bool enable);
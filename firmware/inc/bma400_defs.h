@@ -470,6 +470,14 @@
 #define BMA400_FIFO_YZ_ENABLE                     UINT8_C(0x8C)
 #define BMA400_FIFO_XZ_ENABLE                     UINT8_C(0x8A)
 
+/* 12 bit XYZ data frame: header + 3 * (lsb, msb) */
+#define BMA400_FIFO_XYZ_12_BIT_FRAME              UINT8_C(0x9E)
+#define BMA400_FIFO_XYZ_12_BIT_LEN                UINT8_C(7)
+
+/* 8 bit XYZ data frame: header + 3 * msb */
+#define BMA400_FIFO_XYZ_8_BIT_FRAME               UINT8_C(0x8E)
+#define BMA400_FIFO_XYZ_8_BIT_LEN                 UINT8_C(4)
+
 /* BMA400 bit mask definitions */
 #define BMA400_POWER_MODE_STATUS_MSK              UINT8_C(0x06)
 #define BMA400_POWER_MODE_STATUS_POS              UINT8_C(1)
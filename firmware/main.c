@@ -52,8 +52,9 @@
 #include "app_ble_nus.h"
 #include "app_accelerometer.h"
 #include "app_voltage.h"
+#include "app_energy.h"
 
-#define APP_SCHED_EVENT_SIZE    APP_TIMER_SCHED_EVENT_DATA_SIZE
+#define APP_SCHED_EVENT_SIZE    MAX(APP_TIMER_SCHED_EVENT_DATA_SIZE, BLE_RX_DATA_MAX_LEN)
 #define APP_SCHED_QUEUE_SIZE    10
 
 /**@brief Function for assert macro callback.
@@ -128,7 +129,7 @@ int main(void) {
     #else 
 
     debug_log("finished HW init. waiting for enough energy to init BLE."); debug_force_flush();
-    voltage_wait_for_v_store_thresh(V_STORE_LVL_BLE_INIT);
+    energy_wait_for_ble_init();
 
     #endif
     
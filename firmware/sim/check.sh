@@ -0,0 +1,59 @@
+#!/bin/sh
+# regression runs of the simulator: each case runs keh_sim with its options
+# and compares report lines with a value, then --bench has to succeed with
+# every *_match line yes. exits non-zero if any case fails.
+#
+#   check.sh <keh_sim>
+
+SIM=${1:-build/keh_sim}
+failed=0
+
+# <options> ; <report line> <==|<=|>=> <value> ...
+cases='
+                                 ; bma_frames_flushed == 0 ; brownouts == 0
+--format 8                       ; bma_frames_flushed == 0
+--format rice -V 4000            ; bma_frames_flushed == 0
+--format rice -a mixed -d 600    ; bma_frames_flushed == 0 ; brownouts == 0
+--format features -a mixed -d 600; bma_frames_flushed == 0
+--format activity -a mixed -d 600; bma_frames_flushed == 0
+-p 15 -d 3600                    ; brownouts == 0 ; bma_frames_flushed == 0
+-p 20 -d 3600                    ; brownouts == 0 ; bma_frames_flushed == 0
+-p 20 -P -d 1800                 ; brownouts == 0
+'
+
+echo "$cases" | while IFS= read -r line; do
+    [ -z "$(echo "$line" | tr -d ' ')" ] && continue
+    opts=$(echo "${line%%;*}" | sed 's/ *$//')
+    report=$($SIM $opts) || { echo "FAIL [$opts] exit status $?"; exit 1; }
+    echo "${line#*;}" | tr ';' '\n' | while read -r key op value; do
+        [ -z "$key" ] && continue
+        got=$(echo "$report" | awk -v k="$key" '$1 == k { print $2; exit }')
+        if ! awk -v a="$got" -v op="$op" -v b="$value" 'BEGIN {
+                if (a == "") exit 1
+                if (op == "==") exit !(a + 0 == b + 0)
+                if (op == "<=") exit !(a + 0 <= b + 0)
+                if (op == ">=") exit !(a + 0 >= b + 0)
+                exit 1 }'; then
+            echo "FAIL [$opts] $key $got, expected $op $value"
+            exit 1
+        fi
+    done || exit 1
+    echo "ok   [$opts]"
+done || failed=1
+
+# frame codec round trips and fuzzing, Rice, features and pipeline
+# outputs against their references
+if report=$($SIM --bench); then
+    mismatch=$(echo "$report" | awk '$1 ~ /_match$/ && $2 != "yes" { print $1 }')
+    if [ -n "$mismatch" ]; then
+        echo "FAIL [--bench]" $mismatch
+        failed=1
+    else
+        echo "ok   [--bench]"
+    fi
+else
+    echo "FAIL [--bench] exit status $?"
+    failed=1
+fi
+
+exit $failed
@@ -0,0 +1,30 @@
+/**
+ * host simulator -- app_scheduler API
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "app_error.h"
+#include "app_util.h"
+
+#define APP_SCHED_EVENT_HEADER_SIZE 16          // handler pointer + size on a 64-bit host
+
+#define APP_SCHED_BUF_SIZE(EVENT_SIZE, QUEUE_SIZE) \
+        (((EVENT_SIZE) + APP_SCHED_EVENT_HEADER_SIZE) * ((QUEUE_SIZE) + 1))
+
+typedef void (*app_sched_event_handler_t)(void *p_event_data, uint16_t event_size);
+
+#define APP_SCHED_INIT(EVENT_SIZE, QUEUE_SIZE) \
+        do { \
+            static uint32_t APP_SCHED_BUF[CEIL_DIV(APP_SCHED_BUF_SIZE((EVENT_SIZE), (QUEUE_SIZE)), sizeof(uint32_t))]; \
+            uint32_t ERR_CODE = app_sched_init((EVENT_SIZE), (QUEUE_SIZE), APP_SCHED_BUF); \
+            APP_ERROR_CHECK(ERR_CODE); \
+        } while (0)
+
+ret_code_t app_sched_init(uint16_t max_event_size, uint16_t queue_size, void *p_evt_buffer);
+void app_sched_execute(void);
+ret_code_t app_sched_event_put(void const *p_event_data,
+                               uint16_t event_size,
+                               app_sched_event_handler_t handler);
+uint16_t app_sched_queue_space_get(void);
@@ -0,0 +1,24 @@
+/**
+ * host simulator -- subset of app_util.h used by the application
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "compiler_abstraction.h"
+#include "nordic_common.h"
+
+enum {
+    UNIT_0_625_MS = 625,
+    UNIT_1_25_MS  = 1250,
+    UNIT_10_MS    = 10000
+};
+
+#define MSEC_TO_UNITS(TIME, RESOLUTION) (((TIME) * 1000) / (RESOLUTION))
+
+#define ARRAY_SIZE(arr)             (sizeof(arr) / sizeof((arr)[0]))
+
+#define ROUNDED_DIV(A, B)           (((A) + ((B) / 2)) / (B))
+#define CEIL_DIV(A, B)              (((A) + (B) - 1) / (B))
+#define ALIGN_NUM(alignment, number) (((number) - 1) + (alignment) - (((number) - 1) % (alignment)))
@@ -0,0 +1,10 @@
+/**
+ * host simulator -- app_util_platform.h
+ */
+
+#pragma once
+
+#include "app_util.h"
+
+#define CRITICAL_REGION_ENTER()
+#define CRITICAL_REGION_EXIT()
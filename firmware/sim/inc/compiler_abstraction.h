@@ -0,0 +1,15 @@
+/**
+ * host simulator -- compiler abstraction for gcc/clang on the host
+ */
+
+#pragma once
+
+#ifndef __WEAK
+#define __WEAK                      __attribute__((weak))
+#endif
+#ifndef __STATIC_INLINE
+#define __STATIC_INLINE             static inline
+#endif
+#ifndef __ALIGN
+#define __ALIGN(n)                  __attribute__((aligned(n)))
+#endif
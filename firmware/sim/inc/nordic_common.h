@@ -0,0 +1,26 @@
+/**
+ * host simulator -- subset of nordic_common.h used by the application
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifndef MIN
+#define MIN(a, b)                   ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)                   ((a) < (b) ? (b) : (a))
+#endif
+
+#define STRINGIFY_(val)             #val
+#define STRINGIFY(val)              STRINGIFY_(val)
+
+#define CONCAT_2_(p1, p2)           p1##p2
+#define CONCAT_2(p1, p2)            CONCAT_2_(p1, p2)
+#define CONCAT_3_(p1, p2, p3)       p1##p2##p3
+#define CONCAT_3(p1, p2, p3)        CONCAT_3_(p1, p2, p3)
+
+#define UNUSED_VARIABLE(X)          ((void)(X))
+#define UNUSED_PARAMETER(X)         UNUSED_VARIABLE(X)
+#define UNUSED_RETURN_VALUE(X)      UNUSED_VARIABLE(X)
@@ -0,0 +1,15 @@
+/**
+ * host simulator -- device header. there are no memory mapped peripherals on
+ * the host; drivers are replaced by the mock backends in sim/src.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "compiler_abstraction.h"
+
+// peripheral capabilities, as in nrf52811_peripherals.h
+#define SPIM0_EASYDMA_MAXCNT_SIZE   15
+#define SPIM1_EASYDMA_MAXCNT_SIZE   15
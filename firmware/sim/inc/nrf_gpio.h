@@ -0,0 +1,22 @@
+/**
+ * host simulator -- GPIO HAL. pin state is kept by the simulator so models
+ * can observe outputs (e.g. GPIO_DIV_EN) and drive inputs (e.g. IMU_INT1).
+ */
+
+#pragma once
+
+#include "nrf.h"
+
+typedef enum {
+    NRF_GPIO_PIN_NOPULL   = 0,
+    NRF_GPIO_PIN_PULLDOWN = 1,
+    NRF_GPIO_PIN_PULLUP   = 3
+} nrf_gpio_pin_pull_t;
+
+void nrf_gpio_cfg_output(uint32_t pin_number);
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config);
+void nrf_gpio_cfg_default(uint32_t pin_number);
+void nrf_gpio_pin_set(uint32_t pin_number);
+void nrf_gpio_pin_clear(uint32_t pin_number);
+void nrf_gpio_pin_write(uint32_t pin_number, uint32_t value);
+uint32_t nrf_gpio_pin_read(uint32_t pin_number);
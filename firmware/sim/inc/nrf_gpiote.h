@@ -0,0 +1,14 @@
+/**
+ * host simulator -- GPIOTE HAL types
+ */
+
+#pragma once
+
+#include "nrf.h"
+
+typedef enum {
+    NRF_GPIOTE_POLARITY_NONE   = 0,
+    NRF_GPIOTE_POLARITY_LOTOHI = 1,
+    NRF_GPIOTE_POLARITY_HITOLO = 2,
+    NRF_GPIOTE_POLARITY_TOGGLE = 3
+} nrf_gpiote_polarity_t;
@@ -0,0 +1,18 @@
+/**
+ * host simulator -- logger. NRF_LOG_INFO prints with a simulated timestamp
+ * when the simulator runs verbose (-v).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include "sdk_errors.h"
+
+void sim_log(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#define NRF_LOG_INFO(...)           sim_log(__VA_ARGS__)
+#define NRF_LOG_DEBUG(...)          sim_log(__VA_ARGS__)
+#define NRF_LOG_WARNING(...)        sim_log(__VA_ARGS__)
+#define NRF_LOG_ERROR(...)          sim_log(__VA_ARGS__)
+#define NRF_LOG_PROCESS()           false
+#define NRF_LOG_FLUSH()
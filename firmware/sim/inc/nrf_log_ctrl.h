@@ -0,0 +1,9 @@
+/**
+ * host simulator -- logger control
+ */
+
+#pragma once
+
+#include "nrf_log.h"
+
+#define NRF_LOG_INIT(timestamp_func) NRF_SUCCESS
@@ -0,0 +1,7 @@
+/**
+ * host simulator -- logger backends
+ */
+
+#pragma once
+
+#define NRF_LOG_DEFAULT_BACKENDS_INIT()
@@ -0,0 +1,62 @@
+/**
+ * host simulator -- LPCOMP HAL types
+ */
+
+#pragma once
+
+#include "nrf.h"
+
+typedef enum {
+    NRF_LPCOMP_INPUT_0,
+    NRF_LPCOMP_INPUT_1,
+    NRF_LPCOMP_INPUT_2,
+    NRF_LPCOMP_INPUT_3,
+    NRF_LPCOMP_INPUT_4,
+    NRF_LPCOMP_INPUT_5,
+    NRF_LPCOMP_INPUT_6,
+    NRF_LPCOMP_INPUT_7
+} nrf_lpcomp_input_t;
+
+typedef enum {
+    NRF_LPCOMP_REF_SUPPLY_1_8   = 0,
+    NRF_LPCOMP_REF_SUPPLY_2_8   = 1,
+    NRF_LPCOMP_REF_SUPPLY_3_8   = 2,
+    NRF_LPCOMP_REF_SUPPLY_4_8   = 3,
+    NRF_LPCOMP_REF_SUPPLY_5_8   = 4,
+    NRF_LPCOMP_REF_SUPPLY_6_8   = 5,
+    NRF_LPCOMP_REF_SUPPLY_7_8   = 6,
+    NRF_LPCOMP_REF_EXT_REF0     = 7,
+    NRF_LPCOMP_REF_SUPPLY_1_16  = 8,
+    NRF_LPCOMP_REF_SUPPLY_3_16  = 9,
+    NRF_LPCOMP_REF_SUPPLY_5_16  = 10,
+    NRF_LPCOMP_REF_SUPPLY_7_16  = 11,
+    NRF_LPCOMP_REF_SUPPLY_9_16  = 12,
+    NRF_LPCOMP_REF_SUPPLY_11_16 = 13,
+    NRF_LPCOMP_REF_SUPPLY_13_16 = 14,
+    NRF_LPCOMP_REF_SUPPLY_15_16 = 15,
+    NRF_LPCOMP_REF_EXT_REF1     = 0x10007
+} nrf_lpcomp_ref_t;
+
+typedef enum {
+    NRF_LPCOMP_DETECT_CROSS,
+    NRF_LPCOMP_DETECT_UP,
+    NRF_LPCOMP_DETECT_DOWN
+} nrf_lpcomp_detect_t;
+
+typedef enum {
+    NRF_LPCOMP_HYST_NOHYST,
+    NRF_LPCOMP_HYST_50mV
+} nrf_lpcomp_hysteresis_t;
+
+typedef enum {
+    NRF_LPCOMP_EVENT_READY = 0x100,
+    NRF_LPCOMP_EVENT_DOWN  = 0x104,
+    NRF_LPCOMP_EVENT_UP    = 0x108,
+    NRF_LPCOMP_EVENT_CROSS = 0x10C
+} nrf_lpcomp_event_t;
+
+typedef struct {
+    nrf_lpcomp_ref_t reference;
+    nrf_lpcomp_detect_t detection;
+    nrf_lpcomp_hysteresis_t hyst;
+} nrf_lpcomp_config_t;
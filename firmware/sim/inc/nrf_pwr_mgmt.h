@@ -0,0 +1,21 @@
+/**
+ * host simulator -- power management. nrf_pwr_mgmt_run() is where simulated
+ * time advances: the CPU "sleeps" until the next pending hardware event.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include "sdk_errors.h"
+
+typedef enum {
+    NRF_PWR_MGMT_SHUTDOWN_GOTO_SYSOFF,
+    NRF_PWR_MGMT_SHUTDOWN_STAY_IN_SYSOFF,
+    NRF_PWR_MGMT_SHUTDOWN_GOTO_DFU,
+    NRF_PWR_MGMT_SHUTDOWN_RESET,
+    NRF_PWR_MGMT_SHUTDOWN_CONTINUE
+} nrf_pwr_mgmt_shutdown_t;
+
+ret_code_t nrf_pwr_mgmt_init(void);
+void nrf_pwr_mgmt_run(void);
+void nrf_pwr_mgmt_shutdown(nrf_pwr_mgmt_shutdown_t shutdown_type);
@@ -0,0 +1,46 @@
+/**
+ * host simulator -- RTC HAL. only RTC1 exists, shared with app_timer: its
+ * counter is the app_timer tick, and the compare channels raise events for
+ * PPI (interrupts stay with app_timer).
+ */
+
+#pragma once
+
+#include "nrf.h"
+
+typedef struct sim_rtc NRF_RTC_Type;
+
+extern NRF_RTC_Type sim_rtc1;
+#define NRF_RTC1                    (&sim_rtc1)
+#define NRF_RTC1_BASE               0x40011000UL
+
+#define NRF_RTC_CC_CHANNEL_COUNT(id)    4
+#define NRF_RTC_COUNTER_MAX             0xFFFFFF
+
+typedef enum {
+    NRF_RTC_EVENT_TICK      = 0x100,
+    NRF_RTC_EVENT_OVERFLOW  = 0x104,
+    NRF_RTC_EVENT_COMPARE_0 = 0x140,
+    NRF_RTC_EVENT_COMPARE_1 = 0x144,
+    NRF_RTC_EVENT_COMPARE_2 = 0x148,
+    NRF_RTC_EVENT_COMPARE_3 = 0x14C
+} nrf_rtc_event_t;
+
+typedef enum {
+    NRF_RTC_INT_TICK_MASK     = (1u << 0),
+    NRF_RTC_INT_OVERFLOW_MASK = (1u << 1),
+    NRF_RTC_INT_COMPARE0_MASK = (1u << 16),
+    NRF_RTC_INT_COMPARE1_MASK = (1u << 17),
+    NRF_RTC_INT_COMPARE2_MASK = (1u << 18),
+    NRF_RTC_INT_COMPARE3_MASK = (1u << 19)
+} nrf_rtc_int_t;
+
+#define NRF_RTC_CHANNEL_INT_MASK(ch)    ((uint32_t)(NRF_RTC_INT_COMPARE0_MASK) << (ch))
+#define NRF_RTC_CHANNEL_EVENT_ADDR(ch)  (nrf_rtc_event_t)((NRF_RTC_EVENT_COMPARE_0) + (ch) * sizeof(uint32_t))
+
+void nrf_rtc_cc_set(NRF_RTC_Type *p_reg, uint32_t ch, uint32_t cc_val);
+uint32_t nrf_rtc_counter_get(NRF_RTC_Type const *p_reg);
+void nrf_rtc_event_clear(NRF_RTC_Type *p_reg, nrf_rtc_event_t event);
+void nrf_rtc_event_enable(NRF_RTC_Type *p_reg, uint32_t mask);
+void nrf_rtc_event_disable(NRF_RTC_Type *p_reg, uint32_t mask);
+uint32_t nrf_rtc_event_address_get(NRF_RTC_Type const *p_reg, nrf_rtc_event_t event);
@@ -0,0 +1,103 @@
+/**
+ * host simulator -- SAADC HAL types
+ */
+
+#pragma once
+
+#include "nrf.h"
+
+#define NRF_SAADC_BASE              0x40007000UL
+
+typedef int16_t nrf_saadc_value_t;
+
+typedef enum {
+    NRF_SAADC_TASK_START     = 0x000,
+    NRF_SAADC_TASK_SAMPLE    = 0x004,
+    NRF_SAADC_TASK_STOP      = 0x008
+} nrf_saadc_task_t;
+
+typedef enum {
+    NRF_SAADC_RESOLUTION_8BIT  = 0,
+    NRF_SAADC_RESOLUTION_10BIT = 1,
+    NRF_SAADC_RESOLUTION_12BIT = 2,
+    NRF_SAADC_RESOLUTION_14BIT = 3
+} nrf_saadc_resolution_t;
+
+typedef enum {
+    NRF_SAADC_INPUT_DISABLED = 0,
+    NRF_SAADC_INPUT_AIN0,
+    NRF_SAADC_INPUT_AIN1,
+    NRF_SAADC_INPUT_AIN2,
+    NRF_SAADC_INPUT_AIN3,
+    NRF_SAADC_INPUT_AIN4,
+    NRF_SAADC_INPUT_AIN5,
+    NRF_SAADC_INPUT_AIN6,
+    NRF_SAADC_INPUT_AIN7,
+    NRF_SAADC_INPUT_VDD
+} nrf_saadc_input_t;
+
+typedef enum {
+    NRF_SAADC_OVERSAMPLE_DISABLED = 0,
+    NRF_SAADC_OVERSAMPLE_2X,
+    NRF_SAADC_OVERSAMPLE_4X,
+    NRF_SAADC_OVERSAMPLE_8X,
+    NRF_SAADC_OVERSAMPLE_16X,
+    NRF_SAADC_OVERSAMPLE_32X,
+    NRF_SAADC_OVERSAMPLE_64X,
+    NRF_SAADC_OVERSAMPLE_128X,
+    NRF_SAADC_OVERSAMPLE_256X
+} nrf_saadc_oversample_t;
+
+typedef enum {
+    NRF_SAADC_RESISTOR_DISABLED,
+    NRF_SAADC_RESISTOR_PULLDOWN,
+    NRF_SAADC_RESISTOR_PULLUP,
+    NRF_SAADC_RESISTOR_VDD1_2
+} nrf_saadc_resistor_t;
+
+typedef enum {
+    NRF_SAADC_GAIN1_6,
+    NRF_SAADC_GAIN1_5,
+    NRF_SAADC_GAIN1_4,
+    NRF_SAADC_GAIN1_3,
+    NRF_SAADC_GAIN1_2,
+    NRF_SAADC_GAIN1,
+    NRF_SAADC_GAIN2,
+    NRF_SAADC_GAIN4
+} nrf_saadc_gain_t;
+
+typedef enum {
+    NRF_SAADC_REFERENCE_INTERNAL,
+    NRF_SAADC_REFERENCE_VDD4
+} nrf_saadc_reference_t;
+
+typedef enum {
+    NRF_SAADC_ACQTIME_3US,
+    NRF_SAADC_ACQTIME_5US,
+    NRF_SAADC_ACQTIME_10US,
+    NRF_SAADC_ACQTIME_15US,
+    NRF_SAADC_ACQTIME_20US,
+    NRF_SAADC_ACQTIME_40US
+} nrf_saadc_acqtime_t;
+
+typedef enum {
+    NRF_SAADC_MODE_SINGLE_ENDED,
+    NRF_SAADC_MODE_DIFFERENTIAL
+} nrf_saadc_mode_t;
+
+typedef enum {
+    NRF_SAADC_BURST_DISABLED,
+    NRF_SAADC_BURST_ENABLED
+} nrf_saadc_burst_t;
+
+typedef struct {
+    nrf_saadc_resistor_t resistor_p;
+    nrf_saadc_resistor_t resistor_n;
+    nrf_saadc_gain_t gain;
+    nrf_saadc_reference_t reference;
+    nrf_saadc_acqtime_t acq_time;
+    nrf_saadc_mode_t mode;
+    nrf_saadc_burst_t burst;
+    nrf_saadc_input_t pin_p;
+    nrf_saadc_input_t pin_n;
+} nrf_saadc_channel_config_t;
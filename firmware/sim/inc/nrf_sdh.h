@@ -0,0 +1,9 @@
+/**
+ * host simulator -- SoftDevice handler
+ */
+
+#pragma once
+
+#include "sdk_errors.h"
+
+ret_code_t nrf_sdh_enable_request(void);
@@ -0,0 +1,36 @@
+/**
+ * host simulator -- SPIM HAL types
+ */
+
+#pragma once
+
+#include "nrf.h"
+
+typedef enum {
+    NRF_SPIM_FREQ_125K = 0x02000000,
+    NRF_SPIM_FREQ_250K = 0x04000000,
+    NRF_SPIM_FREQ_500K = 0x08000000,
+    NRF_SPIM_FREQ_1M   = 0x10000000,
+    NRF_SPIM_FREQ_2M   = 0x20000000,
+    NRF_SPIM_FREQ_4M   = 0x40000000,
+    NRF_SPIM_FREQ_8M   = (int)0x80000000
+} nrf_spim_frequency_t;
+
+typedef enum {
+    NRF_SPIM_MODE_0,
+    NRF_SPIM_MODE_1,
+    NRF_SPIM_MODE_2,
+    NRF_SPIM_MODE_3
+} nrf_spim_mode_t;
+
+typedef enum {
+    NRF_SPIM_BIT_ORDER_MSB_FIRST,
+    NRF_SPIM_BIT_ORDER_LSB_FIRST
+} nrf_spim_bit_order_t;
+
+#define NRF_SPIM_PIN_NOT_CONNECTED  0xFFFFFFFF
+
+// there is a single SPIM model, the register block is never dereferenced
+typedef struct NRF_SPIM_Type NRF_SPIM_Type;
+
+void nrf_spim_frequency_set(NRF_SPIM_Type *p_reg, nrf_spim_frequency_t frequency);
@@ -0,0 +1,7 @@
+/**
+ * host simulator -- nrfx_clock.h (unused by the application)
+ */
+
+#pragma once
+
+#include "nrfx.h"
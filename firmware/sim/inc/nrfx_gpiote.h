@@ -0,0 +1,48 @@
+/**
+ * host simulator -- nrfx_gpiote driver API (input events only)
+ */
+
+#pragma once
+
+#include "nrfx.h"
+#include "nrf_gpio.h"
+#include "nrf_gpiote.h"
+
+typedef uint32_t nrfx_gpiote_pin_t;
+
+typedef struct {
+    nrf_gpiote_polarity_t sense;
+    nrf_gpio_pin_pull_t pull;
+    bool is_watcher;
+    bool hi_accuracy;
+    bool skip_gpio_setup;
+} nrfx_gpiote_in_config_t;
+
+#define NRFX_GPIOTE_CONFIG_IN_SENSE_LOTOHI(hi_accu) \
+        { \
+            .sense = NRF_GPIOTE_POLARITY_LOTOHI, \
+            .pull = NRF_GPIO_PIN_NOPULL, \
+            .is_watcher = false, \
+            .hi_accuracy = (hi_accu), \
+            .skip_gpio_setup = false, \
+        }
+#define NRFX_GPIOTE_CONFIG_IN_SENSE_HITOLO(hi_accu) \
+        { \
+            .sense = NRF_GPIOTE_POLARITY_HITOLO, \
+            .pull = NRF_GPIO_PIN_NOPULL, \
+            .is_watcher = false, \
+            .hi_accuracy = (hi_accu), \
+            .skip_gpio_setup = false, \
+        }
+
+typedef void (*nrfx_gpiote_evt_handler_t)(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action);
+
+nrfx_err_t nrfx_gpiote_init(void);
+bool nrfx_gpiote_is_init(void);
+nrfx_err_t nrfx_gpiote_in_init(nrfx_gpiote_pin_t pin,
+                               nrfx_gpiote_in_config_t const *p_config,
+                               nrfx_gpiote_evt_handler_t evt_handler);
+void nrfx_gpiote_in_uninit(nrfx_gpiote_pin_t pin);
+void nrfx_gpiote_in_event_enable(nrfx_gpiote_pin_t pin, bool int_enable);
+void nrfx_gpiote_in_event_disable(nrfx_gpiote_pin_t pin);
+bool nrfx_gpiote_in_is_set(nrfx_gpiote_pin_t pin);
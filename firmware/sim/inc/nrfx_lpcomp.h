@@ -0,0 +1,24 @@
+/**
+ * host simulator -- nrfx_lpcomp driver API. the comparator watches the
+ * simulated storage capacitor through the V_STORE_DIV_INV divider against a
+ * fraction of the LTC3109's VOUT.
+ */
+
+#pragma once
+
+#include "nrfx.h"
+#include "nrf_lpcomp.h"
+
+typedef struct {
+    nrf_lpcomp_config_t hal;
+    nrf_lpcomp_input_t input;
+    uint8_t interrupt_priority;
+} nrfx_lpcomp_config_t;
+
+typedef void (*nrfx_lpcomp_event_handler_t)(nrf_lpcomp_event_t event);
+
+nrfx_err_t nrfx_lpcomp_init(nrfx_lpcomp_config_t const *p_config,
+                            nrfx_lpcomp_event_handler_t event_handler);
+void nrfx_lpcomp_uninit(void);
+void nrfx_lpcomp_enable(void);
+void nrfx_lpcomp_disable(void);
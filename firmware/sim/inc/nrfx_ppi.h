@@ -0,0 +1,24 @@
+/**
+ * host simulator -- nrfx_ppi allocator. channels connect simulated event
+ * addresses to task addresses, see sim_nrfx_ppi.c for the ones modelled.
+ */
+
+#pragma once
+
+#include "nrfx.h"
+
+typedef enum {
+    NRF_PPI_CHANNEL0,  NRF_PPI_CHANNEL1,  NRF_PPI_CHANNEL2,  NRF_PPI_CHANNEL3,
+    NRF_PPI_CHANNEL4,  NRF_PPI_CHANNEL5,  NRF_PPI_CHANNEL6,  NRF_PPI_CHANNEL7,
+    NRF_PPI_CHANNEL8,  NRF_PPI_CHANNEL9,  NRF_PPI_CHANNEL10, NRF_PPI_CHANNEL11,
+    NRF_PPI_CHANNEL12, NRF_PPI_CHANNEL13, NRF_PPI_CHANNEL14, NRF_PPI_CHANNEL15,
+    NRF_PPI_CHANNEL16
+} nrf_ppi_channel_t;
+
+#define NRF_PPI_CHANNEL_COUNT   17  // left to the application, the SoftDevice keeps 17 and up
+
+nrfx_err_t nrfx_ppi_channel_alloc(nrf_ppi_channel_t *p_channel);
+nrfx_err_t nrfx_ppi_channel_free(nrf_ppi_channel_t channel);
+nrfx_err_t nrfx_ppi_channel_assign(nrf_ppi_channel_t channel, uint32_t eep, uint32_t tep);
+nrfx_err_t nrfx_ppi_channel_enable(nrf_ppi_channel_t channel);
+nrfx_err_t nrfx_ppi_channel_disable(nrf_ppi_channel_t channel);
@@ -0,0 +1,72 @@
+/**
+ * host simulator -- nrfx_saadc (legacy v1) driver API. conversions sample the
+ * simulated storage capacitor through the V_STORE_DIV_INV divider. a second
+ * buffer_convert() queues the next buffer, which the SAADC switches to when
+ * the first is full. calibrate_offset() raises CALIBRATEDONE when it is done.
+ */
+
+#pragma once
+
+#include "nrfx.h"
+#include "nrf_saadc.h"
+
+typedef struct {
+    nrf_saadc_resolution_t resolution;
+    nrf_saadc_oversample_t oversample;
+    uint8_t interrupt_priority;
+    bool low_power_mode;
+} nrfx_saadc_config_t;
+
+#define NRFX_SAADC_DEFAULT_CONFIG \
+        { \
+            .resolution         = (nrf_saadc_resolution_t)NRFX_SAADC_CONFIG_RESOLUTION, \
+            .oversample         = (nrf_saadc_oversample_t)NRFX_SAADC_CONFIG_OVERSAMPLE, \
+            .interrupt_priority = NRFX_SAADC_CONFIG_IRQ_PRIORITY, \
+            .low_power_mode     = NRFX_SAADC_CONFIG_LP_MODE \
+        }
+
+typedef enum {
+    NRFX_SAADC_EVT_DONE,
+    NRFX_SAADC_EVT_LIMIT,
+    NRFX_SAADC_EVT_CALIBRATEDONE
+} nrfx_saadc_evt_type_t;
+
+typedef struct {
+    nrf_saadc_value_t *p_buffer;
+    uint16_t size;
+} nrfx_saadc_done_evt_t;
+
+typedef enum {
+    NRF_SAADC_LIMIT_LOW,
+    NRF_SAADC_LIMIT_HIGH
+} nrf_saadc_limit_t;
+
+typedef struct {
+    uint8_t channel;
+    nrf_saadc_limit_t limit_type;
+} nrfx_saadc_limit_evt_t;
+
+typedef struct {
+    nrfx_saadc_evt_type_t type;
+    union {
+        nrfx_saadc_done_evt_t done;
+        nrfx_saadc_limit_evt_t limit;
+    } data;
+} nrfx_saadc_evt_t;
+
+#define NRFX_SAADC_LIMITL_DISABLED  (-2048)
+#define NRFX_SAADC_LIMITH_DISABLED  (2047)
+
+typedef void (*nrfx_saadc_event_handler_t)(nrfx_saadc_evt_t const *p_event);
+
+nrfx_err_t nrfx_saadc_init(nrfx_saadc_config_t const *p_config,
+                           nrfx_saadc_event_handler_t event_handler);
+void nrfx_saadc_uninit(void);
+nrfx_err_t nrfx_saadc_channel_init(uint8_t channel, nrf_saadc_channel_config_t const *p_config);
+nrfx_err_t nrfx_saadc_buffer_convert(nrf_saadc_value_t *p_buffer, uint16_t size);
+nrfx_err_t nrfx_saadc_sample(void);
+nrfx_err_t nrfx_saadc_sample_convert(uint8_t channel, nrf_saadc_value_t *p_value);
+nrfx_err_t nrfx_saadc_calibrate_offset(void);
+bool nrfx_saadc_is_busy(void);
+void nrfx_saadc_limits_set(uint8_t channel, int16_t limit_low, int16_t limit_high);
+uint32_t nrfx_saadc_sample_task_get(void);
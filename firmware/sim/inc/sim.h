@@ -0,0 +1,279 @@
+/**
+ * host simulator core -- simulated time, event queue, models and statistics
+ *
+ * the firmware runs unmodified on top of the mock SDK backends in sim/src.
+ * simulated time only advances inside nrf_pwr_mgmt_run(), which "sleeps" the
+ * CPU until the next pending hardware event and runs its handler (the ISR).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "nrf_spim.h"
+#include "app_features.h"
+#include "app_classifier.h"
+
+// time -----------------------------------------------------------------------
+
+#define SIM_NS_PER_US           1000ULL
+#define SIM_NS_PER_MS           1000000ULL
+#define SIM_NS_PER_S            1000000000ULL
+
+#define SIM_US(x)               ((uint64_t)(x) * SIM_NS_PER_US)
+#define SIM_MS(x)               ((uint64_t)(x) * SIM_NS_PER_MS)
+#define SIM_S(x)                ((uint64_t)(x) * SIM_NS_PER_S)
+
+uint64_t sim_time_ns(void);
+void sim_time_restore(uint64_t time_ns);
+
+// events ---------------------------------------------------------------------
+
+#define SIM_EVENT_QUEUE_SIZE    64
+#define SIM_EVENT_INVALID       0
+
+typedef void (*sim_event_fn_t)(void *p_context);
+
+uint32_t sim_event_schedule(uint64_t delay_ns, sim_event_fn_t fn, void *p_context);
+uint32_t sim_event_schedule_at(uint64_t time_ns, sim_event_fn_t fn, void *p_context);
+uint32_t sim_event_schedule_silent(uint64_t delay_ns, sim_event_fn_t fn, void *p_context);
+void sim_event_cancel(uint32_t event_id);
+bool sim_event_step(bool *p_wake);
+void sim_finish(int status) __attribute__((noreturn));
+
+// configuration --------------------------------------------------------------
+
+typedef struct {
+    uint64_t duration_ns;       // stop the simulation after this much time
+    int32_t v_store_mv;         // initial storage capacitor voltage
+    double harvest_uw;          // constant harvester output power
+    const char *harvest_trace;  // harvester output power trace file
+    const char *activity;       // synthetic activity profile instead of a trace
+    uint32_t seed;              // seed for the motion model noise
+    uint8_t format;             // FRAME_FORMAT_* the central asks for
+    uint8_t window;             // feature window the central asks for, 0 for the default
+    const char *train_path;     // --train: write the classifier model here instead of running
+    const char *data_path;      // recording to train and benchmark the classifier on
+    double link_error_pct;      // notifications the central loses, and as many it gets twice
+    bool no_lpcomp;             // nrfx_lpcomp_init() fails, the firmware polls v_store
+    bool verbose;               // print firmware debug_log() output
+} sim_config_t;
+
+extern sim_config_t sim_config;
+
+// energy ---------------------------------------------------------------------
+
+typedef enum {
+    SIM_ENERGY_BOOT,            // inrush + hardware initialization
+    SIM_ENERGY_BLE_INIT,        // stack init, advertising, connection
+    SIM_ENERGY_CPU,             // wake-ups from sleep
+    SIM_ENERGY_SAADC,           // conversions
+    SIM_ENERGY_LPCOMP,          // comparator watching v_store
+    SIM_ENERGY_DIVIDER,         // v_store divider leakage while switched on
+    SIM_ENERGY_SPI,             // SPIM bring-up and transfers
+    SIM_ENERGY_ACCEL,           // BMA400 in normal mode
+    SIM_ENERGY_BLE_TX,          // notifications
+    SIM_ENERGY_IDLE,            // leakage while powered
+    SIM_ENERGY_COUNT
+} sim_energy_t;
+
+void sim_energy_init(void);
+void sim_energy_update(void);
+bool sim_energy_wait_power_on(void);
+void sim_energy_boot(void);
+void sim_energy_cpu_wake(void);
+void sim_energy_saadc_conversions(uint32_t n_conversions);
+void sim_energy_spim_init(void);
+void sim_energy_spi_xfer(uint64_t duration_ns);
+double sim_energy_spi_uj(uint64_t duration_ns);
+void sim_energy_bma400_active(bool active);
+void sim_energy_lpcomp_active(bool active);
+void sim_energy_ble_setup(uint64_t window_ns);
+void sim_energy_ble_setup_done(void);
+void sim_energy_ble_event(void);
+void sim_energy_ble_notification(uint16_t length);
+double sim_energy_stored_uj(void);
+void sim_energy_restore(double stored_uj);
+void sim_energy_report(void);
+
+// harvester ------------------------------------------------------------------
+
+typedef enum {
+    SIM_ACTIVITY_NONE,          // constant supply or unlabelled trace
+    SIM_ACTIVITY_DESK,
+    SIM_ACTIVITY_WALKING,
+    SIM_ACTIVITY_RUNNING,
+    SIM_ACTIVITY_COUNT
+} sim_activity_t;
+
+bool sim_harvest_init(void);
+double sim_harvest_energy_uj(uint64_t from_ns, uint64_t to_ns);
+sim_activity_t sim_harvest_activity(uint64_t time_ns);
+uint64_t sim_harvest_activity_end(uint64_t time_ns);
+const char *sim_activity_name(sim_activity_t activity);
+
+// resets ---------------------------------------------------------------------
+
+void sim_brownout(void) __attribute__((noreturn));
+void sim_hw_init_done(void);
+
+// statistics -----------------------------------------------------------------
+
+typedef struct {
+    uint64_t time_ns;
+    uint64_t powered_ns;
+    uint64_t sampling_ns;       // BMA400 in normal mode
+    double harvested_uj;
+    uint32_t samples_delivered;
+    uint32_t brownouts;
+} sim_activity_stats_t;
+
+typedef struct {
+    uint32_t cpu_wakeups;
+    uint32_t sched_blocking_wakeups;    // CPU woke while a scheduler handler waited for an event
+    uint64_t sched_handler_max_ns;      // longest scheduler handler, in simulated time
+    uint32_t spim_inits;
+    uint64_t spim_init_ns;      // CPU time of SPIM bring-up and tear-down
+    uint32_t spi_xfers;
+    uint32_t spi_bytes;
+    uint64_t spi_active_ns;             // HFCLK + SPIM clocking
+    uint64_t spi_fifo_active_ns;        // of that, transfers reading the FIFO
+    uint32_t saadc_inits;
+    uint32_t saadc_samples;
+    uint32_t saadc_v_store_reads;       // samples into a buffer, of the divider output
+    double saadc_err_sum_mv;            // |result - input| x V_STORE_DIV_INV, offset included
+    double saadc_err_max_mv;
+    uint32_t v_store_wakeups;           // CPU woken to trigger or collect a sample, or by the LPCOMP
+    uint32_t lpcomp_irqs;
+    uint64_t lpcomp_active_ns;
+    uint64_t divider_on_ns;
+    double divider_always_on_uj;        // what the divider would have leaked never switched off
+    uint32_t gpiote_irqs;
+    uint32_t bma_samples_generated;
+    uint32_t bma_samples_dropped;
+    uint32_t bma_fifo_bytes_read;
+    uint32_t bma_fifo_xfers;            // read transactions touching FIFO_LENGTH or FIFO_DATA
+    uint32_t bma_fifo_frames_read;
+    uint32_t bma_fifo_wasted_bytes;     // clocked out of FIFO_DATA without completing a frame
+    uint32_t bma_frames_flushed;        // discarded unread on flush / power mode change
+    uint32_t bma_watermark_irqs;
+    uint32_t ble_notifications;
+    uint32_t ble_tx_events;     // connection events carrying notifications
+    uint32_t ble_payload_bytes;
+    uint32_t ble_send_errors;
+    uint32_t ble_queue_full;    // NRF_ERROR_RESOURCES, retried on TX_RDY
+    uint32_t ble_link_lost;     // --link-errors: not delivered to the host
+    uint32_t ble_link_repeated; // --link-errors: delivered twice
+    uint32_t host_frames;
+    uint32_t host_frames_invalid;       // rejected by frame_decode()
+    uint32_t host_frames_lost;          // missing sequence numbers
+    uint32_t host_frames_repeated;      // sequence number already seen, dropped
+    uint32_t host_sample_bytes;         // payload bytes after the frame headers
+    uint32_t host_samples_received;
+    uint32_t host_samples_matched;
+    uint32_t host_samples_timed;        // matched and placed at the right sensor time
+    uint32_t host_records;              // FRAME_FORMAT_FEATURES windows received
+    uint32_t host_records_exact;        // equal to the reference features of the generated samples
+                                        // (or for activity records, their window's classification)
+    uint32_t host_activity_changes;     // FRAME_FORMAT_ACTIVITY records with a new activity
+    uint32_t host_activity_keepalives;  // and with the same one
+    uint64_t host_activity_ns;          // timeline between activity records in the same life
+    uint64_t host_activity_right_ns;    // of that, reported as the activity the harvester was in
+    uint32_t host_time_marks;
+    uint32_t host_timeline_gaps;        // marks that do not continue the timeline
+    uint64_t latency_sum_ns;
+    uint64_t latency_max_ns;
+    uint32_t latency_count;
+    uint32_t boots;
+    uint32_t hw_inits;          // power-ons that got through HW init (up to the SAADC)
+    uint32_t hw_init_spi_xfers;
+    uint32_t hw_init_spi_bytes;
+    uint32_t hw_init_cpu_wakeups;
+    double hw_init_uj;          // SPI and CPU wake-up energy of HW init
+    uint32_t brownouts;
+    double energy_uj[SIM_ENERGY_COUNT];
+    double harvested_uj;
+    double wasted_uj;           // harvest lost while the capacitor is full
+    int32_t v_store_min_mv;
+    sim_activity_stats_t activity[SIM_ACTIVITY_COUNT];
+} sim_stats_t;
+
+extern sim_stats_t sim_stats;
+
+void sim_report(void);
+
+// app_scheduler --------------------------------------------------------------
+
+bool sim_sched_in_handler(void);
+
+// benchmark ------------------------------------------------------------------
+
+int sim_bench_run(void);
+
+// ppi ------------------------------------------------------------------------
+
+void sim_ppi_event(uint32_t eep);
+void sim_saadc_task_sample(void);
+
+// gpio -----------------------------------------------------------------------
+
+#define SIM_GPIO_PIN_COUNT      32
+
+void sim_gpio_input_set(uint32_t pin, bool level);
+bool sim_gpio_output_get(uint32_t pin);
+bool sim_gpio_is_output(uint32_t pin);
+void sim_gpiote_input_changed(uint32_t pin, bool level);
+
+// supply ---------------------------------------------------------------------
+
+int32_t sim_supply_v_store_mv(void);
+double sim_supply_v_store_div_mv(void);
+bool sim_supply_divider_on(void);
+int32_t sim_supply_vdd_mv(void);
+
+// spi bus --------------------------------------------------------------------
+
+uint64_t sim_spim_xfer_ns(size_t len, nrf_spim_frequency_t frequency);
+
+// bma400 register model ------------------------------------------------------
+
+typedef struct {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+    uint32_t sensortime;        // 24 bit sensor time the sample was taken at
+} sim_sample_t;
+
+void sim_bma400_init(void);
+void sim_bma400_xfer(uint8_t const *tx, size_t tx_len, uint8_t *rx, size_t rx_len, uint8_t orc);
+bool sim_bma400_sample_lookup(uint32_t index, sim_sample_t *p_sample);
+void sim_bma400_motion(sim_activity_t activity, uint64_t t_ns, sim_sample_t *p_sample);
+
+// feature reference ----------------------------------------------------------
+
+void sim_features_reference(int16_t const *p_xyz, uint8_t n_samples, features_t *p_features);
+
+// classifier training --------------------------------------------------------
+
+typedef struct {
+    features_t features;
+    uint16_t odr_ticks;
+    uint8_t activity;           // ACTIVITY_*
+} sim_window_t;
+
+typedef struct {
+    sim_window_t *p_windows;
+    uint32_t n_windows;
+    uint32_t capacity;
+} sim_dataset_t;
+
+bool sim_dataset_build(sim_dataset_t *p_train, sim_dataset_t *p_test);
+void sim_dataset_free(sim_dataset_t *p_set);
+int sim_train_run(void);
+
+// ble link / host receiver ---------------------------------------------------
+
+void sim_host_receive(uint8_t const *data, uint16_t length);
+void sim_latency_start(void);
+void sim_latency_stop(void);
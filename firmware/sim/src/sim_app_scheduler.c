@@ -0,0 +1,84 @@
+/**
+ * host simulator -- app_scheduler backend
+ *
+ * same queue semantics as the SDK: fixed number of slots, event data copied
+ * in at put time, handlers run from app_sched_execute() in main context.
+ * handlers that wait for an event (nrf_pwr_mgmt_run() until a transfer is
+ * done) hold up everything queued behind them; the report shows how long.
+ */
+
+#include "sim.h"
+#include "app_scheduler.h"
+
+#include <string.h>
+
+typedef struct {
+    app_sched_event_handler_t handler;
+    uint16_t event_size;
+} event_header_t;
+
+_Static_assert(sizeof(event_header_t) == APP_SCHED_EVENT_HEADER_SIZE, "event header size mismatch");
+
+static event_header_t *queue_headers = NULL;
+static uint8_t *queue_data = NULL;
+static uint16_t queue_event_size = 0;
+static uint16_t queue_size = 0;
+static uint16_t queue_start = 0;
+static uint16_t queue_end = 0;
+static bool in_handler = false;
+
+static uint16_t next_index(uint16_t index) {
+    return (index < queue_size) ? (index + 1) : 0;
+}
+
+ret_code_t app_sched_init(uint16_t max_event_size, uint16_t size, void *p_evt_buffer) {
+    if (p_evt_buffer == NULL) return NRF_ERROR_INVALID_PARAM;
+
+    // one slot is kept free to tell a full queue from an empty one
+    queue_headers = p_evt_buffer;
+    queue_data = (uint8_t *)p_evt_buffer + (size + 1) * APP_SCHED_EVENT_HEADER_SIZE;
+    queue_event_size = max_event_size;
+    queue_size = size;
+    queue_start = queue_end = 0;
+    return NRF_SUCCESS;
+}
+
+uint16_t app_sched_queue_space_get(void) {
+    uint16_t used = (queue_end >= queue_start) ? (queue_end - queue_start)
+                                               : (queue_size + 1 - queue_start + queue_end);
+    return queue_size - used;
+}
+
+ret_code_t app_sched_event_put(void const *p_event_data,
+                               uint16_t event_size,
+                               app_sched_event_handler_t handler) {
+    if (event_size > queue_event_size) return NRF_ERROR_INVALID_LENGTH;
+    if (next_index(queue_end) == queue_start) return NRF_ERROR_NO_MEM;
+
+    queue_headers[queue_end].handler = handler;
+    queue_headers[queue_end].event_size = (p_event_data != NULL) ? event_size : 0;
+    if (p_event_data != NULL && event_size > 0) {
+        memcpy(&queue_data[queue_end * queue_event_size], p_event_data, event_size);
+    }
+    queue_end = next_index(queue_end);
+    return NRF_SUCCESS;
+}
+
+void app_sched_execute(void) {
+    while (queue_start != queue_end) {
+        uint16_t index = queue_start;
+        void *p_data = (queue_headers[index].event_size > 0)
+                       ? &queue_data[index * queue_event_size] : NULL;
+
+        uint64_t start_ns = sim_time_ns();
+        in_handler = true;
+        queue_headers[index].handler(p_data, queue_headers[index].event_size);
+        in_handler = false;
+        sim_stats.sched_handler_max_ns = MAX(sim_stats.sched_handler_max_ns, sim_time_ns() - start_ns);
+        queue_start = next_index(queue_start);
+    }
+}
+
+bool sim_sched_in_handler(void) {
+    return in_handler;
+}
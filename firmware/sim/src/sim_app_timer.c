@@ -0,0 +1,157 @@
+/**
+ * host simulator -- app_timer backend on the simulated RTC1
+ *
+ * timeout handlers run in "RTC1 IRQ" context (APP_TIMER_CONFIG_USE_SCHEDULER
+ * is 0 in sdk_config.h). the compare channels app_timer leaves free (CC1-3)
+ * only raise events for PPI, without waking the CPU.
+ */
+
+#include "sim.h"
+#include "app_timer.h"
+#include "nrf_rtc.h"
+
+#define APP_TIMER_TICK_HZ       (APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1))
+
+static bool initialized = false;
+
+struct sim_rtc {
+    uint32_t cc[NRF_RTC_CC_CHANNEL_COUNT(1)];
+    uint32_t evten;
+    uint32_t event_id[NRF_RTC_CC_CHANNEL_COUNT(1)];
+};
+
+NRF_RTC_Type sim_rtc1;
+
+static uint64_t ticks_to_ns(uint64_t ticks) {
+    return (ticks * SIM_NS_PER_S + APP_TIMER_TICK_HZ - 1) / APP_TIMER_TICK_HZ;
+}
+
+static uint64_t ns_to_ticks(uint64_t ns) {
+    return ns * APP_TIMER_TICK_HZ / SIM_NS_PER_S;
+}
+
+static void timer_expired(void *p_context) {
+    app_timer_t *p_timer = p_context;
+
+    if (p_timer->mode == APP_TIMER_MODE_REPEATED) {
+        // schedule against the tick grid so repeated timers do not drift
+        uint64_t next_tick = ns_to_ticks(sim_time_ns()) + p_timer->period_ticks;
+        p_timer->event_id = sim_event_schedule_at(ticks_to_ns(next_tick), timer_expired, p_timer);
+    } else {
+        p_timer->active = false;
+        p_timer->event_id = SIM_EVENT_INVALID;
+    }
+
+    // a wake-up switching the v_store divider on is for a sample
+    bool div_on = sim_supply_divider_on();
+    p_timer->handler(p_timer->p_context);
+    if (!div_on && sim_supply_divider_on()) sim_stats.v_store_wakeups++;
+}
+
+ret_code_t app_timer_init(void) {
+    // app_timer keeps running timers across repeated init calls
+    initialized = true;
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_create(app_timer_id_t const *p_timer_id,
+                            app_timer_mode_t mode,
+                            app_timer_timeout_handler_t timeout_handler) {
+    if (p_timer_id == NULL || timeout_handler == NULL) return NRF_ERROR_INVALID_PARAM;
+
+    app_timer_t *p_timer = *p_timer_id;
+    if (p_timer->active) return NRF_ERROR_INVALID_STATE;
+
+    p_timer->handler = timeout_handler;
+    p_timer->mode = mode;
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void *p_context) {
+    if (!initialized) return NRF_ERROR_INVALID_STATE;
+    if (timer_id->handler == NULL || timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS) return NRF_ERROR_INVALID_PARAM;
+    if (timer_id->active) return NRF_SUCCESS;   // already running
+
+    uint64_t start_tick = ns_to_ticks(sim_time_ns());
+    timer_id->active = true;
+    timer_id->period_ticks = timeout_ticks;
+    timer_id->p_context = p_context;
+    timer_id->event_id = sim_event_schedule_at(ticks_to_ns(start_tick + timeout_ticks),
+                                               timer_expired, timer_id);
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_stop(app_timer_id_t timer_id) {
+    if (timer_id == NULL) return NRF_ERROR_INVALID_PARAM;
+    if (!timer_id->active) return NRF_SUCCESS;
+
+    sim_event_cancel(timer_id->event_id);
+    timer_id->active = false;
+    timer_id->event_id = SIM_EVENT_INVALID;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_cnt_get(void) {
+    return (uint32_t)(ns_to_ticks(sim_time_ns()) & APP_TIMER_MAX_CNT_VAL);
+}
+
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from) {
+    return (ticks_to - ticks_from) & APP_TIMER_MAX_CNT_VAL;
+}
+
+// RTC1 compare events --------------------------------------------------------
+
+static void rtc_compare_schedule(uint32_t ch);
+
+static void rtc_compare(void *p_context) {
+    uint32_t ch = (uint32_t)(uintptr_t)p_context;
+    sim_rtc1.event_id[ch] = SIM_EVENT_INVALID;
+    sim_ppi_event(nrf_rtc_event_address_get(NRF_RTC1, NRF_RTC_CHANNEL_EVENT_ADDR(ch)));
+    rtc_compare_schedule(ch);   // matches again after the counter wraps
+}
+
+static void rtc_compare_schedule(uint32_t ch) {
+    sim_event_cancel(sim_rtc1.event_id[ch]);
+    sim_rtc1.event_id[ch] = SIM_EVENT_INVALID;
+    if (!(sim_rtc1.evten & NRF_RTC_CHANNEL_INT_MASK(ch))) return;
+
+    // a compare value less than two ticks ahead is not guaranteed to match,
+    // take it as missed until the next wrap
+    uint64_t now_tick = ns_to_ticks(sim_time_ns());
+    uint64_t delta = (sim_rtc1.cc[ch] - now_tick) & NRF_RTC_COUNTER_MAX;
+    if (delta < 2) delta += NRF_RTC_COUNTER_MAX + 1;
+
+    uint64_t delay_ns = ticks_to_ns(now_tick + delta) - sim_time_ns();
+    sim_rtc1.event_id[ch] = sim_event_schedule_silent(delay_ns, rtc_compare, (void *)(uintptr_t)ch);
+}
+
+void nrf_rtc_cc_set(NRF_RTC_Type *p_reg, uint32_t ch, uint32_t cc_val) {
+    p_reg->cc[ch] = cc_val & NRF_RTC_COUNTER_MAX;
+    rtc_compare_schedule(ch);
+}
+
+uint32_t nrf_rtc_counter_get(NRF_RTC_Type const *p_reg) {
+    return app_timer_cnt_get();
+}
+
+void nrf_rtc_event_clear(NRF_RTC_Type *p_reg, nrf_rtc_event_t event) {
+    // PPI sees every event, there is no pending state to clear
+}
+
+void nrf_rtc_event_enable(NRF_RTC_Type *p_reg, uint32_t mask) {
+    p_reg->evten |= mask;
+    for (uint32_t ch = 0; ch < NRF_RTC_CC_CHANNEL_COUNT(1); ch++) {
+        if (mask & NRF_RTC_CHANNEL_INT_MASK(ch)) rtc_compare_schedule(ch);
+    }
+}
+
+void nrf_rtc_event_disable(NRF_RTC_Type *p_reg, uint32_t mask) {
+    p_reg->evten &= ~mask;
+    for (uint32_t ch = 0; ch < NRF_RTC_CC_CHANNEL_COUNT(1); ch++) {
+        if (mask & NRF_RTC_CHANNEL_INT_MASK(ch)) rtc_compare_schedule(ch);
+    }
+}
+
+uint32_t nrf_rtc_event_address_get(NRF_RTC_Type const *p_reg, nrf_rtc_event_t event) {
+    return NRF_RTC1_BASE + (uint32_t)event;
+}
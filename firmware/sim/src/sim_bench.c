@@ -0,0 +1,662 @@
+/**
+ * host simulator -- firmware hot path benchmark (--bench)
+ *
+ * runs the firmware's per-burst data path on canned FIFO images and reports
+ * host nanoseconds per frame. host timings only rank implementations, they
+ * are not nRF52811 cycles. the in-place packing is checked against the copy
+ * chain with the Bosch parser on the same image. the frame codec is checked by round trips of
+ * random frames and by decoding random and corrupted payloads, the Rice
+ * coding also on the motion model's sample streams. the on-device features
+ * have to match the reference in sim_features.c bit for bit. the activity
+ * classifier is scored on the held-out windows of sim_train.c's data set.
+ */
+
+#include "sim.h"
+#include "bma400.h"
+#include "app_accelerometer.h"
+#include "app_stream.h"
+#include "app_frame.h"
+#include "app_features.h"
+#include "app_classifier.h"
+#include "sdk_config.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+#define BENCH_FRAMES            146     // full 1 KB FIFO of 12 bit XYZ frames
+#define BENCH_FRAMES_8_BIT      256     // full 1 KB FIFO of 8 bit XYZ frames
+#define BENCH_MAX_FRAMES        BENCH_FRAMES_8_BIT
+#define BENCH_REPS              20000
+
+static uint8_t image[1 + 1024 + BMA400_FIFO_BYTES_OVERREAD];
+static uint16_t image_len = 0;
+static bool image_8_bit = false;
+static struct bma400_sensor_data out[BENCH_MAX_FRAMES];
+
+static BMA400_INTF_RET_TYPE bench_read(uint8_t reg, uint8_t *data, uint32_t len, void *intf_ptr) {
+    return BMA400_INTF_RET_SUCCESS;
+}
+
+static BMA400_INTF_RET_TYPE bench_write(uint8_t reg, const uint8_t *data, uint32_t len, void *intf_ptr) {
+    return BMA400_INTF_RET_SUCCESS;
+}
+
+static void bench_delay_us(uint32_t period, void *intf_ptr) {
+}
+
+static uint8_t dev_addr = 0;
+static struct bma400_dev dev = {
+    .intf = BMA400_SPI_INTF,
+    .intf_ptr = &dev_addr,
+    .read = bench_read,
+    .write = bench_write,
+    .delay_us = bench_delay_us,
+    .dummy_byte = 1,
+};
+
+// canned images --------------------------------------------------------------
+
+static uint32_t bench_noise_state = 1;
+
+static int16_t bench_value(void) {
+    bench_noise_state = bench_noise_state * 1664525u + 1013904223u;
+    return (int16_t)((int32_t)bench_noise_state >> 20);     // full 12 bit range
+}
+
+// dummy byte and n 12 or 8 bit XYZ frames
+static void image_build(uint16_t n_frames, bool is_8_bit) {
+    image_len = 0;
+    image_8_bit = is_8_bit;
+    image[image_len++] = 0x00;
+    for (uint16_t i = 0; i < n_frames; i++) {
+        image[image_len++] = is_8_bit ? BMA400_FIFO_XYZ_8_BIT_FRAME : BMA400_FIFO_XYZ_12_BIT_FRAME;
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            uint16_t v = (uint16_t)bench_value() & 0x0FFF;
+            if (!is_8_bit) image[image_len++] = v & 0x0F;
+            image[image_len++] = (uint8_t)(v >> 4);
+        }
+    }
+}
+
+// cases ----------------------------------------------------------------------
+
+static double bench_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// burst pipeline: FIFO to notification payload ------------------------------
+
+// the copy chain the firmware used before packing in place: the SPI driver
+// copies each chunk out of its DMA buffer, bma400_get_regs() strips the dummy
+// byte into the FIFO buffer, the parser fills sample structs and those are
+// serialised into the send buffer
+#define COPY_SPI_RX_LEN     256
+#define COPY_FIFO_LEN       (1 + ACCELEROMETER_FIFO_BYTES + BMA400_FIFO_BYTES_OVERREAD)
+#define COPY_SEND_LEN       (ACCELEROMETER_FIFO_BYTES / 7 * 6 + NRF_SDH_BLE_GATT_MAX_MTU_SIZE)
+#define PIPELINE_CHUNK      252     // FIFO bytes per SPI transfer, whole frames in both formats
+
+static uint8_t copy_temp[PIPELINE_CHUNK + 1];
+static uint8_t copy_fifo[COPY_FIFO_LEN];
+static uint8_t copy_send[COPY_SEND_LEN];
+static uint8_t inplace_send[STREAM_SEND_HEADROOM + STREAM_SEND_BUF_LEN];     // app_stream.c's send buffer
+
+static uint16_t pipeline_copy(uint16_t n_frames) {
+    uint16_t fifo_len = image_len - 1;
+
+    // per SPI chunk: DMA buffer -> get_regs temp -> FIFO buffer
+    for (uint16_t pos = 0; pos < fifo_len; pos += PIPELINE_CHUNK) {
+        uint16_t chunk = MIN(PIPELINE_CHUNK, fifo_len - pos);
+        memcpy(copy_temp, &image[pos], chunk + 1);
+        for (uint16_t i = 0; i < chunk; i++) copy_fifo[1 + pos + i] = copy_temp[i + 1];
+    }
+
+    struct bma400_fifo_data fifo;
+    memset(&fifo, 0, sizeof(fifo));
+    fifo.data = copy_fifo;
+    fifo.length = image_len;
+    fifo.fifo_8_bit_en = image_8_bit ? BMA400_ENABLE : BMA400_DISABLE;
+    uint16_t n_out = n_frames;
+    bma400_extract_accel(&fifo, out, &n_out, &dev);
+
+    // sample structs -> send buffer
+    if (image_8_bit) {
+        for (uint16_t i = 0; i < n_out; i++) {
+            copy_send[3 * i]     = (uint8_t)(out[i].x / 16);
+            copy_send[3 * i + 1] = (uint8_t)(out[i].y / 16);
+            copy_send[3 * i + 2] = (uint8_t)(out[i].z / 16);
+        }
+        return n_out * 3;
+    }
+    for (uint16_t i = 0; i < n_out; i++) {
+        memcpy(&copy_send[6 * i],     &out[i].x, sizeof(out[i].x));
+        memcpy(&copy_send[6 * i + 2], &out[i].y, sizeof(out[i].y));
+        memcpy(&copy_send[6 * i + 4], &out[i].z, sizeof(out[i].z));
+    }
+    return n_out * 6;
+}
+
+// stands in for the DMA landing the FIFO data in the send buffer, which
+// costs no CPU on the target; timed on its own and taken off
+static void pipeline_dma(void) {
+    memcpy(&inplace_send[STREAM_SEND_HEADROOM], &image[1], image_len - 1);
+}
+
+static uint16_t pipeline_inplace(void) {
+    pipeline_dma();
+    return accelerometer_pack_fifo(&inplace_send[STREAM_SEND_HEADROOM], image_len - 1,
+                                   image_8_bit ? ACCELEROMETER_FORMAT_8_BIT : ACCELEROMETER_FORMAT_12_BIT);
+}
+
+static double bench_pipeline_ns(uint16_t (*fn)(uint16_t), uint16_t n_frames, uint16_t *p_len) {
+    double start = bench_ns();
+    for (uint32_t rep = 0; rep < BENCH_REPS; rep++) *p_len = fn(n_frames);
+    return (bench_ns() - start) / BENCH_REPS / n_frames;
+}
+
+static uint16_t pipeline_inplace_fn(uint16_t n_frames) { return pipeline_inplace(); }
+static uint16_t pipeline_dma_fn(uint16_t n_frames)     { pipeline_dma(); return 0; }
+
+// report line "<case>_<metric>  <value>", values aligned like the run report
+static void bench_print(const char *name, const char *metric, const char *fmt, ...) {
+    char label[64];
+    va_list args;
+
+    snprintf(label, sizeof(label), "%s_%s", name, metric);
+    printf("%-28s", label);
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    printf("\n");
+}
+
+// one FIFO format: copy chain vs packing in the send buffer. RAM counts the
+// buffers a burst passes through; the SPI driver's own DMA buffer serves the
+// register accesses either way and is left out
+static bool bench_pipeline(const char *name, uint16_t n_frames, bool is_8_bit) {
+    uint16_t copy_len, inplace_len, dma_len;
+
+    image_build(n_frames, is_8_bit);
+    double copy_ns = bench_pipeline_ns(pipeline_copy, n_frames, &copy_len);
+    double dma_ns = bench_pipeline_ns(pipeline_dma_fn, n_frames, &dma_len);
+    double inplace_ns = bench_pipeline_ns(pipeline_inplace_fn, n_frames, &inplace_len) - dma_ns;
+    bool match = copy_len == inplace_len && copy_len == n_frames * (is_8_bit ? 3 : 6)
+              && memcmp(copy_send, &inplace_send[STREAM_SEND_HEADROOM], copy_len) == 0;
+
+    size_t copy_ram = sizeof(copy_temp) + sizeof(copy_fifo) + sizeof(copy_send)
+                    + ACCELEROMETER_MAX_SAMPLES * sizeof(struct bma400_sensor_data);
+    bench_print(name, "copy_ns_frame", "%.2f", copy_ns);
+    bench_print(name, "inplace_ns_frame", "%.2f", inplace_ns);
+    bench_print(name, "inplace_speedup", "%.1fx", copy_ns / inplace_ns);
+    bench_print(name, "copy_ram_bytes", "%zu", copy_ram);
+    bench_print(name, "inplace_ram_bytes", "%zu", sizeof(inplace_send));
+    bench_print(name, "inplace_match", "%s", match ? "yes" : "NO");
+    return match;
+}
+
+// HFCLK / SPIM on time and energy of one FIFO drain at each SPI clock, from
+// the simulator's SPIM model: FIFO_LENGTH + data in one transfer (register,
+// dummy and two length bytes in front), then the sleep write. the CPU sleeps
+// while the bytes clock, so only the peripheral side scales with the clock
+static void bench_spi_clock(const char *name, uint16_t n_frames, bool is_8_bit) {
+    static const struct {
+        nrf_spim_frequency_t frequency;
+        const char *label;
+    } clocks[] = {
+        { NRF_SPIM_FREQ_1M, "1mhz" },
+        { NRF_SPIM_FREQ_2M, "2mhz" },
+        { NRF_SPIM_FREQ_4M, "4mhz" },
+        { NRF_SPIM_FREQ_8M, "8mhz" },
+    };
+    uint16_t fifo_len = 4 + n_frames * (is_8_bit ? 4 : 7);
+    char metric[32];
+
+    bench_print(name, "fifo_bytes", "%u", fifo_len);
+    for (uint8_t i = 0; i < ARRAY_SIZE(clocks); i++) {
+        uint64_t fifo_ns = sim_spim_xfer_ns(fifo_len, clocks[i].frequency);
+        uint64_t burst_ns = fifo_ns + sim_spim_xfer_ns(2, clocks[i].frequency);
+
+        snprintf(metric, sizeof(metric), "%s_fifo_us", clocks[i].label);
+        bench_print(name, metric, "%.1f", (double)fifo_ns / SIM_NS_PER_US);
+        snprintf(metric, sizeof(metric), "%s_on_us", clocks[i].label);
+        bench_print(name, metric, "%.1f", (double)burst_ns / SIM_NS_PER_US);
+        snprintf(metric, sizeof(metric), "%s_uj", clocks[i].label);
+        bench_print(name, metric, "%.2f", sim_energy_spi_uj(burst_ns));
+    }
+}
+
+// frame codec ----------------------------------------------------------------
+
+#define FRAME_CASES         200000
+#define FRAME_PAYLOAD_LEN   (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3)
+
+static uint32_t bench_rand(void) {
+    bench_noise_state = bench_noise_state * 1664525u + 1013904223u;
+    return bench_noise_state >> 8;
+}
+
+static void raw_put(uint8_t *p_raw, int16_t const *p_xyz, uint16_t n_values) {
+    for (uint16_t i = 0; i < n_values; i++) {
+        p_raw[2 * i] = (uint8_t)p_xyz[i];
+        p_raw[2 * i + 1] = (uint8_t)((uint16_t)p_xyz[i] >> 8);
+    }
+}
+
+// 12 bit random walk with a random step size, payload layout
+static void raw_random(uint8_t *p_raw, uint16_t n_samples) {
+    int16_t xyz[3] = { 0 };
+    uint16_t step = 1u << (bench_rand() % 13);
+    for (uint16_t n = 0; n < n_samples; n++) {
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            int32_t v = xyz[axis] + (int32_t)(bench_rand() % (2 * step + 1)) - step;
+            xyz[axis] = (int16_t)MIN(MAX(v, -2048), 2047);
+        }
+        raw_put(&p_raw[6 * n], xyz, 3);
+    }
+}
+
+// random valid frame that fits into one notification. p_raw takes the plain
+// 12 bit samples of a Rice coded frame.
+static void frame_random(frame_t *p_frame, uint8_t *p_samples, uint8_t *p_raw) {
+    memset(p_frame, 0, sizeof(*p_frame));
+    p_frame->seq = (uint8_t)bench_rand();
+    p_frame->flags = bench_rand() & 0x0F;
+    p_frame->format = bench_rand() % 5;
+    p_frame->n_marks = bench_rand() % (FRAME_MARKS_MAX + 1);
+
+    uint16_t space = FRAME_PAYLOAD_LEN - frame_header_len(p_frame->n_marks);
+    if (p_frame->format == FRAME_FORMAT_12_BIT_RICE) {
+        uint16_t n_raw = MAX(bench_rand() % (FRAME_SAMPLES_MAX + 1), p_frame->n_marks);
+        raw_random(p_raw, n_raw);
+        p_frame->n_samples = frame_rice_encode(p_raw, (uint8_t)n_raw, p_samples, space, &p_frame->data_len);
+        p_frame->n_marks = MIN(p_frame->n_marks, p_frame->n_samples);
+    } else if (p_frame->format == FRAME_FORMAT_FEATURES) {
+        uint16_t n_records = bench_rand() % (space / FEATURES_LEN + 1);
+        p_frame->n_samples = (uint8_t)MAX(n_records, p_frame->n_marks);
+        p_frame->data_len = p_frame->n_samples * FEATURES_LEN;
+        for (uint16_t i = 0; i < p_frame->n_samples; i++) {
+            features_t features;
+            uint8_t window = (uint8_t)(FEATURES_WINDOW_MIN << (bench_rand() % 4));
+            raw_random(p_raw, window);
+            features_compute(p_raw, window, &features);
+            features_encode(&features, &p_samples[i * FEATURES_LEN]);
+        }
+    } else if (p_frame->format == FRAME_FORMAT_ACTIVITY) {
+        p_frame->n_samples = p_frame->n_marks;
+        p_frame->data_len = p_frame->n_samples * ACTIVITY_LEN;
+        for (uint16_t i = 0; i < p_frame->n_samples; i++) {
+            activity_record_t record = { (uint8_t)(FEATURES_WINDOW_MIN << (bench_rand() % 4)),
+                                         (uint8_t)(bench_rand() % ACTIVITY_COUNT), (uint8_t)(1 + bench_rand() % 255) };
+            activity_encode(&record, &p_samples[i * ACTIVITY_LEN]);
+        }
+    } else {
+        uint16_t max_samples = space / frame_sample_len(p_frame->format);
+        uint16_t n_samples = bench_rand() % (max_samples + 1);
+        p_frame->n_samples = (uint8_t)MAX(n_samples, p_frame->n_marks);
+        p_frame->data_len = p_frame->n_samples * frame_sample_len(p_frame->format);
+        for (uint16_t i = 0; i < p_frame->data_len; i++) p_samples[i] = (uint8_t)bench_rand();
+    }
+
+    // increasing indices: spread the marks over the samples
+    uint8_t index = 0;
+    for (uint8_t i = 0; i < p_frame->n_marks; i++) {
+        uint8_t room = p_frame->n_samples - index - (p_frame->n_marks - i);
+        index += bench_rand() % (room + 1);
+        p_frame->marks[i] = (frame_mark_t){ index++, (uint8_t)bench_rand(), bench_rand() & 0xFFFFFF };
+    }
+    p_frame->p_samples = p_samples;
+}
+
+static bool frame_same(frame_t const *a, frame_t const *b) {
+    bool same = a->seq == b->seq && a->flags == b->flags && a->format == b->format
+             && a->n_samples == b->n_samples && a->n_marks == b->n_marks && a->data_len == b->data_len
+             && memcmp(a->p_samples, b->p_samples, a->data_len) == 0;
+    for (uint8_t i = 0; same && i < a->n_marks; i++) {
+        same = a->marks[i].index == b->marks[i].index && a->marks[i].odr == b->marks[i].odr
+            && a->marks[i].time == b->marks[i].time;
+    }
+    return same;
+}
+
+// samples, feature or activity records of a decoded frame. an accepted
+// record has to code back to the same bytes.
+static bool frame_payload(frame_t const *p_frame, int16_t *p_xyz) {
+    if (p_frame->format == FRAME_FORMAT_ACTIVITY) {
+        for (uint16_t n = 0; n < p_frame->n_samples; n++) {
+            activity_record_t record;
+            uint8_t encoded[ACTIVITY_LEN];
+            if (!activity_decode(&p_frame->p_samples[n * ACTIVITY_LEN], &record)) return false;
+            activity_encode(&record, encoded);
+            if (memcmp(encoded, &p_frame->p_samples[n * ACTIVITY_LEN], ACTIVITY_LEN) != 0) return false;
+        }
+        return true;
+    }
+    if (p_frame->format != FRAME_FORMAT_FEATURES) return frame_samples(p_frame, p_xyz) == FRAME_OK;
+
+    for (uint16_t n = 0; n < p_frame->n_samples; n++) {
+        features_t features;
+        uint8_t record[FEATURES_LEN];
+        if (!features_decode(&p_frame->p_samples[n * FEATURES_LEN], &features)) return false;
+        features_encode(&features, record);
+        if (memcmp(record, &p_frame->p_samples[n * FEATURES_LEN], FEATURES_LEN) != 0) return false;
+    }
+    return true;
+}
+
+// samples of a decoded frame against the plain samples it was made from
+static bool frame_samples_same(frame_t const *p_frame, uint8_t const *p_raw) {
+    static int16_t xyz[3 * FRAME_SAMPLES_MAX];
+    static uint8_t raw[6 * FRAME_SAMPLES_MAX];
+
+    if (!frame_payload(p_frame, xyz)) return false;
+    if (p_frame->format != FRAME_FORMAT_12_BIT_RICE) return true;
+    raw_put(raw, xyz, 3 * p_frame->n_samples);
+    return memcmp(raw, p_raw, 6 * p_frame->n_samples) == 0;
+}
+
+// encode random frames, decode them again. also every sequence number gap
+static bool bench_frame_roundtrip(const char *name) {
+    static uint8_t samples[FRAME_PAYLOAD_LEN];
+    static uint8_t raw[6 * FRAME_SAMPLES_MAX];
+    static uint8_t payload[FRAME_PAYLOAD_LEN];
+    uint32_t bytes = 0;
+    bool match = true;
+
+    for (uint32_t n = 0; n < FRAME_CASES; n++) {
+        frame_t frame, decoded;
+        frame_random(&frame, samples, raw);
+
+        uint16_t len = frame_encode(&frame, payload, sizeof(payload));
+        bytes += len;
+        match &= len > 0 && frame_decode(payload, len, &decoded) == FRAME_OK && frame_same(&frame, &decoded)
+              && frame_samples_same(&decoded, raw);
+    }
+    for (uint16_t last = 0; last < 256; last++) {
+        for (int16_t gap = -128; gap < 128; gap++) {
+            match &= frame_seq_gap((uint8_t)last, (uint8_t)(last + 1 + gap)) == gap;
+        }
+    }
+
+    bench_print(name, "cases", "%u", FRAME_CASES);
+    bench_print(name, "bytes_per_frame", "%.1f", (double)bytes / FRAME_CASES);
+    bench_print(name, "match", "%s", match ? "yes" : "NO");
+    return match;
+}
+
+// an accepted frame has to be consistent with its length and code back to
+// the same bytes
+static bool frame_canonical(frame_t const *p_frame, uint8_t const *p_payload, uint16_t len) {
+    static uint8_t reencoded[FRAME_PAYLOAD_LEN + 16];
+    static int16_t xyz[3 * FRAME_SAMPLES_MAX];
+    static uint8_t raw[6 * FRAME_SAMPLES_MAX];
+    static uint8_t coded[FRAME_PAYLOAD_LEN + 16];
+
+    if (p_frame->p_samples != &p_payload[len - p_frame->data_len]
+        || frame_encode(p_frame, reencoded, sizeof(reencoded)) != len || memcmp(reencoded, p_payload, len) != 0) {
+        return false;
+    }
+    if (p_frame->format != FRAME_FORMAT_12_BIT_RICE) return true;
+
+    uint16_t coded_len;
+    frame_samples(p_frame, xyz);
+    raw_put(raw, xyz, 3 * p_frame->n_samples);
+    return frame_rice_encode(raw, p_frame->n_samples, coded, p_frame->data_len, &coded_len) == p_frame->n_samples
+        && coded_len == p_frame->data_len && memcmp(coded, p_frame->p_samples, coded_len) == 0;
+}
+
+// decode random payloads and valid frames with flipped bits, cut short or
+// run long. whatever decodes has to pass frame_canonical(), everything else
+// has to be rejected
+static bool bench_frame_fuzz(const char *name) {
+    static uint8_t samples[FRAME_PAYLOAD_LEN];
+    static uint8_t raw[6 * FRAME_SAMPLES_MAX];
+    static uint8_t payload[FRAME_PAYLOAD_LEN + 16];
+    static int16_t xyz[3 * FRAME_SAMPLES_MAX];
+    uint32_t accepted = 0;
+    bool match = true;
+
+    for (uint32_t n = 0; n < FRAME_CASES; n++) {
+        uint16_t len;
+        if (n % 4 == 0) {
+            len = bench_rand() % sizeof(payload);
+            for (uint16_t i = 0; i < len; i++) payload[i] = (uint8_t)bench_rand();
+            if (len && bench_rand() % 2) payload[0] = (uint8_t)((FRAME_VERSION << 4) | (payload[0] & 0x0F));
+        } else {
+            frame_t frame;
+            frame_random(&frame, samples, raw);
+            len = frame_encode(&frame, payload, sizeof(payload));
+            switch (n % 4) {
+            case 1: payload[bench_rand() % len] ^= (uint8_t)(1u << (bench_rand() % 8)); break;
+            case 2: len -= bench_rand() % (len + 1); break;
+            case 3: len += bench_rand() % (sizeof(payload) - len + 1); break;
+            }
+        }
+
+        frame_t decoded;
+        if (frame_decode(payload, len, &decoded) != FRAME_OK || !frame_payload(&decoded, xyz)) continue;
+        accepted++;
+        match &= frame_canonical(&decoded, payload, len);
+    }
+
+    bench_print(name, "cases", "%u", FRAME_CASES);
+    bench_print(name, "accepted", "%u", accepted);
+    bench_print(name, "match", "%s", match ? "yes" : "NO");
+    return match;
+}
+
+// Rice coding of the BMA400 motion model's sample streams, cut into
+// notifications like the firmware does: bytes per sample and notifications
+// against the plain 12 bit format, host time to code and decode a sample
+#define CODEC_SAMPLES       6000
+#define CODEC_REPS          50
+
+static uint8_t codec_raw[6 * CODEC_SAMPLES];
+static uint8_t codec_coded[CODEC_SAMPLES / 8 * FRAME_PAYLOAD_LEN];
+static uint8_t codec_frame_samples[CODEC_SAMPLES / 8];
+static uint16_t codec_frame_len[CODEC_SAMPLES / 8];
+
+static uint16_t codec_encode(void) {
+    uint16_t space = FRAME_PAYLOAD_LEN - FRAME_HEADER_LEN;
+    uint16_t n_frames = 0;
+    for (uint16_t pos = 0; pos < CODEC_SAMPLES; n_frames++) {
+        uint16_t n = frame_rice_encode(&codec_raw[6 * pos], (uint8_t)MIN(CODEC_SAMPLES - pos, FRAME_SAMPLES_MAX),
+                                       &codec_coded[n_frames * FRAME_PAYLOAD_LEN], space, &codec_frame_len[n_frames]);
+        codec_frame_samples[n_frames] = (uint8_t)n;
+        pos += n;
+    }
+    return n_frames;
+}
+
+static bool codec_decode(uint16_t n_frames) {
+    static int16_t xyz[3 * CODEC_SAMPLES];
+    frame_t frame = { .format = FRAME_FORMAT_12_BIT_RICE };
+    int16_t *p = xyz;
+    bool ok = true;
+    for (uint16_t i = 0; i < n_frames; i++) {
+        frame.n_samples = codec_frame_samples[i];
+        frame.p_samples = &codec_coded[i * FRAME_PAYLOAD_LEN];
+        frame.data_len = codec_frame_len[i];
+        ok &= frame_samples(&frame, p) == FRAME_OK;
+        p += 3 * frame.n_samples;
+    }
+
+    static uint8_t raw[6 * CODEC_SAMPLES];
+    raw_put(raw, xyz, 3 * CODEC_SAMPLES);
+    return ok && memcmp(raw, codec_raw, sizeof(raw)) == 0;
+}
+
+static bool bench_codec(const char *name, sim_activity_t activity, uint16_t hz) {
+    for (uint16_t n = 0; n < CODEC_SAMPLES; n++) {
+        sim_sample_t sample;
+        sim_bma400_motion(activity, (uint64_t)n * SIM_NS_PER_S / hz, &sample);
+        int16_t xyz[3] = { sample.x, sample.y, sample.z };
+        raw_put(&codec_raw[6 * n], xyz, 3);
+    }
+
+    uint16_t n_frames = 0;
+    double start = bench_ns();
+    for (uint32_t rep = 0; rep < CODEC_REPS; rep++) n_frames = codec_encode();
+    double encode_ns = (bench_ns() - start) / CODEC_REPS / CODEC_SAMPLES;
+    bool match = true;
+    start = bench_ns();
+    for (uint32_t rep = 0; rep < CODEC_REPS; rep++) match &= codec_decode(n_frames);
+    double decode_ns = (bench_ns() - start) / CODEC_REPS / CODEC_SAMPLES;
+
+    uint32_t coded = 0;
+    for (uint16_t i = 0; i < n_frames; i++) coded += codec_frame_len[i];
+    uint16_t plain_frames = CEIL_DIV(CODEC_SAMPLES, (FRAME_PAYLOAD_LEN - FRAME_HEADER_LEN) / 6);
+
+    bench_print(name, "bits_per_sample", "%.1f", 8.0 * coded / CODEC_SAMPLES);
+    bench_print(name, "ratio", "%.2fx", 6.0 * CODEC_SAMPLES / coded);
+    bench_print(name, "notifications", "%u (12 bit: %u)", n_frames, plain_frames);
+    bench_print(name, "encode_ns", "%.1f", encode_ns);
+    bench_print(name, "decode_ns", "%.1f", decode_ns);
+    bench_print(name, "match", "%s", match ? "yes" : "NO");
+    return match;
+}
+
+// on-device features against the reference on windows of the motion model
+// (desk, walking, running at 25 Hz) and on full scale random, square wave and
+// flat windows, which take the 32 bit DFT sums to their limits. host time per
+// window, the DFT multiply-adds it takes and the record against the samples.
+#define FEATURE_WINDOWS     1024
+#define FEATURE_REPS        5
+
+static uint8_t feature_raw[FEATURE_WINDOWS * 6 * FEATURES_WINDOW_MAX];
+
+static void feature_window(uint8_t *p_raw, uint8_t n_samples, uint16_t w) {
+    int16_t xyz[3 * FEATURES_WINDOW_MAX];
+    uint16_t period = 2 + bench_rand() % n_samples;
+    int16_t level = (int16_t)(bench_rand() % 4096) - 2048;
+
+    for (uint16_t n = 0; n < n_samples; n++) {
+        sim_sample_t sample;
+        sim_bma400_motion((sim_activity_t)(SIM_ACTIVITY_DESK + MIN(w % 4, 2)),
+                          ((uint64_t)w * n_samples + n) * SIM_NS_PER_S / 25, &sample);
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            int16_t *p = &xyz[3 * n + axis];
+            switch (w % 4) {
+            case 3:  *p = (int16_t)(bench_rand() % 4096) - 2048; break;
+            default: *p = (axis == 0) ? sample.x : (axis == 1) ? sample.y : sample.z; break;
+            }
+            if (w % 8 == 7) *p = (axis == 2) ? level : ((n / (period / 2 + 1)) % 2) ? 2047 : -2048;
+        }
+    }
+    raw_put(p_raw, xyz, 3 * n_samples);
+}
+
+static bool bench_features(const char *name, uint8_t n_samples) {
+    uint16_t window_len = 6 * n_samples;
+    for (uint16_t w = 0; w < FEATURE_WINDOWS; w++) feature_window(&feature_raw[w * window_len], n_samples, w);
+
+    features_t features;
+    double start = bench_ns();
+    for (uint32_t rep = 0; rep < FEATURE_REPS; rep++) {
+        for (uint16_t w = 0; w < FEATURE_WINDOWS; w++) features_compute(&feature_raw[w * window_len], n_samples, &features);
+    }
+    double window_ns = (bench_ns() - start) / FEATURE_REPS / FEATURE_WINDOWS;
+
+    bool match = true;
+    for (uint16_t w = 0; w < FEATURE_WINDOWS; w++) {
+        int16_t xyz[3 * FEATURES_WINDOW_MAX];
+        uint8_t const *p = &feature_raw[w * window_len];
+        for (uint16_t i = 0; i < 3 * n_samples; i++) xyz[i] = (int16_t)(p[2 * i] | (p[2 * i + 1] << 8));
+
+        features_t ref, decoded;
+        uint8_t record[FEATURES_LEN], ref_record[FEATURES_LEN];
+        features_compute(p, n_samples, &features);
+        features_encode(&features, record);
+        sim_features_reference(xyz, n_samples, &ref);
+        features_encode(&ref, ref_record);
+        match &= memcmp(record, ref_record, FEATURES_LEN) == 0 && features_decode(record, &decoded);
+    }
+
+    bench_print(name, "windows", "%u", FEATURE_WINDOWS);
+    bench_print(name, "ns_window", "%.0f", window_ns);
+    bench_print(name, "dft_macs", "%u", 3 * n_samples * n_samples / 2);
+    bench_print(name, "bytes", "%u (12 bit: %u)", FEATURES_LEN, window_len);
+    bench_print(name, "match", "%s", match ? "yes" : "NO");
+    return match;
+}
+
+// the compiled-in model on the held-out windows of one length, from the
+// motion model or the --data recording: accuracy, host time per inference
+// (inputs and tree walk, the features excluded) and the nodes it visits --
+// on the nRF52811 a node is a few loads, a compare and a branch.
+#define CLASSIFY_REPS       200
+
+static uint8_t model_nodes(int32_t const *p_inputs) {
+    uint8_t i = 0, n = 1;
+    for (; classifier_model[i].input != CLASSIFIER_LEAF; n++) {
+        i = (p_inputs[classifier_model[i].input] <= classifier_model[i].threshold) ? i + 1 : classifier_model[i].right;
+    }
+    return n;
+}
+
+static void bench_classifier(const char *name, sim_dataset_t const *p_set, uint8_t n_samples) {
+    uint32_t n_windows = 0, correct = 0, nodes = 0;
+    uint8_t nodes_max = 0;
+    volatile uint8_t sink = 0;
+
+    for (uint32_t i = 0; i < p_set->n_windows; i++) {
+        sim_window_t const *p_window = &p_set->p_windows[i];
+        if (p_window->features.window != n_samples) continue;
+
+        int32_t inputs[CLASSIFIER_INPUTS];
+        classifier_inputs(&p_window->features, p_window->odr_ticks, inputs);
+        uint8_t n = model_nodes(inputs);
+        n_windows++;
+        correct += classifier_run(&p_window->features, p_window->odr_ticks) == p_window->activity;
+        nodes += n;
+        nodes_max = MAX(nodes_max, n);
+    }
+    if (n_windows == 0) return;
+
+    double start = bench_ns();
+    for (uint32_t rep = 0; rep < CLASSIFY_REPS; rep++) {
+        for (uint32_t i = 0; i < p_set->n_windows; i++) {
+            sim_window_t const *p_window = &p_set->p_windows[i];
+            if (p_window->features.window == n_samples) sink += classifier_run(&p_window->features, p_window->odr_ticks);
+        }
+    }
+    double inference_ns = (bench_ns() - start) / CLASSIFY_REPS / n_windows;
+
+    bench_print(name, "windows", "%" PRIu32, n_windows);
+    bench_print(name, "accuracy", "%.1f%%", 100.0 * correct / n_windows);
+    bench_print(name, "ns_inference", "%.1f", inference_ns);
+    bench_print(name, "nodes_avg", "%.2f", (double)nodes / n_windows);
+    bench_print(name, "nodes_max", "%u", nodes_max);
+}
+
+int sim_bench_run(void) {
+    bool match = bench_pipeline("pipeline", BENCH_FRAMES, false);
+    match &= bench_pipeline("pipeline8", BENCH_FRAMES_8_BIT, true);
+    bench_spi_clock("spiclock", 16, false);
+    bench_spi_clock("spiclock8", 16, true);
+    match &= bench_frame_roundtrip("frame");
+    match &= bench_frame_fuzz("framefuzz");
+    match &= bench_codec("ricedesk", SIM_ACTIVITY_DESK, 25);
+    match &= bench_codec("ricewalk", SIM_ACTIVITY_WALKING, 25);
+    match &= bench_codec("ricerun", SIM_ACTIVITY_RUNNING, 25);
+    match &= bench_codec("ricerun100", SIM_ACTIVITY_RUNNING, 100);
+    match &= bench_features("features16", 16);
+    match &= bench_features("features32", 32);
+    match &= bench_features("features64", 64);
+    match &= bench_features("features128", 128);
+
+    sim_dataset_t train, test;
+    if (!sim_dataset_build(&train, &test)) return 1;
+    bench_print("classify", "model_bytes", "%zu (%u nodes)", classifier_model_len * sizeof(classifier_node_t),
+                classifier_model_len);
+    bench_classifier("classify16", &test, 16);
+    bench_classifier("classify32", &test, 32);
+    bench_classifier("classify64", &test, 64);
+    bench_classifier("classify128", &test, 128);
+    sim_dataset_free(&train);
+    sim_dataset_free(&test);
+    return match ? 0 : 1;
+}
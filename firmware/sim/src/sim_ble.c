@@ -0,0 +1,192 @@
+/**
+ * host simulator -- BLE link model, replaces app_ble_nus.c
+ *
+ * a central connects shortly after advertising starts, exchanges the MTU and
+ * enables notifications. notifications are queued like the SoftDevice
+ * (hvn_tx_queue_size) and leave the device on the next connection event, as
+ * many as fit into the event length (NRF_SDH_BLE_GAP_EVENT_LENGTH). before
+ * subscribing, the central writes the sample format (--format) to the RX
+ * characteristic. --link-errors makes the central miss notifications and see
+ * others twice, which the frame sequence numbers have to reveal.
+ */
+
+#include "sim.h"
+#include "app_ble_nus.h"
+#include "app_callbacks.h"
+#include "app_accelerometer.h"
+
+#include <string.h>
+
+#define BLE_CONNECT_DELAY_NS        SIM_MS(600)     // ~30 advertising events at 20ms
+#define BLE_MTU_EXCHANGE_DELAY_NS   SIM_MS(100)
+#define BLE_COMM_START_DELAY_NS     SIM_MS(400)     // discovery + CCCD write
+#define BLE_SETUP_WINDOW_NS         (BLE_CONNECT_DELAY_NS + BLE_COMM_START_DELAY_NS)
+#define BLE_CONN_INTERVAL_NS        ((uint64_t)MAX_CONN_INTERVAL * 1250 * SIM_NS_PER_US / 1000)
+#define BLE_EVENT_LENGTH_NS         ((uint64_t)NRF_SDH_BLE_GAP_EVENT_LENGTH * 1250 * SIM_NS_PER_US)
+#define BLE_ATT_MTU_DEFAULT         23
+#define BLE_NOTIFICATION_MAX_LEN    (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3)
+#define BLE_PACKET_OVERHEAD         17      // preamble, access address, header, L2CAP, ATT, CRC
+#define BLE_PACKET_TURNAROUND_NS    SIM_US(150 + 80 + 150)  // IFS, empty ack, IFS
+
+// 1M PHY air time of one notification including the central's ack
+#define BLE_PACKET_AIR_NS(len)      (SIM_US(8 * ((len) + BLE_PACKET_OVERHEAD)) + BLE_PACKET_TURNAROUND_NS)
+
+static bool ble_advertising = false;
+static bool ble_connected = false;
+static bool ble_notifications_en = false;
+static uint16_t ble_max_data_len = BLE_ATT_MTU_DEFAULT - 3;
+static uint64_t conn_anchor_ns = 0;
+
+static struct {
+    uint8_t data[BLE_NOTIFICATION_MAX_LEN];
+    uint16_t length;
+} tx_queue[BLE_HVN_TX_QUEUE_SIZE];
+static uint8_t tx_queue_count = 0;
+static bool tx_event_pending = false;
+static uint32_t link_noise_state = 0;
+
+WEAK_CALLBACK_DATA_DEF(BLE_NUS_EVT_RX_DATA)
+WEAK_CALLBACK_DEF(BLE_NUS_EVT_TX_RDY)
+WEAK_CALLBACK_DEF(BLE_NUS_EVT_COMM_STARTED)
+WEAK_CALLBACK_DEF(BLE_GAP_EVT_CONNECTED)
+WEAK_CALLBACK_DEF(BLE_GAP_EVT_DISCONNECTED)
+WEAK_CALLBACK_DEF(NRF_BLE_GATT_EVT_ATT_MTU_UPDATED)
+
+// link events ----------------------------------------------------------------
+
+// the central configures the stream in writes to the RX characteristic, one
+// command each, back to back before the firmware handles the first
+static void on_comm_started(void *p_context) {
+    if (sim_config.window) {
+        uint8_t cmd_window[] = { BLE_CMD_SET_WINDOW, sim_config.window };
+        CALLBACK_FUNC(BLE_NUS_EVT_RX_DATA)(cmd_window, sizeof(cmd_window));
+    }
+    uint8_t cmd_format[] = { BLE_CMD_SET_FORMAT, sim_config.format };
+    CALLBACK_FUNC(BLE_NUS_EVT_RX_DATA)(cmd_format, sizeof(cmd_format));
+
+    ble_notifications_en = true;
+    sim_energy_ble_setup_done();
+    CALLBACK_FUNC(BLE_NUS_EVT_COMM_STARTED)();
+}
+
+static void on_mtu_updated(void *p_context) {
+    ble_max_data_len = BLE_NOTIFICATION_MAX_LEN;
+    CALLBACK_FUNC(NRF_BLE_GATT_EVT_ATT_MTU_UPDATED)();
+}
+
+static void on_connected(void *p_context) {
+    ble_advertising = false;
+    ble_connected = true;
+    conn_anchor_ns = sim_time_ns();
+    CALLBACK_FUNC(BLE_GAP_EVT_CONNECTED)();
+
+    sim_event_schedule(BLE_MTU_EXCHANGE_DELAY_NS, on_mtu_updated, NULL);
+    sim_event_schedule(BLE_COMM_START_DELAY_NS, on_comm_started, NULL);
+}
+
+// deterministic per power-on, uniform in [0, 100)
+static double link_noise_pct(void) {
+    if (link_noise_state == 0) link_noise_state = sim_config.seed + sim_stats.boots;
+    link_noise_state = link_noise_state * 1664525u + 1013904223u;
+    return (link_noise_state >> 8) * (100.0 / (1u << 24));
+}
+
+// hand a notification to the host, subject to --link-errors
+static void link_deliver(uint8_t const *data, uint16_t length) {
+    if (sim_config.link_error_pct > 0.0 && link_noise_pct() < sim_config.link_error_pct) {
+        sim_stats.ble_link_lost++;
+        return;
+    }
+    sim_host_receive(data, length);
+    if (sim_config.link_error_pct > 0.0 && link_noise_pct() < sim_config.link_error_pct) {
+        sim_stats.ble_link_repeated++;
+        sim_host_receive(data, length);
+    }
+}
+
+static void schedule_connection_event(void);
+
+// queued notifications go out at the next connection event until the event
+// length is used up, the rest waits for the following one
+static void on_connection_event(void *p_context) {
+    uint64_t air_ns = 0;
+    uint8_t n_sent = 0;
+
+    tx_event_pending = false;
+    sim_stats.ble_tx_events++;
+    sim_energy_ble_event();
+    while (n_sent < tx_queue_count) {
+        air_ns += BLE_PACKET_AIR_NS(tx_queue[n_sent].length);
+        if (n_sent > 0 && air_ns > BLE_EVENT_LENGTH_NS) break;
+
+        sim_energy_ble_notification(tx_queue[n_sent].length);
+        link_deliver(tx_queue[n_sent].data, tx_queue[n_sent].length);
+        n_sent++;
+    }
+
+    tx_queue_count -= n_sent;
+    memmove(tx_queue, &tx_queue[n_sent], tx_queue_count * sizeof(tx_queue[0]));
+    if (tx_queue_count) schedule_connection_event();
+    CALLBACK_FUNC(BLE_NUS_EVT_TX_RDY)();
+}
+
+static void schedule_connection_event(void) {
+    if (tx_event_pending) return;
+
+    uint64_t since_anchor = sim_time_ns() - conn_anchor_ns;
+    uint64_t next_ns = conn_anchor_ns + (since_anchor / BLE_CONN_INTERVAL_NS + 1) * BLE_CONN_INTERVAL_NS;
+    sim_event_schedule_at(next_ns, on_connection_event, NULL);
+    tx_event_pending = true;
+}
+
+// app_ble_nus.h --------------------------------------------------------------
+
+void ble_all_services_init(void) {
+    sim_energy_ble_setup(BLE_SETUP_WINDOW_NS);
+}
+
+void advertising_start(bool erase_bonds) {
+    if (ble_advertising || ble_connected) return;
+    ble_advertising = true;
+    sim_event_schedule(BLE_CONNECT_DELAY_NS, on_connected, NULL);
+}
+
+void advertising_stop(void) {
+    ble_advertising = false;
+}
+
+ret_code_t ble_send(uint8_t *data, uint16_t length) {
+    if (!ble_connected || !ble_notifications_en) {
+        sim_stats.ble_send_errors++;
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (length > ble_max_data_len) {
+        sim_stats.ble_send_errors++;
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (tx_queue_count == BLE_HVN_TX_QUEUE_SIZE) {
+        sim_stats.ble_queue_full++;
+        return NRF_ERROR_RESOURCES;
+    }
+
+    memcpy(tx_queue[tx_queue_count].data, data, length);
+    tx_queue[tx_queue_count].length = length;
+    tx_queue_count++;
+    sim_latency_stop();
+
+    sim_stats.ble_notifications++;
+    sim_stats.ble_payload_bytes += length;
+    schedule_connection_event();
+    return NRF_SUCCESS;
+}
+
+uint16_t ble_get_max_data_len(void) {
+    return ble_max_data_len;
+}
+
+void ble_disconnect(bool stop_advertising) {
+    if (!ble_connected) return;
+    ble_connected = ble_notifications_en = false;
+    CALLBACK_FUNC(BLE_GAP_EVT_DISCONNECTED)();
+    if (stop_advertising) advertising_stop();
+}
@@ -0,0 +1,385 @@
+/**
+ * host simulator -- register level BMA400 model
+ *
+ * models the registers used by the bma400 driver, the 1 KB FIFO filled at the
+ * configured ODR while in normal mode, and the FIFO watermark/full interrupts
+ * on INT1/INT2. samples are taken on the sensor time grid (25.6 kHz, one
+ * every 2048 >> (odr - 12.5 Hz) ticks), like the part. SPI framing follows the datasheet: the first byte is the
+ * register address (MSB set for reads), reads return one dummy byte before the
+ * register data, bursts auto-increment except on FIFO_DATA.
+ */
+
+#include "sim.h"
+#include "app_common.h"
+#include "bma400_defs.h"
+
+#include <math.h>
+#include <string.h>
+
+#define BMA_REG_COUNT           0x80
+#define BMA_FIFO_SIZE           1024
+#define BMA_SENSORTIME_HZ       25600
+#define BMA_SAMPLE_LOG_SIZE     4096
+
+// register addresses without a BMA400_REG_* define
+#define REG_SENSOR_TIME_0       0x0A
+#define REG_INT_STAT0           0x0E
+#define REG_INT_CONFIG_1        0x20
+#define REG_INT2_MAP            0x22
+#define REG_FIFO_CONFIG_1       0x27
+#define REG_FIFO_CONFIG_2       0x28
+
+#define INT_FIFO_FULL           0x20
+#define INT_FIFO_WM             0x40
+
+static uint8_t regs[BMA_REG_COUNT];
+static bool int1_asserted = false;
+static bool wm_asserted = false;
+
+static uint8_t fifo[BMA_FIFO_SIZE];
+static uint16_t fifo_len = 0;
+
+static uint32_t odr_event_id = SIM_EVENT_INVALID;
+static uint64_t odr_start_ns = 0;
+static uint32_t odr_count = 0;
+
+static sim_sample_t sample_log[BMA_SAMPLE_LOG_SIZE];
+static uint32_t sample_index = 0;
+static uint32_t noise_state = 1;
+
+static uint32_t sensortime_now(void) {
+    return (uint32_t)(sim_time_ns() * BMA_SENSORTIME_HZ / SIM_NS_PER_S) & 0xFFFFFF;
+}
+
+// motion model ---------------------------------------------------------------
+
+// deterministic noise in [-1, 1)
+static float noise(void) {
+    noise_state = noise_state * 1664525u + 1013904223u;
+    return (float)(int32_t)noise_state / 2147483648.0f;
+}
+
+// synthetic wrist motion (mg): x/z follow the steps, y the arm swing
+typedef struct {
+    float step_hz;
+    float x_mg;
+    float y_mg;
+    float z_mg;
+} motion_profile_t;
+
+static const motion_profile_t motion_profiles[SIM_ACTIVITY_COUNT] = {
+    [SIM_ACTIVITY_NONE]    = { .step_hz = 1.8f, .x_mg = 200.0f, .y_mg = 100.0f, .z_mg = 300.0f },
+    [SIM_ACTIVITY_DESK]    = { .step_hz = 0.3f, .x_mg = 30.0f,  .y_mg = 20.0f,  .z_mg = 20.0f },
+    [SIM_ACTIVITY_WALKING] = { .step_hz = 1.8f, .x_mg = 200.0f, .y_mg = 100.0f, .z_mg = 300.0f },
+    [SIM_ACTIVITY_RUNNING] = { .step_hz = 2.8f, .x_mg = 700.0f, .y_mg = 350.0f, .z_mg = 900.0f },
+};
+
+static void motion_mg(sim_activity_t activity, uint64_t t_ns, float *x, float *y, float *z) {
+    const motion_profile_t *p = &motion_profiles[activity];
+    float t = (float)((double)t_ns / SIM_NS_PER_S);
+    const float two_pi = 6.2831853f;
+
+    *x =  p->x_mg * sinf(two_pi * p->step_hz * t)                + 20.0f * noise();
+    *y =  p->y_mg * sinf(two_pi * 0.5f * p->step_hz * t + 0.5f) + 20.0f * noise();
+    *z = 1000.0f + p->z_mg * sinf(two_pi * p->step_hz * t + 1.0f) + 20.0f * noise();
+}
+
+static int16_t mg_to_lsb(float mg, uint8_t range) {
+    // 12 bit two's complement over +-2/4/8/16 g
+    float lsb_per_g = 1024.0f / (float)(1 << range);
+    float lsb = lrintf(mg * lsb_per_g / 1000.0f);
+    return (int16_t)fmaxf(-2048.0f, fminf(2047.0f, lsb));
+}
+
+// the motion model on its own, at +-4 g, for the benchmark's sample streams
+void sim_bma400_motion(sim_activity_t activity, uint64_t t_ns, sim_sample_t *p_sample) {
+    float x, y, z;
+    motion_mg(activity, t_ns, &x, &y, &z);
+    *p_sample = (sim_sample_t){ mg_to_lsb(x, BMA400_RANGE_4G), mg_to_lsb(y, BMA400_RANGE_4G),
+                                mg_to_lsb(z, BMA400_RANGE_4G), 0 };
+}
+
+// interrupts -----------------------------------------------------------------
+
+static uint16_t fifo_watermark(void) {
+    return ((uint16_t)(regs[REG_FIFO_CONFIG_2] & BMA400_FIFO_BYTES_CNT_MSK) << 8)
+           | regs[REG_FIFO_CONFIG_1];
+}
+
+static void update_interrupts(void) {
+    uint8_t status = 0;
+
+    if (fifo_len >= BMA_FIFO_SIZE - 7) status |= INT_FIFO_FULL;
+    if (fifo_watermark() > 0 && fifo_len >= fifo_watermark()) status |= INT_FIFO_WM;
+    status &= regs[BMA400_REG_INT_CONF_0];
+    regs[REG_INT_STAT0] = status;
+
+    bool wm = (status & INT_FIFO_WM) != 0;
+    if (wm && !wm_asserted) sim_stats.bma_watermark_irqs++;
+    wm_asserted = wm;
+
+    // INT12_IO_CTRL: int1_lvl is bit 1, int2_lvl is bit 5 (1 = active high)
+    bool int1 = (status & regs[BMA400_REG_INT_MAP]) != 0;
+    bool int2 = (status & regs[REG_INT2_MAP]) != 0;
+    bool int1_active_high = (regs[BMA400_REG_INT_12_IO_CTRL] & 0x02) != 0;
+    bool int2_active_high = (regs[BMA400_REG_INT_12_IO_CTRL] & 0x20) != 0;
+
+    if (int1 && !int1_asserted) sim_latency_start();
+    int1_asserted = int1;
+
+    sim_gpio_input_set(IMU_INT1, int1 == int1_active_high);
+    sim_gpio_input_set(IMU_INT2, int2 == int2_active_high);
+}
+
+// fifo -----------------------------------------------------------------------
+
+static uint8_t frame_length(uint8_t header) {
+    uint8_t axes = ((header & 0x02) ? 1 : 0) + ((header & 0x04) ? 1 : 0) + ((header & 0x08) ? 1 : 0);
+    return 1 + axes * ((header & 0x10) ? 2 : 1);
+}
+
+static uint16_t fifo_frames(uint16_t n_bytes) {
+    uint16_t n_frames = 0;
+    for (uint16_t pos = 0; pos < n_bytes; pos += frame_length(fifo[pos])) n_frames++;
+    return n_frames;
+}
+
+// frames thrown away unread are lost to the host
+static void fifo_flush(void) {
+    sim_stats.bma_frames_flushed += fifo_frames(fifo_len);
+    fifo_len = 0;
+    update_interrupts();
+}
+
+static void fifo_drop_frame(void) {
+    uint8_t len = frame_length(fifo[0]);
+    memmove(fifo, &fifo[len], fifo_len - len);
+    fifo_len -= len;
+}
+
+static void fifo_push_sample(const sim_sample_t *p_sample) {
+    uint8_t conf = regs[BMA400_REG_FIFO_CONFIG_0];
+    uint8_t axes = conf & (BMA400_FIFO_X_EN | BMA400_FIFO_Y_EN | BMA400_FIFO_Z_EN);
+    if (axes == 0) return;
+
+    bool is_12_bit = (conf & BMA400_FIFO_8_BIT_EN) == 0;
+    uint8_t frame[7];
+    uint8_t len = 0;
+
+    frame[len++] = 0x80 | (axes >> 4) | (is_12_bit ? 0x10 : 0x00);
+    const int16_t values[3] = { p_sample->x, p_sample->y, p_sample->z };
+    for (uint8_t i = 0; i < 3; i++) {
+        if ((axes & (BMA400_FIFO_X_EN << i)) == 0) continue;
+        uint16_t v = (uint16_t)values[i] & 0x0FFF;
+        if (is_12_bit) frame[len++] = v & 0x0F;
+        frame[len++] = (uint8_t)(v >> 4);
+    }
+
+    if (fifo_len + len > BMA_FIFO_SIZE) {
+        if (conf & BMA400_FIFO_STOP_ON_FULL) {
+            sim_stats.bma_samples_dropped++;
+            return;
+        }
+        // stream mode: oldest frames are overwritten
+        while (fifo_len + len > BMA_FIFO_SIZE) {
+            fifo_drop_frame();
+            sim_stats.bma_samples_dropped++;
+        }
+    }
+
+    memcpy(&fifo[fifo_len], frame, len);
+    fifo_len += len;
+}
+
+static uint8_t fifo_read_byte(uint16_t *p_read_pos, bool *p_time_sent) {
+    if (*p_read_pos < fifo_len) return fifo[(*p_read_pos)++];
+
+    // FIFO empty: optionally one sensor time frame, then empty frames
+    uint16_t over = *p_read_pos - fifo_len;
+    (*p_read_pos)++;
+    if ((regs[BMA400_REG_FIFO_CONFIG_0] & BMA400_FIFO_TIME_EN) && !*p_time_sent) {
+        uint32_t sensortime = sensortime_now();
+        uint8_t frame[4] = { BMA400_FIFO_SENSOR_TIME, sensortime & 0xFF,
+                             (sensortime >> 8) & 0xFF, (sensortime >> 16) & 0xFF };
+        if (over == 3) *p_time_sent = true;
+        return frame[over];
+    }
+    return ((over - (*p_time_sent ? 4 : 0)) % 2 == 0) ? BMA400_FIFO_EMPTY_FRAME : 0x00;
+}
+
+// frames only leave the FIFO once they have been read completely
+static void fifo_consume(uint16_t n_read) {
+    uint16_t consumed = 0;
+    while (consumed < fifo_len) {
+        uint8_t len = frame_length(fifo[consumed]);
+        if (consumed + len > n_read) break;
+        consumed += len;
+    }
+
+    sim_stats.bma_fifo_bytes_read += consumed;
+    sim_stats.bma_fifo_frames_read += fifo_frames(consumed);
+    memmove(fifo, &fifo[consumed], fifo_len - consumed);
+    fifo_len -= consumed;
+    update_interrupts();
+}
+
+// data generation ------------------------------------------------------------
+
+static uint64_t odr_period_ns(void) {
+    // 12.5 Hz << (odr - BMA400_ODR_12_5HZ)
+    uint8_t odr = regs[BMA400_REG_ACCEL_CONFIG_1] & BMA400_ACCEL_ODR_MSK;
+    odr = MAX(odr, BMA400_ODR_12_5HZ);
+    return SIM_MS(80) >> (odr - BMA400_ODR_12_5HZ);
+}
+
+static void odr_tick(void *p_context) {
+    float x, y, z;
+    uint8_t range = BMA400_GET_BITS(regs[BMA400_REG_ACCEL_CONFIG_1], BMA400_ACCEL_RANGE);
+    motion_mg(sim_harvest_activity(sim_time_ns()), sim_time_ns(), &x, &y, &z);
+
+    sim_sample_t sample = { mg_to_lsb(x, range), mg_to_lsb(y, range), mg_to_lsb(z, range), sensortime_now() };
+    sample_log[sample_index % BMA_SAMPLE_LOG_SIZE] = sample;
+    sample_index++;
+    sim_stats.bma_samples_generated++;
+
+    fifo_push_sample(&sample);
+    update_interrupts();
+
+    odr_count++;
+    odr_event_id = sim_event_schedule_at(odr_start_ns + (odr_count + 1) * odr_period_ns(),
+                                         odr_tick, NULL);
+}
+
+static void set_power_mode(uint8_t mode) {
+    uint8_t prev = regs[BMA400_REG_ACCEL_CONFIG_0] & BMA400_POWER_MODE_MSK;
+    if (mode == prev) return;
+
+    regs[BMA400_REG_STATUS] = (regs[BMA400_REG_STATUS] & ~BMA400_POWER_MODE_STATUS_MSK)
+                            | (mode << BMA400_POWER_MODE_STATUS_POS);
+    if (regs[BMA400_REG_FIFO_CONFIG_0] & BMA400_FIFO_AUTO_FLUSH) fifo_flush();
+
+    sim_energy_bma400_active(mode == BMA400_MODE_NORMAL);
+    sim_event_cancel(odr_event_id);
+    odr_event_id = SIM_EVENT_INVALID;
+    if (mode == BMA400_MODE_NORMAL) {
+        odr_start_ns = sim_time_ns() / odr_period_ns() * odr_period_ns();
+        odr_count = 0;
+        odr_event_id = sim_event_schedule_at(odr_start_ns + odr_period_ns(), odr_tick, NULL);
+    }
+}
+
+// registers ------------------------------------------------------------------
+
+static void reset_registers(void) {
+    memset(regs, 0, sizeof(regs));
+    regs[BMA400_REG_CHIP_ID] = BMA400_CHIP_ID;
+    regs[BMA400_REG_ACCEL_CONFIG_1] = 0x49;
+    regs[BMA400_REG_ACCEL_CONFIG_2] = 0x00;
+    regs[BMA400_REG_INT_12_IO_CTRL] = 0x22;
+    regs[BMA400_REG_FIFO_CONFIG_0] = 0x00;
+    regs[REG_FIFO_CONFIG_1] = 0x00;
+    regs[REG_FIFO_CONFIG_2] = 0x00;
+    fifo_len = 0;
+}
+
+static void write_register(uint8_t addr, uint8_t value) {
+    switch (addr) {
+    case BMA400_REG_CHIP_ID:
+    case BMA400_REG_STATUS:
+    case BMA400_REG_FIFO_LENGTH:
+    case BMA400_REG_FIFO_LENGTH + 1:
+    case BMA400_REG_FIFO_DATA:
+        return;     // read only
+    case BMA400_REG_ACCEL_CONFIG_0:
+        set_power_mode(value & BMA400_POWER_MODE_MSK);
+        break;
+    case BMA400_REG_COMMAND:
+        if (value == BMA400_FIFO_FLUSH_CMD) fifo_flush();
+        if (value == BMA400_SOFT_RESET_CMD) {
+            set_power_mode(BMA400_MODE_SLEEP);
+            reset_registers();
+            update_interrupts();
+        }
+        return;
+    default:
+        break;
+    }
+
+    regs[addr] = value;
+    update_interrupts();
+}
+
+static uint8_t read_register(uint8_t addr) {
+    switch (addr) {
+    case BMA400_REG_FIFO_LENGTH:
+        return fifo_len & 0xFF;
+    case BMA400_REG_FIFO_LENGTH + 1:
+        return (fifo_len >> 8) & BMA400_FIFO_BYTES_CNT_MSK;
+    case REG_SENSOR_TIME_0:
+    case REG_SENSOR_TIME_0 + 1:
+    case REG_SENSOR_TIME_0 + 2:
+        return (sensortime_now() >> (8 * (addr - REG_SENSOR_TIME_0))) & 0xFF;
+    default:
+        return regs[addr & (BMA_REG_COUNT - 1)];
+    }
+}
+
+// public ---------------------------------------------------------------------
+
+void sim_bma400_init(void) {
+    noise_state = sim_config.seed ? sim_config.seed : 1;
+    reset_registers();
+}
+
+// one chip-select framed transaction
+void sim_bma400_xfer(uint8_t const *tx, size_t tx_len, uint8_t *rx, size_t rx_len, uint8_t orc) {
+    size_t len = MAX(tx_len, rx_len);
+    if (len == 0) return;
+
+    uint8_t cmd = (tx_len > 0) ? tx[0] : orc;
+    uint8_t addr = cmd & ~BMA400_SPI_RD_MASK;
+    bool is_read = (cmd & BMA400_SPI_RD_MASK) != 0;
+
+    if (rx_len > 0) rx[0] = 0xFF;
+
+    if (!is_read) {
+        for (size_t i = 1; i < len; i++) {
+            write_register(addr, (i < tx_len) ? tx[i] : orc);
+            addr = (addr + 1) & (BMA_REG_COUNT - 1);
+        }
+        for (size_t i = 1; i < rx_len; i++) rx[i] = 0xFF;
+        return;
+    }
+
+    // byte 1 is the dummy byte, register data starts at byte 2. a burst that
+    // reaches FIFO_DATA stays there and streams the FIFO
+    if (rx_len > 1) rx[1] = 0x00;
+    if (len > 2 && addr <= BMA400_REG_FIFO_DATA && addr + len - 3 >= BMA400_REG_FIFO_LENGTH) sim_stats.bma_fifo_xfers++;
+
+    size_t i = 2;
+    for (; i < len && addr != BMA400_REG_FIFO_DATA; i++) {
+        uint8_t value = read_register(addr);
+        if (i < rx_len) rx[i] = value;
+        addr = (addr + 1) & (BMA_REG_COUNT - 1);
+    }
+    if (i == len) return;
+
+    uint16_t read_pos = 0;
+    bool time_sent = false;
+    size_t fifo_start = i;
+    for (; i < len; i++) {
+        uint8_t value = fifo_read_byte(&read_pos, &time_sent);
+        if (i < rx_len) rx[i] = value;
+    }
+    // clocks spent on partial frames (sent again) and on an empty FIFO
+    uint16_t fifo_len_before = fifo_len;
+    fifo_consume(MIN(read_pos, fifo_len));
+    sim_stats.bma_fifo_wasted_bytes += (uint32_t)(len - fifo_start) - (fifo_len_before - fifo_len);
+}
+
+// look up a generated sample by its index. false once it has aged out.
+bool sim_bma400_sample_lookup(uint32_t index, sim_sample_t *p_sample) {
+    if (index >= sample_index || sample_index - index > BMA_SAMPLE_LOG_SIZE) return false;
+    *p_sample = sample_log[index % BMA_SAMPLE_LOG_SIZE];
+    return true;
+}
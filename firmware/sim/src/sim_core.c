@@ -0,0 +1,155 @@
+/**
+ * host simulator core -- simulated time, event queue and power management
+ */
+
+#include "sim.h"
+#include "nrf_pwr_mgmt.h"
+#include "nrf_sdh.h"
+#include "app_error.h"
+#include "nrf_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <inttypes.h>
+
+typedef struct {
+    uint64_t time_ns;
+    uint32_t id;
+    sim_event_fn_t fn;
+    void *p_context;
+    bool wake;                  // raises an interrupt
+} sim_event_t;
+
+static sim_event_t event_queue[SIM_EVENT_QUEUE_SIZE];
+static uint32_t event_count = 0;
+static uint32_t event_next_id = 1;
+static uint64_t now_ns = 0;
+
+// time -----------------------------------------------------------------------
+
+uint64_t sim_time_ns(void) {
+    return now_ns;
+}
+
+void sim_time_restore(uint64_t time_ns) {
+    now_ns = time_ns;
+}
+
+// events ---------------------------------------------------------------------
+
+static uint32_t event_add(uint64_t time_ns, sim_event_fn_t fn, void *p_context, bool wake) {
+    if (event_count == SIM_EVENT_QUEUE_SIZE) {
+        fprintf(stderr, "sim: event queue overflow\n");
+        sim_finish(EXIT_FAILURE);
+    }
+
+    // ids are also the tie breaker for events at the same time (FIFO order)
+    sim_event_t *p_evt = &event_queue[event_count++];
+    p_evt->time_ns = (time_ns > now_ns) ? time_ns : now_ns;
+    p_evt->id = event_next_id++;
+    p_evt->fn = fn;
+    p_evt->p_context = p_context;
+    p_evt->wake = wake;
+    return p_evt->id;
+}
+
+uint32_t sim_event_schedule_at(uint64_t time_ns, sim_event_fn_t fn, void *p_context) {
+    return event_add(time_ns, fn, p_context, true);
+}
+
+uint32_t sim_event_schedule(uint64_t delay_ns, sim_event_fn_t fn, void *p_context) {
+    return event_add(now_ns + delay_ns, fn, p_context, true);
+}
+
+// model time steps that do not wake the CPU, such as an analog comparator
+// following v_store
+uint32_t sim_event_schedule_silent(uint64_t delay_ns, sim_event_fn_t fn, void *p_context) {
+    return event_add(now_ns + delay_ns, fn, p_context, false);
+}
+
+void sim_event_cancel(uint32_t event_id) {
+    for (uint32_t i = 0; i < event_count; i++) {
+        if (event_queue[i].id == event_id) {
+            event_queue[i] = event_queue[--event_count];
+            return;
+        }
+    }
+}
+
+// run the earliest pending event. returns false if nothing is pending.
+// *p_wake tells whether it woke the CPU.
+bool sim_event_step(bool *p_wake) {
+    if (event_count == 0) return false;
+
+    uint32_t next = 0;
+    for (uint32_t i = 1; i < event_count; i++) {
+        if ((event_queue[i].time_ns < event_queue[next].time_ns) ||
+            (event_queue[i].time_ns == event_queue[next].time_ns &&
+             event_queue[i].id < event_queue[next].id)) {
+            next = i;
+        }
+    }
+
+    sim_event_t evt = event_queue[next];
+    if (evt.time_ns > sim_config.duration_ns) {
+        now_ns = sim_config.duration_ns;
+        sim_finish(EXIT_SUCCESS);
+    }
+
+    event_queue[next] = event_queue[--event_count];
+    now_ns = evt.time_ns;
+    sim_energy_update();
+    evt.fn(evt.p_context);
+    *p_wake = evt.wake;
+    return true;
+}
+
+// power management -----------------------------------------------------------
+
+ret_code_t nrf_pwr_mgmt_init(void) {
+    return NRF_SUCCESS;
+}
+
+// sleep until the next hardware event and run its handler
+void nrf_pwr_mgmt_run(void) {
+    sim_stats.cpu_wakeups++;
+    if (sim_sched_in_handler()) sim_stats.sched_blocking_wakeups++;
+    for (bool wake = false; !wake;) {
+        if (!sim_event_step(&wake)) {
+            fprintf(stderr, "sim: firmware is waiting but no events are pending\n");
+            sim_finish(EXIT_FAILURE);
+        }
+    }
+    sim_energy_cpu_wake();
+}
+
+void nrf_pwr_mgmt_shutdown(nrf_pwr_mgmt_shutdown_t shutdown_type) {
+    sim_log("(sim) shutdown requested (%d)", (int)shutdown_type);
+    sim_finish(EXIT_SUCCESS);
+}
+
+// softdevice / error handling ------------------------------------------------
+
+ret_code_t nrf_sdh_enable_request(void) {
+    return NRF_SUCCESS;
+}
+
+void app_error_handler(ret_code_t error_code, uint32_t line_num, const uint8_t *p_file_name) {
+    fprintf(stderr, "sim: app error 0x%08" PRIX32 " at %s:%" PRIu32 "\n",
+            error_code, (const char *)p_file_name, line_num);
+    sim_finish(EXIT_FAILURE);
+}
+
+// logging --------------------------------------------------------------------
+
+void sim_log(const char *fmt, ...) {
+    if (!sim_config.verbose) return;
+
+    va_list args;
+    va_start(args, fmt);
+    printf("[%10.3f ms] ", (double)now_ns / SIM_NS_PER_MS);
+    vprintf(fmt, args);
+    printf("\n");
+    va_end(args);
+}
@@ -0,0 +1,333 @@
+/**
+ * host simulator -- storage capacitor and energy ledger
+ *
+ * every modelled activity draws its cost from the storage capacitor and
+ * books it under one ledger category. continuous loads (leakage, BMA400 in
+ * normal mode) and the harvester input are integrated lazily whenever time
+ * has advanced. V_store follows from E = 1/2 C V^2, so the firmware's own
+ * threshold checks see the same capacitor the ledger drains.
+ */
+
+#include "sim.h"
+#include "app_common.h"
+#include "nordic_common.h"
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <math.h>
+
+// storage capacitor: app_common.h gives 2.2V ~ 242uJ and 1.8V ~ 162uJ -> 100uF
+#define V_BLE_INIT_V            (V_STORE_LVL_BLE_INIT / 1000.0)
+#define CAP_F                   (2.0 * 242e-6 / (V_BLE_INIT_V * V_BLE_INIT_V))
+#define V_STORE_MAX_MV          5250    // LTC3109 VSTORE clamp
+#define V_BROWNOUT_MV           1700    // nRF52811 minimum supply
+#define V_POWER_ON_MV           2350    // LTC3109 VOUT = 2.35V setting, enough for boot
+#define VDD_MV                  2350    // VOUT, regulated from v_store above it
+
+// v_store divider R1 / R2 behind the PMOS on GPIO_DIV_EN, C20 on its output
+#define R_DIV_TOP_OHM           10e6
+#define R_DIV_BOTTOM_OHM        5e6
+#define C_DIV_F                 10e-9
+
+// per-event costs, fitted to the measured power table in firmware/README.md:
+//   inrush 23uJ, HW init 48uJ, BLE init 620uJ, ADC sample 0.88uJ,
+//   accel & send 102uJ, idle 9.2uW (divider included), open circuit 6uW
+#define E_INRUSH_UJ             23.0
+#define E_HW_INIT_UJ            48.0
+#define E_BLE_INIT_UJ           620.0
+#define E_CPU_WAKE_UJ           0.30    // HFINT start, ISR entry/exit
+#define E_SAADC_CONV_UJ         0.28    // + 2 wake-ups for a timer triggered sample = 0.88uJ
+#define E_SAADC_OVERSAMPLE_UJ   0.015   // each further conversion averaged: ~1mA for 5us at 3V
+#define E_SPIM_INIT_UJ          0.10
+#define P_SPIM_ACTIVE_UW        3000.0  // HFCLK + SPIM + EasyDMA while clocking
+#define P_BMA400_NORMAL_UW      6.3     // 3.5uA @ 1.8V on top of sleep current
+#define P_LPCOMP_UW             1.2     // 0.5uA @ VDD, nRF52811 datasheet
+#define E_BLE_EVENT_UJ          64.0    // connection event carrying data: HFXO, radio ramp-up
+#define E_BLE_NOTIFY_UJ         15.0    // per notification in that event
+#define E_BLE_BYTE_UJ           0.08    // radio on-air time per payload byte
+#define P_IDLE_UW               8.6     // 9.2uW less the divider, always on then, at ~3V
+#define P_OFF_UW                6.0
+
+static double stored_uj = 0.0;
+static uint64_t updated_ns = 0;
+static bool powered = false;
+static bool bma400_active = false;
+static bool lpcomp_active = false;
+static double ble_setup_uw = 0.0;
+static double div_node_mv = 0.0;        // C20, GPIO_V_STORE_DIV_IN
+
+static double energy_at_mv(double mv) {
+    return 0.5 * CAP_F * (mv / 1000.0) * (mv / 1000.0) * 1e6;
+}
+
+static double v_store_exact_mv(void) {
+    return sqrt(2.0 * MAX(stored_uj, 0.0) * 1e-6 / CAP_F) * 1000.0;
+}
+
+static int32_t v_store_mv(void) {
+    return (int32_t)v_store_exact_mv();
+}
+
+int32_t sim_supply_v_store_mv(void) {
+    sim_energy_update();
+    return v_store_mv();
+}
+
+// GPIO_DIV_EN drives the PMOS gate low
+bool sim_supply_divider_on(void) {
+    return powered && sim_gpio_is_output(GPIO_DIV_EN) && !sim_gpio_output_get(GPIO_DIV_EN);
+}
+
+double sim_supply_v_store_div_mv(void) {
+    sim_energy_update();
+    return div_node_mv;
+}
+
+// the LTC3109 regulates VOUT down from v_store, and follows it below
+int32_t sim_supply_vdd_mv(void) {
+    return MIN(sim_supply_v_store_mv(), VDD_MV);
+}
+
+// book energy against the capacitor and check the supply
+static void consume(sim_energy_t category, double uj) {
+    stored_uj -= uj;
+    sim_stats.energy_uj[category] += uj;
+
+    if (!powered) return;
+    int32_t mv = v_store_mv();
+    sim_stats.v_store_min_mv = MIN(sim_stats.v_store_min_mv, mv);
+    if (mv < V_BROWNOUT_MV) {
+        powered = false;
+        sim_brownout();
+    }
+}
+
+// the PMOS conducts while GPIO_DIV_EN drives its gate low. switched on, C20
+// charges through R1 || R2 towards v_store / 3 and v_store feeds R1;
+// switched off (or unpowered), C20 discharges through R2
+static void integrate_divider(double dt_s) {
+    double v_mv = v_store_exact_mv();
+    bool on = sim_supply_divider_on();
+    double r_ohm = on ? R_DIV_TOP_OHM * R_DIV_BOTTOM_OHM / (R_DIV_TOP_OHM + R_DIV_BOTTOM_OHM) : R_DIV_BOTTOM_OHM;
+    double tau_s = r_ohm * C_DIV_F;
+    double target_mv = on ? v_mv * R_DIV_BOTTOM_OHM / (R_DIV_TOP_OHM + R_DIV_BOTTOM_OHM) : 0.0;
+    double decay = exp(-dt_s / tau_s);
+
+    if (powered) sim_stats.divider_always_on_uj += v_mv * v_mv / (R_DIV_TOP_OHM + R_DIV_BOTTOM_OHM) * dt_s;
+    if (on) {
+        // integral of the voltage across R1, mV s; mV * mV s / ohm = uJ
+        double across_mv_s = (v_mv - target_mv) * dt_s + (target_mv - div_node_mv) * tau_s * (1.0 - decay);
+        sim_stats.divider_on_ns += (uint64_t)(dt_s * SIM_NS_PER_S + 0.5);
+        consume(SIM_ENERGY_DIVIDER, v_mv * across_mv_s / R_DIV_TOP_OHM);
+    }
+    div_node_mv = target_mv + (div_node_mv - target_mv) * decay;
+}
+
+// integrate harvest and continuous loads over a stretch of one activity
+static void integrate_activity(uint64_t to_ns) {
+    sim_activity_stats_t *p_act = &sim_stats.activity[sim_harvest_activity(updated_ns)];
+    uint64_t dt_ns = to_ns - updated_ns;
+    double dt_s = (double)dt_ns / SIM_NS_PER_S;
+    double harvested = sim_harvest_energy_uj(updated_ns, to_ns);
+    updated_ns = to_ns;
+
+    stored_uj += harvested;
+    sim_stats.harvested_uj += harvested;
+    p_act->harvested_uj += harvested;
+    p_act->time_ns += dt_ns;
+    if (stored_uj > energy_at_mv(V_STORE_MAX_MV)) {
+        sim_stats.wasted_uj += stored_uj - energy_at_mv(V_STORE_MAX_MV);
+        stored_uj = energy_at_mv(V_STORE_MAX_MV);
+    }
+
+    integrate_divider(dt_s);
+    if (!powered) {
+        stored_uj = MAX(stored_uj - P_OFF_UW * dt_s, 0.0);
+        return;
+    }
+    p_act->powered_ns += dt_ns;
+    if (bma400_active) p_act->sampling_ns += dt_ns;
+
+    if (ble_setup_uw > 0.0) consume(SIM_ENERGY_BLE_INIT, ble_setup_uw * dt_s);
+    if (bma400_active) consume(SIM_ENERGY_ACCEL, P_BMA400_NORMAL_UW * dt_s);
+    if (lpcomp_active) {
+        sim_stats.lpcomp_active_ns += dt_ns;
+        consume(SIM_ENERGY_LPCOMP, P_LPCOMP_UW * dt_s);
+    }
+    consume(SIM_ENERGY_IDLE, P_IDLE_UW * dt_s);
+}
+
+// integrate up to to_ns, split where the activity changes
+static void integrate(uint64_t to_ns) {
+    while (updated_ns < to_ns) {
+        integrate_activity(MIN(to_ns, sim_harvest_activity_end(updated_ns)));
+    }
+}
+
+void sim_energy_init(void) {
+    stored_uj = energy_at_mv(sim_config.v_store_mv);
+    updated_ns = sim_time_ns();
+    sim_stats.v_store_min_mv = V_STORE_MAX_MV;
+}
+
+void sim_energy_update(void) {
+    integrate(sim_time_ns());
+}
+
+// advance time with the device unpowered until the capacitor reaches the
+// power-on level. returns false if the run ends first.
+bool sim_energy_wait_power_on(void) {
+    powered = false;
+    bma400_active = false;
+    lpcomp_active = false;
+    ble_setup_uw = 0.0;
+    updated_ns = sim_time_ns();
+
+    uint64_t t_ns = updated_ns;
+    while (stored_uj < energy_at_mv(V_POWER_ON_MV)) {
+        if (t_ns >= sim_config.duration_ns) break;
+        t_ns = MIN(t_ns + SIM_MS(1), sim_config.duration_ns);
+        integrate(t_ns);
+    }
+    sim_time_restore(t_ns);
+    if (stored_uj < energy_at_mv(V_POWER_ON_MV)) return false;
+    powered = true;
+    return true;
+}
+
+void sim_energy_boot(void) {
+    sim_stats.boots++;
+    consume(SIM_ENERGY_BOOT, E_INRUSH_UJ + E_HW_INIT_UJ);
+}
+
+// event costs ----------------------------------------------------------------
+
+void sim_energy_cpu_wake(void) {
+    consume(SIM_ENERGY_CPU, E_CPU_WAKE_UJ);
+}
+
+// one sample, averaged from n_conversions
+void sim_energy_saadc_conversions(uint32_t n_conversions) {
+    consume(SIM_ENERGY_SAADC, E_SAADC_CONV_UJ + E_SAADC_OVERSAMPLE_UJ * (n_conversions - 1));
+}
+
+void sim_energy_spim_init(void) {
+    consume(SIM_ENERGY_SPI, E_SPIM_INIT_UJ);
+}
+
+double sim_energy_spi_uj(uint64_t duration_ns) {
+    return P_SPIM_ACTIVE_UW * duration_ns / SIM_NS_PER_S;
+}
+
+void sim_energy_spi_xfer(uint64_t duration_ns) {
+    consume(SIM_ENERGY_SPI, sim_energy_spi_uj(duration_ns));
+}
+
+void sim_energy_bma400_active(bool active) {
+    sim_energy_update();
+    bma400_active = active;
+}
+
+void sim_energy_lpcomp_active(bool active) {
+    sim_energy_update();
+    lpcomp_active = active;
+}
+
+// the measured BLE init cost covers stack init, advertising and connection
+// setup; it is spread evenly over the link model's setup window
+void sim_energy_ble_setup(uint64_t window_ns) {
+    sim_energy_update();
+    ble_setup_uw = E_BLE_INIT_UJ * SIM_NS_PER_S / window_ns;
+}
+
+void sim_energy_ble_setup_done(void) {
+    sim_energy_update();
+    ble_setup_uw = 0.0;
+}
+
+void sim_energy_ble_event(void) {
+    consume(SIM_ENERGY_BLE_TX, E_BLE_EVENT_UJ);
+}
+
+void sim_energy_ble_notification(uint16_t length) {
+    consume(SIM_ENERGY_BLE_TX, E_BLE_NOTIFY_UJ + E_BLE_BYTE_UJ * length);
+}
+
+// carried across brown-out resets --------------------------------------------
+
+double sim_energy_stored_uj(void) {
+    sim_energy_update();
+    return stored_uj;
+}
+
+void sim_energy_restore(double uj) {
+    stored_uj = uj;
+    updated_ns = sim_time_ns();
+}
+
+// report ---------------------------------------------------------------------
+
+void sim_energy_report(void) {
+    static const char *names[SIM_ENERGY_COUNT] = {
+        [SIM_ENERGY_BOOT]     = "boot",
+        [SIM_ENERGY_BLE_INIT] = "ble_init",
+        [SIM_ENERGY_CPU]      = "cpu",
+        [SIM_ENERGY_SAADC]    = "saadc",
+        [SIM_ENERGY_LPCOMP]   = "lpcomp",
+        [SIM_ENERGY_DIVIDER]  = "divider",
+        [SIM_ENERGY_SPI]      = "spi",
+        [SIM_ENERGY_ACCEL]    = "accel",
+        [SIM_ENERGY_BLE_TX]   = "ble_tx",
+        [SIM_ENERGY_IDLE]     = "idle",
+    };
+    const sim_stats_t *s = &sim_stats;
+
+    double consumed = 0.0;
+    for (int i = 0; i < SIM_ENERGY_COUNT; i++) {
+        printf("energy_%-17s%.1f uJ\n", names[i], s->energy_uj[i]);
+        consumed += s->energy_uj[i];
+    }
+    printf("energy_consumed_uj      %.1f\n", consumed);
+
+    // watching v_store: conversions, the LPCOMP, the divider and the
+    // wake-ups that trigger and collect samples, on average while powered
+    double v_store_uj = s->energy_uj[SIM_ENERGY_SAADC] + s->energy_uj[SIM_ENERGY_LPCOMP]
+                      + s->energy_uj[SIM_ENERGY_DIVIDER] + E_CPU_WAKE_UJ * s->v_store_wakeups;
+    uint64_t powered_ns = 0;
+    for (int i = 0; i < SIM_ACTIVITY_COUNT; i++) powered_ns += s->activity[i].powered_ns;
+    printf("energy_v_store_uj       %.1f (%.2f uW)\n", v_store_uj,
+           powered_ns ? v_store_uj * SIM_NS_PER_S / powered_ns : 0.0);
+    // leakage saved by switching the divider off between samples
+    double div_saved_uj = s->divider_always_on_uj - s->energy_uj[SIM_ENERGY_DIVIDER];
+    printf("energy_divider_saved_uj %.1f (%.2f uW)\n", div_saved_uj,
+           powered_ns ? div_saved_uj * SIM_NS_PER_S / powered_ns : 0.0);
+    printf("energy_harvested_uj     %.1f\n", s->harvested_uj);
+    printf("energy_wasted_uj        %.1f\n", s->wasted_uj);
+    printf("v_store_final_mv        %" PRId32 "\n", v_store_mv());
+    printf("v_store_min_mv          %" PRId32 "\n", s->v_store_min_mv);
+    printf("boots                   %" PRIu32 "\n", s->boots);
+    printf("brownouts               %" PRIu32 "\n", s->brownouts);
+
+    // cost of sampling and sending, per connection event carrying data
+    // (comparable to the 102uJ table entry for one 16 sample burst) and per
+    // delivered sample
+    double burst = s->energy_uj[SIM_ENERGY_SPI] + s->energy_uj[SIM_ENERGY_ACCEL]
+                 + s->energy_uj[SIM_ENERGY_BLE_TX]
+                 + E_CPU_WAKE_UJ * MAX((double)s->cpu_wakeups - s->v_store_wakeups, 0.0);
+    if (s->ble_tx_events) {
+        printf("energy_per_burst_uj     %.1f\n", burst / s->ble_tx_events);
+    }
+    if (s->bma_watermark_irqs) {
+        printf("energy_spim_init_uj_per_burst %.2f\n", E_SPIM_INIT_UJ * s->spim_inits / s->bma_watermark_irqs);
+    }
+    if (s->host_samples_matched) {
+        printf("energy_per_sample_uj    %.2f\n", burst / s->host_samples_matched);
+    }
+    if (consumed > 0.0) {
+        printf("samples_per_joule       %.0f\n", s->host_samples_matched / (consumed * 1e-6));
+    }
+    if (s->harvested_uj > 0.0) {
+        printf("samples_per_joule_harvested %.0f\n",
+               s->host_samples_matched / (s->harvested_uj * 1e-6));
+    }
+}
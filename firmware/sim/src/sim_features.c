@@ -0,0 +1,74 @@
+/**
+ * host simulator -- reference for the on-device features (app_features.h)
+ *
+ * recomputed from the definitions, independently of app_features.c: 64 bit
+ * sums, the variance from the centred values in a second pass, a full period
+ * sine table from libm and a DFT without quadrant folding. the records the
+ * firmware sends have to match it bit for bit.
+ */
+
+#include "sim.h"
+
+#include <math.h>
+
+#define REF_DFT_POINTS      128
+
+static int32_t ref_sin[REF_DFT_POINTS];
+
+static void ref_sin_init(void) {
+    if (ref_sin[REF_DFT_POINTS / 4]) return;
+    for (uint16_t j = 0; j < REF_DFT_POINTS; j++) ref_sin[j] = (int32_t)lround(4096 * sin(2 * M_PI * j / REF_DFT_POINTS));
+}
+
+// features of n_samples x, y, z triples
+void sim_features_reference(int16_t const *p_xyz, uint8_t n_samples, features_t *p_features) {
+    int64_t n = n_samples;
+
+    ref_sin_init();
+    p_features->window = n_samples;
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        features_axis_t *p_axis = &p_features->axis[axis];
+        int64_t sum = 0, sum_sq = 0;
+        for (uint16_t i = 0; i < n_samples; i++) {
+            int64_t x = p_xyz[3 * i + axis];
+            sum += x;
+            sum_sq += x * x;
+        }
+        int64_t mean = sum / n;
+
+        // sum((n x - sum)^2) = n (n sum(x^2) - sum^2)
+        int64_t centred_sq = 0;
+        uint8_t crossings = 0;
+        int prev = 0;
+        for (uint16_t i = 0; i < n_samples; i++) {
+            int64_t c = n * p_xyz[3 * i + axis] - sum;
+            centred_sq += c * c;
+            int s = (c > 0) ? 1 : (c < 0) ? -1 : 0;
+            if (s != 0 && prev != 0 && s != prev) crossings++;
+            if (s != 0) prev = s;
+        }
+
+        uint64_t best = 0;
+        uint8_t best_k = 0;
+        for (uint16_t k = 1; k <= n_samples / 2; k++) {
+            int64_t re = 0, im = 0;
+            for (uint16_t i = 0; i < n_samples; i++) {
+                uint32_t j = (uint32_t)(k * i * (REF_DFT_POINTS / n_samples)) % REF_DFT_POINTS;
+                int64_t d = p_xyz[3 * i + axis] - mean;
+                re += d * ref_sin[(j + REF_DFT_POINTS / 4) % REF_DFT_POINTS];
+                im += d * ref_sin[j];
+            }
+            uint64_t power = (uint64_t)(re * re) + (uint64_t)(im * im);
+            if (power > best) {
+                best = power;
+                best_k = (uint8_t)k;
+            }
+        }
+
+        p_axis->mean = (int16_t)mean;
+        p_axis->variance = (uint32_t)(centred_sq / (n * n * n));
+        p_axis->energy = (uint32_t)(sum_sq / n);
+        p_axis->zero_crossings = crossings;
+        p_axis->dominant_bin = best_k;
+    }
+}
@@ -0,0 +1,227 @@
+/**
+ * host simulator -- harvester output power
+ *
+ * the harvester is a constant source (--harvest-uw), a trace file
+ * (--harvest-trace) or a synthetic activity profile (--activity).
+ *
+ * trace files have one "<time s> <power uW> [activity]" entry per line, where
+ * activity is desk, walking or running. traces are piecewise constant: each
+ * power holds until the next timestamp, the last one holds until the end of
+ * the run. '#' starts a comment.
+ */
+
+#include "sim.h"
+#include "nordic_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HARVEST_PEAK_UW             1300.0  // LTC3109 output, firmware/README.md
+#define SYNTH_STEP_NS               SIM_MS(50)
+
+typedef struct {
+    uint64_t time_ns;
+    double power_uw;
+    sim_activity_t activity;
+    uint64_t activity_end_ns;   // next point with a different activity
+} harvest_point_t;
+
+// synthetic LTC3109 output per activity: body heat into the TEG, modulated by
+// arm swing airflow while moving
+typedef struct {
+    double mean_uw;
+    double swing_uw;            // ripple at the arm swing frequency
+    double swing_hz;
+    double drift_uw;            // slow change of skin / air temperature
+    double noise_uw;
+} harvest_profile_t;
+
+static const harvest_profile_t profiles[SIM_ACTIVITY_COUNT] = {
+    [SIM_ACTIVITY_DESK]    = { .mean_uw = 120.0,  .swing_uw = 0.0,   .swing_hz = 0.0,
+                               .drift_uw = 40.0,  .noise_uw = 10.0 },
+    [SIM_ACTIVITY_WALKING] = { .mean_uw = 600.0,  .swing_uw = 150.0, .swing_hz = 0.9,
+                               .drift_uw = 60.0,  .noise_uw = 40.0 },
+    [SIM_ACTIVITY_RUNNING] = { .mean_uw = 1050.0, .swing_uw = 200.0, .swing_hz = 1.4,
+                               .drift_uw = 60.0,  .noise_uw = 60.0 },
+};
+
+static const char *activity_names[SIM_ACTIVITY_COUNT] = {
+    [SIM_ACTIVITY_NONE]    = "none",
+    [SIM_ACTIVITY_DESK]    = "desk",
+    [SIM_ACTIVITY_WALKING] = "walking",
+    [SIM_ACTIVITY_RUNNING] = "running",
+};
+
+static harvest_point_t *trace = NULL;
+static uint32_t trace_len = 0;
+static uint32_t trace_cap = 0;
+
+const char *sim_activity_name(sim_activity_t activity) {
+    return activity_names[activity];
+}
+
+static bool activity_parse(const char *name, sim_activity_t *p_activity) {
+    for (int i = 0; i < SIM_ACTIVITY_COUNT; i++) {
+        if (strcmp(name, activity_names[i]) == 0) {
+            *p_activity = (sim_activity_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void trace_append(uint64_t time_ns, double power_uw, sim_activity_t activity) {
+    if (trace_len == trace_cap) {
+        trace_cap = trace_cap ? 2 * trace_cap : 1024;
+        trace = realloc(trace, trace_cap * sizeof(harvest_point_t));
+        if (trace == NULL) {
+            fprintf(stderr, "sim: out of memory for harvest trace\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    trace[trace_len++] = (harvest_point_t){ time_ns, power_uw, activity, UINT64_MAX };
+}
+
+// trace files ----------------------------------------------------------------
+
+static bool trace_load(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "sim: cannot open harvest trace %s\n", path);
+        return false;
+    }
+
+    char line[128];
+    uint32_t line_num = 0;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line_num++;
+        double t_s, p_uw;
+        char c, label[16] = "none";
+        sim_activity_t activity;
+        if (sscanf(line, " %c", &c) != 1 || c == '#') continue;
+
+        int n = sscanf(line, "%lf %lf %15s", &t_s, &p_uw, label);
+        uint64_t t_ns = (uint64_t)(t_s * SIM_NS_PER_S);
+        if (n < 2 || t_s < 0.0 || p_uw < 0.0 || !activity_parse(label, &activity) ||
+            (trace_len && t_ns < trace[trace_len - 1].time_ns)) {
+            fprintf(stderr, "sim: %s:%u: expected increasing \"<time s> <power uW> [activity]\"\n",
+                    path, line_num);
+            fclose(f);
+            return false;
+        }
+        trace_append(t_ns, p_uw, activity);
+    }
+    fclose(f);
+
+    if (trace_len == 0) {
+        fprintf(stderr, "sim: %s: empty harvest trace\n", path);
+        return false;
+    }
+    return true;
+}
+
+// synthetic profiles ---------------------------------------------------------
+
+static uint32_t synth_noise_state = 1;
+
+// deterministic noise in [-1, 1)
+static double synth_noise(void) {
+    synth_noise_state = synth_noise_state * 1664525u + 1013904223u;
+    return (double)(int32_t)synth_noise_state / 2147483648.0;
+}
+
+static void synth_append(sim_activity_t activity, uint64_t from_ns, uint64_t to_ns) {
+    const harvest_profile_t *p = &profiles[activity];
+    const double two_pi = 6.283185307179586;
+
+    for (uint64_t t_ns = from_ns; t_ns < to_ns; t_ns += SYNTH_STEP_NS) {
+        double t = (double)t_ns / SIM_NS_PER_S;
+        double p_uw = p->mean_uw
+                    + p->swing_uw * sin(two_pi * p->swing_hz * t)
+                    + p->drift_uw * sin(two_pi * t / 20.0)
+                    + p->noise_uw * synth_noise();
+        trace_append(t_ns, MIN(MAX(p_uw, 0.0), HARVEST_PEAK_UW), activity);
+    }
+}
+
+// "mixed" spends a third of the run at each activity
+static bool synth_generate(const char *name) {
+    synth_noise_state = sim_config.seed ? sim_config.seed : 1;
+
+    sim_activity_t activity;
+    if (strcmp(name, "mixed") == 0) {
+        uint64_t third_ns = sim_config.duration_ns / 3;
+        synth_append(SIM_ACTIVITY_DESK,    0,            third_ns);
+        synth_append(SIM_ACTIVITY_WALKING, third_ns,     2 * third_ns);
+        synth_append(SIM_ACTIVITY_RUNNING, 2 * third_ns, sim_config.duration_ns);
+    } else if (activity_parse(name, &activity) && activity != SIM_ACTIVITY_NONE) {
+        synth_append(activity, 0, sim_config.duration_ns);
+    } else {
+        fprintf(stderr, "sim: unknown activity %s (desk, walking, running, mixed)\n", name);
+        return false;
+    }
+    return trace_len > 0;
+}
+
+bool sim_harvest_init(void) {
+    bool ok = true;
+    if (sim_config.harvest_trace) {
+        ok = trace_load(sim_config.harvest_trace);
+    } else if (sim_config.activity) {
+        ok = synth_generate(sim_config.activity);
+    }
+
+    for (int32_t i = (int32_t)trace_len - 2; i >= 0; i--) {
+        trace[i].activity_end_ns = (trace[i + 1].activity != trace[i].activity)
+                                 ? trace[i + 1].time_ns : trace[i + 1].activity_end_ns;
+    }
+    return ok;
+}
+
+// lookup ---------------------------------------------------------------------
+
+// index of the trace point in effect at time_ns, or -1 before the first one.
+// runs move forward in time, so the search starts at the last hit.
+static int32_t trace_index(uint64_t time_ns) {
+    static uint32_t seg = 0;
+    if (seg >= trace_len || trace[seg].time_ns > time_ns) seg = 0;
+    if (trace[seg].time_ns > time_ns) return -1;
+    while (seg + 1 < trace_len && trace[seg + 1].time_ns <= time_ns) seg++;
+    return (int32_t)seg;
+}
+
+// energy delivered into the storage capacitor between two points in time
+double sim_harvest_energy_uj(uint64_t from_ns, uint64_t to_ns) {
+    if (trace_len == 0) {
+        return sim_config.harvest_uw * (double)(to_ns - from_ns) / SIM_NS_PER_S;
+    }
+
+    double uj = 0.0;
+    uint64_t t_ns = from_ns;
+    while (t_ns < to_ns) {
+        int32_t i = trace_index(t_ns);
+        uint32_t next = (uint32_t)(i + 1);
+        uint64_t end_ns = (next < trace_len) ? MIN(trace[next].time_ns, to_ns) : to_ns;
+        double p_uw = (i >= 0) ? trace[i].power_uw : 0.0;
+
+        uj += p_uw * (double)(end_ns - t_ns) / SIM_NS_PER_S;
+        t_ns = end_ns;
+    }
+    return uj;
+}
+
+sim_activity_t sim_harvest_activity(uint64_t time_ns) {
+    if (trace_len == 0) return SIM_ACTIVITY_NONE;
+    int32_t i = trace_index(time_ns);
+    return (i >= 0) ? trace[i].activity : SIM_ACTIVITY_NONE;
+}
+
+// time at which the activity in effect at time_ns changes
+uint64_t sim_harvest_activity_end(uint64_t time_ns) {
+    if (trace_len == 0) return UINT64_MAX;
+
+    int32_t i = trace_index(time_ns);
+    return (i >= 0) ? trace[i].activity_end_ns : trace[0].time_ns;
+}
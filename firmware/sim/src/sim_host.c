@@ -0,0 +1,259 @@
+/**
+ * host simulator -- receiver side of the NUS link
+ *
+ * decodes notification frames (app_frame.h: header with sequence number,
+ * format and time marks, then little-endian int16 x/y/z triples, int8 triples
+ * in the 8 bit format, or Rice coded 12 bit samples) and matches the samples
+ * in order against the ones the BMA400 model generated, reduced to the same
+ * resolution.
+ *
+ * the time marks rebuild the sample timeline: a mark gives the sensor time of
+ * a burst's first sample and its ODR, the samples up to the next mark follow
+ * one sample period apart, across frames. the 24 bit sensor time is
+ * unwrapped into a monotonic 64 bit tick count, so every matched sample can be
+ * checked against the time it was generated at. a missing sequence number
+ * means samples of unknown count are gone: the timeline stops until the next
+ * mark, and repeated frames are dropped.
+ *
+ * feature records (FRAME_FORMAT_FEATURES) are placed on the timeline the same
+ * way, one window at a time. each is checked bit for bit against the
+ * reference features of the generated samples in its window.
+ *
+ * activity records (FRAME_FORMAT_ACTIVITY) each carry a mark. the window it
+ * points at has to classify as the record's activity, run through the
+ * reference features and the firmware's classifier. the host then keeps the
+ * reported activity from one record's window to the next, and that timeline is
+ * compared with the activity the harvester profile was in. the 24 bit mark is
+ * turned into simulated time from the time the frame arrived, as a phone
+ * would use its own clock.
+ */
+
+#include "sim.h"
+#include "app_common.h"
+#include "app_accelerometer.h"
+#include "app_frame.h"
+
+static uint32_t next_match_index = 0;
+static bool seq_valid = false;
+static uint8_t seq_last = 0;
+
+static bool timeline_valid = false;
+static uint64_t timeline_next = 0;      // ticks of the next sample without a mark
+static uint64_t timeline_last = 0;
+static uint16_t timeline_ticks = 0;     // sample period
+
+// FRAME_FORMAT_ACTIVITY: the activity reported last, from activity_from_ns on
+static bool activity_valid = false;
+static uint8_t activity_last = 0;
+static uint64_t activity_from_ns = 0;
+
+// 8 bit samples are the 8 MSBs of the 12 bit value
+static bool sample_equal(const sim_sample_t *p_generated, const sim_sample_t *p_rx, uint8_t format) {
+    sim_sample_t g = *p_generated;
+    if (format == FRAME_FORMAT_8_BIT) {
+        g.x = (int16_t)(g.x >> 4);
+        g.y = (int16_t)(g.y >> 4);
+        g.z = (int16_t)(g.z >> 4);
+    }
+    return g.x == p_rx->x && g.y == p_rx->y && g.z == p_rx->z;
+}
+
+// put the next n_samples samples on the timeline, starting a new stretch at
+// a mark. *p_time is the first one's. returns false while the timeline waits
+// for a mark.
+static bool timeline_place(frame_mark_t const *p_mark, uint16_t n_samples, uint64_t *p_time) {
+    if (p_mark) {
+        uint64_t t = timeline_ticks
+                   ? timeline_last + ((p_mark->time - timeline_last) & ACCELEROMETER_TICK_MASK) : p_mark->time;
+        sim_stats.host_time_marks++;
+        if (timeline_valid && t != timeline_next) sim_stats.host_timeline_gaps++;
+        timeline_valid = true;
+        timeline_next = t;
+        timeline_ticks = accelerometer_odr_ticks(p_mark->odr);
+    }
+    if (!timeline_valid) return false;
+
+    timeline_last = timeline_next;
+    timeline_next += (uint64_t)timeline_ticks * n_samples;
+    *p_time = timeline_last;
+    return true;
+}
+
+// sequence number check. returns false for a repeated frame.
+static bool frame_accept(frame_t const *p_frame) {
+    int16_t gap = seq_valid ? frame_seq_gap(seq_last, p_frame->seq) : 0;
+    if (gap < 0) {
+        sim_stats.host_frames_repeated++;
+        return false;
+    }
+
+    sim_stats.host_frames_lost += gap;
+    if (gap > 0 || (p_frame->flags & FRAME_FLAG_RESYNC)) timeline_valid = false;
+    seq_valid = true;
+    seq_last = p_frame->seq;
+    return true;
+}
+
+// find the sample at or after next_match_index. samples in between were lost.
+static void match_sample(const sim_sample_t *p_rx, uint8_t format, bool timed, uint64_t time) {
+    sim_sample_t generated;
+    for (uint32_t i = next_match_index; sim_bma400_sample_lookup(i, &generated); i++) {
+        if (sample_equal(&generated, p_rx, format)) {
+            sim_stats.host_samples_matched++;
+            if (timed && (time & ACCELEROMETER_TICK_MASK) == generated.sensortime) sim_stats.host_samples_timed++;
+            sim_stats.activity[sim_harvest_activity(sim_time_ns())].samples_delivered++;
+            next_match_index = i + 1;
+            return;
+        }
+    }
+}
+
+// reference features of the window of generated samples starting at time,
+// one ticks apart. false if the samples are not in the log (any more).
+static bool window_reference(uint64_t time, uint16_t ticks, uint8_t window, features_t *p_ref) {
+    static int16_t xyz[3 * FEATURES_WINDOW_MAX];
+    sim_sample_t generated;
+
+    for (uint32_t i = next_match_index; sim_bma400_sample_lookup(i, &generated); i++) {
+        if (generated.sensortime != (time & ACCELEROMETER_TICK_MASK)) continue;
+
+        for (uint16_t n = 0; n < window; n++) {
+            uint64_t t = time + (uint64_t)n * ticks;
+            if (!sim_bma400_sample_lookup(i + n, &generated)
+                || generated.sensortime != (t & ACCELEROMETER_TICK_MASK)) {
+                return false;
+            }
+            xyz[3 * n] = generated.x;
+            xyz[3 * n + 1] = generated.y;
+            xyz[3 * n + 2] = generated.z;
+        }
+
+        sim_features_reference(xyz, window, p_ref);
+        next_match_index = i + window;
+        return true;
+    }
+    return false;
+}
+
+// find the window of generated samples starting at time, compare its
+// reference features with the record
+static void match_record(uint8_t const *p_record, features_t const *p_rx, bool timed, uint64_t time) {
+    features_t ref;
+    uint8_t record[FEATURES_LEN];
+
+    sim_stats.host_records++;
+    sim_stats.host_samples_received += p_rx->window;
+    if (!timed || !window_reference(time, timeline_ticks, p_rx->window, &ref)) return;
+
+    features_encode(&ref, record);
+    if (memcmp(record, p_record, FEATURES_LEN) == 0) {
+        sim_stats.host_records_exact++;
+        sim_stats.host_samples_matched += p_rx->window;
+        sim_stats.host_samples_timed += p_rx->window;
+        sim_stats.activity[sim_harvest_activity(sim_time_ns())].samples_delivered += p_rx->window;
+    }
+}
+
+// simulated time of a recent 24 bit sensor time: the BMA400 model counts it
+// from the same clock
+static uint64_t sensortime_ns(uint32_t time) {
+    uint64_t now_ns = sim_time_ns();
+    uint32_t now = (uint32_t)(now_ns * ACCELEROMETER_TICK_HZ / SIM_NS_PER_S);
+    uint64_t ago_ns = (uint64_t)((now - time) & ACCELEROMETER_TICK_MASK) * SIM_NS_PER_S / ACCELEROMETER_TICK_HZ;
+    return (now_ns > ago_ns) ? now_ns - ago_ns : 0;
+}
+
+// the reported activity up to to_ns against the harvester's, where it has one
+static void activity_account(uint64_t to_ns) {
+    for (uint64_t t = activity_from_ns; t < to_ns;) {
+        uint64_t end = MIN(sim_harvest_activity_end(t), to_ns);
+        sim_activity_t truth = sim_harvest_activity(t);
+        if (truth != SIM_ACTIVITY_NONE) {
+            sim_stats.host_activity_ns += end - t;
+            if (truth == SIM_ACTIVITY_DESK + activity_last) sim_stats.host_activity_right_ns += end - t;
+        }
+        t = end;
+    }
+}
+
+// check the record against its window, extend the reported timeline
+static void match_activity(activity_record_t const *p_rx, frame_mark_t const *p_mark) {
+    uint64_t from_ns = sensortime_ns(p_mark->time);
+    features_t ref;
+
+    sim_stats.host_records++;
+    sim_stats.host_time_marks++;
+    sim_stats.host_samples_received += (uint32_t)p_rx->window * p_rx->windows;
+    if (activity_valid && p_rx->activity == activity_last) {
+        sim_stats.host_activity_keepalives++;
+    } else {
+        sim_stats.host_activity_changes++;
+    }
+
+    uint16_t ticks = accelerometer_odr_ticks(p_mark->odr);
+    if (window_reference(p_mark->time, ticks, p_rx->window, &ref) && classifier_run(&ref, ticks) == p_rx->activity) {
+        uint32_t n_samples = (uint32_t)p_rx->window * p_rx->windows;
+        sim_stats.host_records_exact++;
+        sim_stats.host_samples_matched += n_samples;
+        sim_stats.host_samples_timed += n_samples;
+        sim_stats.activity[sim_harvest_activity(sim_time_ns())].samples_delivered += n_samples;
+    }
+
+    if (activity_valid && from_ns > activity_from_ns) activity_account(from_ns);
+    if (!activity_valid || from_ns > activity_from_ns) activity_from_ns = from_ns;
+    activity_valid = true;
+    activity_last = p_rx->activity;
+}
+
+// records of a decoded FRAME_FORMAT_FEATURES or FRAME_FORMAT_ACTIVITY frame
+static frame_result_t frame_records(frame_t const *p_frame, features_t *p_features, activity_record_t *p_activity) {
+    for (uint16_t n = 0; n < p_frame->n_samples; n++) {
+        bool ok = (p_frame->format == FRAME_FORMAT_FEATURES)
+                ? features_decode(&p_frame->p_samples[n * FEATURES_LEN], &p_features[n])
+                : activity_decode(&p_frame->p_samples[n * ACTIVITY_LEN], &p_activity[n]);
+        if (!ok) return FRAME_ERR_CODE;
+    }
+    return FRAME_OK;
+}
+
+void sim_host_receive(uint8_t const *data, uint16_t length) {
+    frame_t frame;
+    static int16_t xyz[3 * FRAME_SAMPLES_MAX];
+    static features_t features[FRAME_SAMPLES_MAX];
+    static activity_record_t activities[FRAME_SAMPLES_MAX];
+    frame_result_t result = frame_decode(data, length, &frame);
+    if (result == FRAME_OK) {
+        bool records = frame.format == FRAME_FORMAT_FEATURES || frame.format == FRAME_FORMAT_ACTIVITY;
+        result = records ? frame_records(&frame, features, activities) : frame_samples(&frame, xyz);
+    }
+    if (result != FRAME_OK) {
+        sim_stats.host_frames_invalid++;
+        return;
+    }
+    sim_stats.host_frames++;
+    sim_stats.host_sample_bytes += frame.data_len;
+    if (!frame_accept(&frame)) return;
+
+    uint8_t mark = 0;
+    for (uint16_t n = 0; n < frame.n_samples; n++) {
+        bool at_mark = mark < frame.n_marks && frame.marks[mark].index == n;
+        frame_mark_t const *p_mark = at_mark ? &frame.marks[mark++] : NULL;
+        uint64_t time = 0;
+
+        if (frame.format == FRAME_FORMAT_ACTIVITY) {
+            match_activity(&activities[n], p_mark);
+            continue;
+        }
+        if (frame.format == FRAME_FORMAT_FEATURES) {
+            bool timed = timeline_place(p_mark, features[n].window, &time);
+            match_record(&frame.p_samples[n * FEATURES_LEN], &features[n], timed, time);
+            continue;
+        }
+
+        bool timed = timeline_place(p_mark, 1, &time);
+
+        sim_sample_t rx = { .x = xyz[3 * n], .y = xyz[3 * n + 1], .z = xyz[3 * n + 2] };
+        sim_stats.host_samples_received++;
+        match_sample(&rx, frame.format, timed, time);
+    }
+}
@@ -0,0 +1,413 @@
+/**
+ * host simulator -- entry point, configuration and report
+ *
+ * main.c is compiled with -Dmain=firmware_main; the simulator parses its
+ * options, brings up the device models and then hands over to the firmware.
+ * the run ends when simulated time reaches --duration or the firmware shuts
+ * down.
+ *
+ * a brown-out resets the device, so every power-on runs the firmware in a
+ * fresh fork() of the untouched simulator process: firmware statics start
+ * from their initial values again, while simulated time, the capacitor charge
+ * and the statistics are handed from one life to the next through a pipe.
+ */
+
+#include "sim.h"
+#include "nordic_common.h"
+#include "nrf_log.h"
+#include "app_frame.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define SIM_YIELD_REF_HZ        25.0    // ODR set in app_accelerometer.c
+
+int firmware_main(void);
+
+sim_config_t sim_config = {
+    .duration_ns = SIM_S(60),
+    .v_store_mv = 0,
+    .harvest_uw = 800.0,
+    .harvest_trace = NULL,
+    .activity = NULL,
+    .seed = 1,
+    .format = FRAME_FORMAT_12_BIT,
+    .link_error_pct = 0.0,
+    .no_lpcomp = false,
+    .verbose = false,
+};
+
+sim_stats_t sim_stats = { 0 };
+
+static uint64_t latency_start_ns = 0;
+static bool latency_running = false;
+static sim_stats_t boot_stats;          // statistics at power-on, for the HW init cost
+static bool hw_init_done = false;
+
+// state handed over from one power-on to the next
+typedef struct {
+    uint64_t time_ns;
+    double stored_uj;
+    sim_stats_t stats;
+    bool finished;
+    int status;
+} sim_life_t;
+
+static int life_fd = -1;
+
+// lifecycle ------------------------------------------------------------------
+
+static void life_end(bool finished, int status) __attribute__((noreturn));
+static void life_end(bool finished, int status) {
+    sim_life_t life = {
+        .stored_uj = sim_energy_stored_uj(),
+        .time_ns = sim_time_ns(),
+        .stats = sim_stats,
+        .finished = finished,
+        .status = status,
+    };
+    fflush(stdout);
+    if (write(life_fd, &life, sizeof(life)) != sizeof(life)) _exit(EXIT_FAILURE);
+    _exit(EXIT_SUCCESS);
+}
+
+void sim_finish(int status) {
+    life_end(true, status);
+}
+
+void sim_brownout(void) {
+    sim_stats.brownouts++;
+    sim_stats.activity[sim_harvest_activity(sim_time_ns())].brownouts++;
+    sim_log("(sim) brown-out at %" PRId32 " mV", sim_stats.v_store_min_mv);
+    life_end(false, EXIT_SUCCESS);
+}
+
+static void life_run(sim_life_t const *p_life) __attribute__((noreturn));
+static void life_run(sim_life_t const *p_life) {
+    sim_time_restore(p_life->time_ns);
+    sim_stats = p_life->stats;
+    sim_energy_restore(p_life->stored_uj);
+
+    if (!sim_energy_wait_power_on()) sim_finish(EXIT_SUCCESS);
+    sim_log("(sim) power on");
+    sim_energy_boot();
+
+    sim_bma400_init();
+    boot_stats = sim_stats;
+    firmware_main();
+
+    // firmware_main() never returns; lives end in sim_finish() or sim_brownout()
+    sim_finish(EXIT_FAILURE);
+}
+
+// HW init: firmware start up to the first SAADC init (voltage_init()), which
+// comes after the accelerometer configuration
+void sim_hw_init_done(void) {
+    if (hw_init_done) return;
+    hw_init_done = true;
+
+    sim_stats_t *s = &sim_stats;
+    s->hw_inits++;
+    s->hw_init_spi_xfers += s->spi_xfers - boot_stats.spi_xfers;
+    s->hw_init_spi_bytes += s->spi_bytes - boot_stats.spi_bytes;
+    s->hw_init_cpu_wakeups += s->cpu_wakeups - boot_stats.cpu_wakeups;
+    s->hw_init_uj += s->energy_uj[SIM_ENERGY_SPI] - boot_stats.energy_uj[SIM_ENERGY_SPI]
+                   + s->energy_uj[SIM_ENERGY_CPU] - boot_stats.energy_uj[SIM_ENERGY_CPU];
+}
+
+// latency: FIFO interrupt to notification queued -----------------------------
+
+void sim_latency_start(void) {
+    if (latency_running) return;
+    latency_running = true;
+    latency_start_ns = sim_time_ns();
+}
+
+void sim_latency_stop(void) {
+    if (!latency_running) return;
+    latency_running = false;
+
+    uint64_t latency = sim_time_ns() - latency_start_ns;
+    sim_stats.latency_sum_ns += latency;
+    sim_stats.latency_max_ns = MAX(sim_stats.latency_max_ns, latency);
+    sim_stats.latency_count++;
+}
+
+// report ---------------------------------------------------------------------
+
+static double percent(uint32_t part, uint32_t whole) {
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+// duty cycle and sample yield per activity class. yield is relative to
+// streaming continuously at the firmware's 25 Hz ODR.
+static void activity_report(void) {
+    for (int i = 0; i < SIM_ACTIVITY_COUNT; i++) {
+        const sim_activity_stats_t *a = &sim_stats.activity[i];
+        if (a->time_ns == 0) continue;
+
+        double t_s = (double)a->time_ns / SIM_NS_PER_S;
+        printf("activity %-8s time_s %.1f harvest_uw %.0f powered %.1f%% sampling %.1f%% "
+               "samples_per_s %.2f yield %.1f%% brownouts %" PRIu32 "\n",
+               sim_activity_name((sim_activity_t)i), t_s, a->harvested_uj / t_s,
+               100.0 * a->powered_ns / a->time_ns, 100.0 * a->sampling_ns / a->time_ns,
+               a->samples_delivered / t_s, 100.0 * a->samples_delivered / (t_s * SIM_YIELD_REF_HZ),
+               a->brownouts);
+    }
+}
+
+// --format names, by FRAME_FORMAT_*
+static const char *format_names[] = {
+    [FRAME_FORMAT_12_BIT]      = "12",
+    [FRAME_FORMAT_8_BIT]       = "8",
+    [FRAME_FORMAT_12_BIT_RICE] = "rice",
+    [FRAME_FORMAT_FEATURES]    = "features",
+    [FRAME_FORMAT_ACTIVITY]    = "activity",
+};
+
+static bool format_parse(const char *name) {
+    for (uint8_t i = 0; i < sizeof(format_names) / sizeof(format_names[0]); i++) {
+        if (strcmp(name, format_names[i]) == 0) {
+            sim_config.format = i;
+            return true;
+        }
+    }
+    fprintf(stderr, "sim: unknown format %s (12, 8, rice, features, activity)\n", name);
+    return false;
+}
+
+static bool window_parse(const char *arg) {
+    int window = atoi(arg);
+    if (window < 0 || !features_window_valid((uint16_t)window)) {
+        fprintf(stderr, "sim: invalid window %s (16, 32, 64, 128)\n", arg);
+        return false;
+    }
+    sim_config.window = (uint8_t)window;
+    return true;
+}
+
+void sim_report(void) {
+    const sim_stats_t *s = &sim_stats;
+
+    printf("simulated_time_s        %.3f\n", (double)sim_time_ns() / SIM_NS_PER_S);
+    printf("format                  %s\n", format_names[sim_config.format]);
+    if (sim_config.format == FRAME_FORMAT_FEATURES || sim_config.format == FRAME_FORMAT_ACTIVITY) {
+        printf("window                  %u\n", sim_config.window ? sim_config.window : FEATURES_WINDOW_DEFAULT);
+    }
+    printf("harvester               %s\n", sim_config.harvest_trace ? sim_config.harvest_trace :
+                                          sim_config.activity ? sim_config.activity : "constant");
+    printf("cpu_wakeups             %" PRIu32 "\n", s->cpu_wakeups);
+    printf("sched_blocking_wakeups  %" PRIu32 "\n", s->sched_blocking_wakeups);
+    printf("sched_handler_max_us    %.1f\n", (double)s->sched_handler_max_ns / SIM_NS_PER_US);
+    printf("saadc_inits             %" PRIu32 "\n", s->saadc_inits);
+    printf("saadc_samples           %" PRIu32 "\n", s->saadc_samples);
+    if (s->saadc_v_store_reads) {
+        printf("saadc_err_mv            %.2f avg %.2f max\n",
+               s->saadc_err_sum_mv / s->saadc_v_store_reads, s->saadc_err_max_mv);
+    }
+    printf("v_store_wakeups         %" PRIu32 "\n", s->v_store_wakeups);
+    printf("v_store_wakeups_per_h   %.0f\n", s->v_store_wakeups * 3600.0 * SIM_NS_PER_S / sim_time_ns());
+    printf("lpcomp_irqs             %" PRIu32 "\n", s->lpcomp_irqs);
+    printf("lpcomp_active_s         %.3f\n", (double)s->lpcomp_active_ns / SIM_NS_PER_S);
+    printf("divider_on_s            %.3f\n", (double)s->divider_on_ns / SIM_NS_PER_S);
+    printf("gpiote_irqs             %" PRIu32 "\n", s->gpiote_irqs);
+    printf("spim_inits              %" PRIu32 "\n", s->spim_inits);
+    if (s->hw_inits) {
+        printf("hw_init_spi_xfers       %.1f\n", (double)s->hw_init_spi_xfers / s->hw_inits);
+        printf("hw_init_spi_bytes       %.1f\n", (double)s->hw_init_spi_bytes / s->hw_inits);
+        printf("hw_init_cpu_wakeups     %.1f\n", (double)s->hw_init_cpu_wakeups / s->hw_inits);
+        printf("hw_init_spi_cpu_uj      %.2f\n", s->hw_init_uj / s->hw_inits);
+    }
+    printf("spi_xfers               %" PRIu32 "\n", s->spi_xfers);
+    printf("spi_bytes               %" PRIu32 "\n", s->spi_bytes);
+    printf("spi_active_ms           %.3f\n", (double)s->spi_active_ns / SIM_NS_PER_MS);
+    if (s->bma_watermark_irqs) {
+        printf("spim_inits_per_burst    %.2f\n", (double)s->spim_inits / s->bma_watermark_irqs);
+        printf("spim_init_us_per_burst  %.1f\n",
+               (double)s->spim_init_ns / s->bma_watermark_irqs / SIM_NS_PER_US);
+        // all SPI traffic, init and wake-ups included, per burst
+        printf("spi_xfers_per_burst     %.2f\n", (double)s->spi_xfers / s->bma_watermark_irqs);
+        printf("spi_bytes_per_burst     %.1f\n", (double)s->spi_bytes / s->bma_watermark_irqs);
+        // HFCLK + SPIM on time per burst, all traffic and the FIFO reads alone
+        printf("spi_active_us_per_burst %.1f\n",
+               (double)s->spi_active_ns / s->bma_watermark_irqs / SIM_NS_PER_US);
+        printf("spi_fifo_us_per_burst   %.1f\n",
+               (double)s->spi_fifo_active_ns / s->bma_watermark_irqs / SIM_NS_PER_US);
+    }
+    printf("bma_samples_generated   %" PRIu32 "\n", s->bma_samples_generated);
+    printf("bma_samples_dropped     %" PRIu32 "\n", s->bma_samples_dropped);
+    printf("bma_fifo_bytes_read     %" PRIu32 "\n", s->bma_fifo_bytes_read);
+    printf("bma_fifo_frames_read    %" PRIu32 "\n", s->bma_fifo_frames_read);
+    printf("bma_fifo_wasted_bytes   %" PRIu32 "\n", s->bma_fifo_wasted_bytes);
+    printf("bma_frames_flushed      %" PRIu32 "\n", s->bma_frames_flushed);
+    printf("bma_watermark_irqs      %" PRIu32 "\n", s->bma_watermark_irqs);
+    if (s->bma_watermark_irqs) {
+        printf("bma_frames_per_watermark %.1f\n",
+               (double)s->bma_fifo_frames_read / s->bma_watermark_irqs);
+        printf("bma_fifo_xfers_per_burst %.2f\n", (double)s->bma_fifo_xfers / s->bma_watermark_irqs);
+    }
+    printf("ble_notifications       %" PRIu32 "\n", s->ble_notifications);
+    printf("ble_payload_bytes       %" PRIu32 "\n", s->ble_payload_bytes);
+    printf("ble_tx_events           %" PRIu32 "\n", s->ble_tx_events);
+    printf("ble_queue_full          %" PRIu32 "\n", s->ble_queue_full);
+    printf("ble_send_errors         %" PRIu32 "\n", s->ble_send_errors);
+    if (sim_config.link_error_pct > 0.0) {
+        printf("ble_link_lost           %" PRIu32 "\n", s->ble_link_lost);
+        printf("ble_link_repeated       %" PRIu32 "\n", s->ble_link_repeated);
+    }
+    printf("host_frames             %" PRIu32 "\n", s->host_frames);
+    printf("host_frames_invalid     %" PRIu32 "\n", s->host_frames_invalid);
+    printf("host_frames_lost        %" PRIu32 "\n", s->host_frames_lost);
+    printf("host_frames_repeated    %" PRIu32 "\n", s->host_frames_repeated);
+    if (s->host_records) {
+        printf("host_records            %" PRIu32 "\n", s->host_records);
+        printf("host_records_exact      %" PRIu32 " (%.1f%%)\n",
+               s->host_records_exact, percent(s->host_records_exact, s->host_records));
+    }
+    if (sim_config.format == FRAME_FORMAT_ACTIVITY) {
+        printf("host_activity_changes   %" PRIu32 "\n", s->host_activity_changes);
+        printf("host_activity_keepalives %" PRIu32 "\n", s->host_activity_keepalives);
+    }
+    if (s->host_activity_ns) {
+        // share of the reported timeline that matches the harvester profile
+        printf("host_activity_right     %.1f%% of %.1f s\n",
+               100.0 * s->host_activity_right_ns / s->host_activity_ns, (double)s->host_activity_ns / SIM_NS_PER_S);
+    }
+    printf("host_samples_received   %" PRIu32 "\n", s->host_samples_received);
+    if (s->host_samples_received) {
+        printf("host_bytes_per_sample   %.2f\n", (double)s->host_sample_bytes / s->host_samples_received);
+    }
+    printf("host_samples_matched    %" PRIu32 " (%.1f%%)\n",
+           s->host_samples_matched, percent(s->host_samples_matched, s->host_samples_received));
+    printf("host_samples_timed      %" PRIu32 " (%.1f%%)\n",
+           s->host_samples_timed, percent(s->host_samples_timed, s->host_samples_matched));
+    printf("host_time_marks         %" PRIu32 "\n", s->host_time_marks);
+    printf("host_timeline_gaps      %" PRIu32 "\n", s->host_timeline_gaps);
+    printf("samples_delivered       %.1f%% of generated\n",
+           percent(s->host_samples_matched, s->bma_samples_generated));
+    if (s->latency_count) {
+        printf("irq_to_notify_avg_us    %.1f\n",
+               (double)s->latency_sum_ns / s->latency_count / SIM_NS_PER_US);
+        printf("irq_to_notify_max_us    %.1f\n", (double)s->latency_max_ns / SIM_NS_PER_US);
+    }
+    sim_energy_report();
+    activity_report();
+}
+
+// entry ----------------------------------------------------------------------
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -d, --duration <s>      simulated run time (default 60)\n"
+            "  -V, --v-store <mv>      initial storage capacitor voltage (default 0)\n"
+            "  -p, --harvest-uw <uw>   constant harvester output power (default 800)\n"
+            "  -t, --harvest-trace <f> harvester power trace, \"<time s> <power uW> [activity]\" lines\n"
+            "  -a, --activity <name>   synthetic harvester profile: desk, walking, running, mixed\n"
+            "  -s, --seed <n>          motion model noise seed (default 1)\n"
+            "  -f, --format <name>     sample format the central asks for: 12, 8, rice, features or activity\n"
+            "                          (default 12)\n"
+            "  -w, --window <n>        feature window in samples: 16, 32, 64 or 128 (default 64)\n"
+            "  -l, --link-errors <pct> the central loses pct %% of notifications and gets pct %% twice\n"
+            "  -P, --no-lpcomp         LPCOMP init fails, the firmware polls v_store with the SAADC\n"
+            "  -v, --verbose           print firmware debug log\n"
+            "  -b, --bench             benchmark the firmware data path on canned FIFO images\n"
+            "  -T, --train <file>      train the activity classifier, write the model table to file\n"
+            "  -D, --data <file>       train and benchmark the classifier on a recording,\n"
+            "                          \"<activity> <x> <y> <z>\" lines\n",
+            prog);
+}
+
+int main(int argc, char **argv) {
+    static const struct option long_opts[] = {
+        { "duration", required_argument, NULL, 'd' },
+        { "v-store",  required_argument, NULL, 'V' },
+        { "harvest-uw",    required_argument, NULL, 'p' },
+        { "harvest-trace", required_argument, NULL, 't' },
+        { "activity", required_argument, NULL, 'a' },
+        { "seed",     required_argument, NULL, 's' },
+        { "format",   required_argument, NULL, 'f' },
+        { "window",   required_argument, NULL, 'w' },
+        { "link-errors", required_argument, NULL, 'l' },
+        { "no-lpcomp", no_argument,      NULL, 'P' },
+        { "verbose",  no_argument,       NULL, 'v' },
+        { "bench",    no_argument,       NULL, 'b' },
+        { "train",    required_argument, NULL, 'T' },
+        { "data",     required_argument, NULL, 'D' },
+        { "help",     no_argument,       NULL, 'h' },
+        { 0 }
+    };
+
+    bool bench = false;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "d:V:p:t:a:s:f:w:l:PvbT:D:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'd': sim_config.duration_ns = (uint64_t)(atof(optarg) * SIM_NS_PER_S); break;
+        case 'V': sim_config.v_store_mv = atoi(optarg); break;
+        case 'p': sim_config.harvest_uw = atof(optarg); break;
+        case 't': sim_config.harvest_trace = optarg; break;
+        case 'a': sim_config.activity = optarg; break;
+        case 's': sim_config.seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'f': if (!format_parse(optarg)) return EXIT_FAILURE; break;
+        case 'w': if (!window_parse(optarg)) return EXIT_FAILURE; break;
+        case 'l': sim_config.link_error_pct = atof(optarg); break;
+        case 'P': sim_config.no_lpcomp = true; break;
+        case 'v': sim_config.verbose = true; break;
+        case 'b': bench = true; break;
+        case 'T': sim_config.train_path = optarg; break;
+        case 'D': sim_config.data_path = optarg; break;
+        default:  usage(argv[0]); return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (sim_config.train_path) return sim_train_run();
+    if (bench) return sim_bench_run() ? EXIT_FAILURE : EXIT_SUCCESS;
+
+    if (!sim_harvest_init()) return EXIT_FAILURE;
+    sim_energy_init();
+
+    sim_life_t life = {
+        .time_ns = 0,
+        .stored_uj = sim_energy_stored_uj(),
+        .stats = sim_stats,
+    };
+    while (!life.finished) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("sim: pipe");
+            return EXIT_FAILURE;
+        }
+
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("sim: fork");
+            return EXIT_FAILURE;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            life_fd = fds[1];
+            life_run(&life);
+        }
+
+        close(fds[1]);
+        ssize_t n = read(fds[0], &life, sizeof(life));
+        close(fds[0]);
+        waitpid(pid, NULL, 0);
+        if (n != sizeof(life)) {
+            fprintf(stderr, "sim: firmware process exited without a result\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    sim_time_restore(life.time_ns);
+    sim_stats = life.stats;
+    sim_energy_restore(life.stored_uj);
+    sim_report();
+    return life.status;
+}
@@ -0,0 +1,117 @@
+/**
+ * host simulator -- GPIO pin state and nrfx_gpiote input events
+ */
+
+#include "sim.h"
+#include "nrfx_gpiote.h"
+
+static struct {
+    bool is_output;
+    bool level;
+} gpio[SIM_GPIO_PIN_COUNT];
+
+static struct {
+    bool in_use;
+    bool enabled;
+    nrf_gpiote_polarity_t sense;
+    nrfx_gpiote_evt_handler_t handler;
+} gpiote[SIM_GPIO_PIN_COUNT];
+
+static bool gpiote_initialized = false;
+
+// gpio -----------------------------------------------------------------------
+
+void nrf_gpio_cfg_output(uint32_t pin_number)  { gpio[pin_number].is_output = true; }
+void nrf_gpio_cfg_default(uint32_t pin_number) { gpio[pin_number].is_output = false; }
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config) {
+    gpio[pin_number].is_output = false;
+}
+
+void nrf_gpio_pin_set(uint32_t pin_number)     { gpio[pin_number].level = true; }
+void nrf_gpio_pin_clear(uint32_t pin_number)   { gpio[pin_number].level = false; }
+void nrf_gpio_pin_write(uint32_t pin_number, uint32_t value) {
+    gpio[pin_number].level = (value != 0);
+}
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number) {
+    return gpio[pin_number].level ? 1 : 0;
+}
+
+bool sim_gpio_output_get(uint32_t pin) { return gpio[pin].level; }
+bool sim_gpio_is_output(uint32_t pin)  { return gpio[pin].is_output; }
+
+// driven by device models
+void sim_gpio_input_set(uint32_t pin, bool level) {
+    if (gpio[pin].is_output || gpio[pin].level == level) return;
+    gpio[pin].level = level;
+    sim_gpiote_input_changed(pin, level);
+}
+
+// gpiote ---------------------------------------------------------------------
+
+typedef struct {
+    uint32_t pin;
+    nrf_gpiote_polarity_t action;
+} gpiote_irq_t;
+
+static gpiote_irq_t pending_irq[SIM_GPIO_PIN_COUNT];
+
+static void gpiote_irq(void *p_context) {
+    gpiote_irq_t *p_irq = p_context;
+    if (!gpiote[p_irq->pin].enabled) return;    // disabled while pending
+
+    sim_stats.gpiote_irqs++;
+    gpiote[p_irq->pin].handler(p_irq->pin, p_irq->action);
+}
+
+void sim_gpiote_input_changed(uint32_t pin, bool level) {
+    if (!gpiote[pin].in_use || !gpiote[pin].enabled) return;
+
+    nrf_gpiote_polarity_t edge = level ? NRF_GPIOTE_POLARITY_LOTOHI : NRF_GPIOTE_POLARITY_HITOLO;
+    if ((gpiote[pin].sense & edge) == 0) return;
+
+    pending_irq[pin].pin = pin;
+    pending_irq[pin].action = gpiote[pin].sense;
+    sim_event_schedule(0, gpiote_irq, &pending_irq[pin]);
+}
+
+nrfx_err_t nrfx_gpiote_init(void) {
+    if (gpiote_initialized) return NRFX_ERROR_INVALID_STATE;
+    gpiote_initialized = true;
+    return NRFX_SUCCESS;
+}
+
+bool nrfx_gpiote_is_init(void) {
+    return gpiote_initialized;
+}
+
+nrfx_err_t nrfx_gpiote_in_init(nrfx_gpiote_pin_t pin,
+                               nrfx_gpiote_in_config_t const *p_config,
+                               nrfx_gpiote_evt_handler_t evt_handler) {
+    if (gpiote[pin].in_use) return NRFX_ERROR_INVALID_STATE;
+
+    gpiote[pin].in_use = true;
+    gpiote[pin].enabled = false;
+    gpiote[pin].sense = p_config->sense;
+    gpiote[pin].handler = evt_handler;
+    if (!p_config->skip_gpio_setup) nrf_gpio_cfg_input(pin, p_config->pull);
+    return NRFX_SUCCESS;
+}
+
+void nrfx_gpiote_in_uninit(nrfx_gpiote_pin_t pin) {
+    gpiote[pin].in_use = false;
+    gpiote[pin].enabled = false;
+}
+
+void nrfx_gpiote_in_event_enable(nrfx_gpiote_pin_t pin, bool int_enable) {
+    if (!gpiote[pin].in_use) return;
+    gpiote[pin].enabled = int_enable;
+}
+
+void nrfx_gpiote_in_event_disable(nrfx_gpiote_pin_t pin) {
+    gpiote[pin].enabled = false;
+}
+
+bool nrfx_gpiote_in_is_set(nrfx_gpiote_pin_t pin) {
+    return gpio[pin].level;
+}
@@ -0,0 +1,101 @@
+/**
+ * host simulator -- nrfx_lpcomp backend
+ *
+ * compares the simulated storage capacitor voltage as seen on
+ * GPIO_V_STORE_DIV_IN with a fraction of VDD, which the LTC3109 regulates
+ * from v_store and which follows it below VOUT. the comparator is evaluated
+ * every LPCOMP_STEP_NS of simulated time without waking the CPU; a detected
+ * edge raises the interrupt. with --no-lpcomp, init fails as on a board
+ * without the comparator input.
+ */
+
+#include "sim.h"
+#include "nrfx_lpcomp.h"
+#include "app_common.h"
+
+#define LPCOMP_STEP_NS          SIM_MS(1)
+
+static struct {
+    bool initialized;
+    bool enabled;
+    bool above;                 // last comparison
+    nrfx_lpcomp_config_t config;
+    nrfx_lpcomp_event_handler_t handler;
+    uint32_t step_event_id;
+} lpcomp;
+
+static double lpcomp_input_mv(void) {
+    if (lpcomp.config.input != GPIO_V_STORE_LPCOMP_IN) return 0;
+    return sim_supply_v_store_div_mv();
+}
+
+// reference in 1/16 VDD: SUPPLY_1_8..7_8 are 0..6, SUPPLY_1_16..15_16 8..15
+static int32_t lpcomp_ref_mv(void) {
+    uint32_t ref = lpcomp.config.hal.reference;
+    uint32_t sixteenths = (ref < NRF_LPCOMP_REF_EXT_REF0) ? 2 * (ref + 1) : 2 * (ref - 8) + 1;
+    return sim_supply_vdd_mv() * (int32_t)sixteenths / 16;
+}
+
+static bool lpcomp_compare(void) {
+    return lpcomp_input_mv() > lpcomp_ref_mv();
+}
+
+static void lpcomp_irq(void *p_context) {
+    if (!lpcomp.enabled) return;    // disabled while pending
+
+    // a sample the handler triggers books the wake-up already
+    uint32_t v_store_wakeups = sim_stats.v_store_wakeups;
+    sim_stats.lpcomp_irqs++;
+    lpcomp.handler((nrf_lpcomp_event_t)(uintptr_t)p_context);
+    if (sim_stats.v_store_wakeups == v_store_wakeups) sim_stats.v_store_wakeups++;
+}
+
+static void lpcomp_step(void *p_context) {
+    bool above = lpcomp_compare();
+    lpcomp.step_event_id = sim_event_schedule_silent(LPCOMP_STEP_NS, lpcomp_step, NULL);
+    if (above == lpcomp.above) return;
+    lpcomp.above = above;
+
+    nrf_lpcomp_detect_t detect = lpcomp.config.hal.detection;
+    nrf_lpcomp_event_t event = above ? NRF_LPCOMP_EVENT_UP : NRF_LPCOMP_EVENT_DOWN;
+    if (detect == NRF_LPCOMP_DETECT_CROSS) event = NRF_LPCOMP_EVENT_CROSS;
+    else if ((detect == NRF_LPCOMP_DETECT_UP) != above) return;
+
+    sim_event_schedule(0, lpcomp_irq, (void *)(uintptr_t)event);
+}
+
+nrfx_err_t nrfx_lpcomp_init(nrfx_lpcomp_config_t const *p_config,
+                            nrfx_lpcomp_event_handler_t event_handler) {
+    if (sim_config.no_lpcomp) return NRFX_ERROR_NOT_SUPPORTED;
+    if (lpcomp.initialized) return NRFX_ERROR_INVALID_STATE;
+    if (p_config->hal.reference == NRF_LPCOMP_REF_EXT_REF0 ||
+        p_config->hal.reference == NRF_LPCOMP_REF_EXT_REF1) return NRFX_ERROR_NOT_SUPPORTED;
+
+    lpcomp.initialized = true;
+    lpcomp.config = *p_config;
+    lpcomp.handler = event_handler;
+    return NRFX_SUCCESS;
+}
+
+void nrfx_lpcomp_uninit(void) {
+    nrfx_lpcomp_disable();
+    lpcomp.initialized = false;
+}
+
+void nrfx_lpcomp_enable(void) {
+    if (!lpcomp.initialized || lpcomp.enabled) return;
+
+    // edges only: an input already above the reference raises nothing
+    lpcomp.enabled = true;
+    lpcomp.above = lpcomp_compare();
+    lpcomp.step_event_id = sim_event_schedule_silent(LPCOMP_STEP_NS, lpcomp_step, NULL);
+    sim_energy_lpcomp_active(true);
+}
+
+void nrfx_lpcomp_disable(void) {
+    if (!lpcomp.enabled) return;
+
+    lpcomp.enabled = false;
+    sim_event_cancel(lpcomp.step_event_id);
+    sim_energy_lpcomp_active(false);
+}
@@ -0,0 +1,63 @@
+/**
+ * host simulator -- nrfx_ppi backend
+ *
+ * connects the events the models raise (sim_ppi_event()) to the tasks they
+ * are assigned to. the only task modelled is SAADC SAMPLE.
+ */
+
+#include "sim.h"
+#include "nrfx_ppi.h"
+#include "nrfx_saadc.h"
+
+static struct {
+    bool allocated;
+    bool enabled;
+    uint32_t eep;
+    uint32_t tep;
+} ppi[NRF_PPI_CHANNEL_COUNT];
+
+static void ppi_task(uint32_t tep) {
+    if (tep == nrfx_saadc_sample_task_get()) sim_saadc_task_sample();
+}
+
+void sim_ppi_event(uint32_t eep) {
+    for (uint32_t ch = 0; ch < NRF_PPI_CHANNEL_COUNT; ch++) {
+        if (ppi[ch].enabled && ppi[ch].eep == eep) ppi_task(ppi[ch].tep);
+    }
+}
+
+nrfx_err_t nrfx_ppi_channel_alloc(nrf_ppi_channel_t *p_channel) {
+    for (uint32_t ch = 0; ch < NRF_PPI_CHANNEL_COUNT; ch++) {
+        if (ppi[ch].allocated) continue;
+        ppi[ch].allocated = true;
+        *p_channel = (nrf_ppi_channel_t)ch;
+        return NRFX_SUCCESS;
+    }
+    return NRFX_ERROR_NO_MEM;
+}
+
+nrfx_err_t nrfx_ppi_channel_free(nrf_ppi_channel_t channel) {
+    if (channel >= NRF_PPI_CHANNEL_COUNT || !ppi[channel].allocated) return NRFX_ERROR_INVALID_STATE;
+    ppi[channel] = (typeof(ppi[channel])){ 0 };
+    return NRFX_SUCCESS;
+}
+
+nrfx_err_t nrfx_ppi_channel_assign(nrf_ppi_channel_t channel, uint32_t eep, uint32_t tep) {
+    if (channel >= NRF_PPI_CHANNEL_COUNT || !ppi[channel].allocated) return NRFX_ERROR_INVALID_STATE;
+    if (eep == 0 || tep == 0) return NRFX_ERROR_NULL;
+    ppi[channel].eep = eep;
+    ppi[channel].tep = tep;
+    return NRFX_SUCCESS;
+}
+
+nrfx_err_t nrfx_ppi_channel_enable(nrf_ppi_channel_t channel) {
+    if (channel >= NRF_PPI_CHANNEL_COUNT || !ppi[channel].allocated) return NRFX_ERROR_INVALID_STATE;
+    ppi[channel].enabled = true;
+    return NRFX_SUCCESS;
+}
+
+nrfx_err_t nrfx_ppi_channel_disable(nrf_ppi_channel_t channel) {
+    if (channel >= NRF_PPI_CHANNEL_COUNT || !ppi[channel].allocated) return NRFX_ERROR_INVALID_STATE;
+    ppi[channel].enabled = false;
+    return NRFX_SUCCESS;
+}
@@ -0,0 +1,286 @@
+/**
+ * host simulator -- nrfx_saadc backend
+ *
+ * converts the simulated storage capacitor voltage as seen on
+ * GPIO_V_STORE_DIV_IN, the divider output the supply model charges while
+ * GPIO_DIV_EN drives the PMOS gate low. conversions triggered through PPI (sim_saadc_task_sample())
+ * run without the CPU; only a full buffer or a limit crossed raises the
+ * interrupt.
+ *
+ * every conversion adds an input offset and noise; CALIBRATEOFFSET shrinks
+ * the offset to what is left after it, until power is lost. oversampling
+ * averages 2^n conversions of the rounded result, as the SAADC does. the
+ * offset, the noise and the calibration time are assumptions, the product
+ * specification gives none of them for this configuration.
+ */
+
+#include "sim.h"
+#include "nrfx_saadc.h"
+#include "app_common.h"
+
+#include <math.h>
+
+#define SAADC_REF_MV            600
+#define SAADC_T_CONV_NS         SIM_US(2)
+#define SAADC_T_CALIBRATE_NS    SIM_US(100)
+#define SAADC_OFFSET_MV         3.0     // at the pin, before CALIBRATEOFFSET
+#define SAADC_OFFSET_CAL_MV     0.4     // left after it
+#define SAADC_NOISE_MV          0.3     // rms, per conversion
+
+static struct {
+    bool initialized;
+    bool busy;
+    bool calibrated;            // kept across uninit, lost with power
+    nrfx_saadc_config_t config;
+    nrfx_saadc_event_handler_t handler;
+    nrf_saadc_channel_config_t channel;
+    nrf_saadc_value_t *p_buffer;
+    uint16_t buffer_size;
+    uint16_t buffer_pos;
+    nrf_saadc_value_t *p_next;  // queued by a second buffer_convert()
+    uint16_t next_size;
+    int16_t limit_low;
+    int16_t limit_high;
+    struct {                    // events of the interrupt not yet handled
+        nrf_saadc_value_t *p_done;
+        uint16_t done_size;
+        bool limit;
+        nrf_saadc_limit_t limit_type;
+        uint32_t event_id;
+    } irq;
+} saadc;
+
+static uint32_t noise_state;
+
+static const uint32_t acq_time_ns[] = {
+    [NRF_SAADC_ACQTIME_3US]  = SIM_US(3),  [NRF_SAADC_ACQTIME_5US]  = SIM_US(5),
+    [NRF_SAADC_ACQTIME_10US] = SIM_US(10), [NRF_SAADC_ACQTIME_15US] = SIM_US(15),
+    [NRF_SAADC_ACQTIME_20US] = SIM_US(20), [NRF_SAADC_ACQTIME_40US] = SIM_US(40)
+};
+
+// gain as a fraction (numerator / denominator)
+static const uint8_t gain_num[] = { 1, 1, 1, 1, 1, 1, 2, 4 };
+static const uint8_t gain_den[] = { 6, 5, 4, 3, 2, 1, 1, 1 };
+
+static double saadc_pin_mv(void) {
+    if (saadc.channel.pin_p != GPIO_V_STORE_DIV_IN) return 0;
+    return sim_supply_v_store_div_mv();
+}
+
+// deterministic noise in [-1, 1)
+static double noise(void) {
+    noise_state = noise_state * 1664525u + 1013904223u;
+    return (double)(int32_t)noise_state / 2147483648.0;
+}
+
+static int32_t saadc_full_scale(void) {
+    return 1 << (8 + 2 * (int32_t)saadc.config.resolution);
+}
+
+// at the pin
+static double saadc_lsb_mv(void) {
+    return (double)SAADC_REF_MV * gain_den[saadc.channel.gain]
+         / gain_num[saadc.channel.gain] / saadc_full_scale();
+}
+
+// one result, from 2^oversample conversions. single ended results go a little
+// negative around 0V
+static nrf_saadc_value_t saadc_convert(void) {
+    int32_t full_scale = saadc_full_scale();
+    double lsb_mv = saadc_lsb_mv();
+    double offset_mv = saadc.calibrated ? SAADC_OFFSET_CAL_MV : SAADC_OFFSET_MV;
+    double pin_mv = saadc_pin_mv();
+
+    uint32_t n = 1u << saadc.config.oversample;
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        // three uniform draws: roughly normal, rms 1
+        double noise_mv = SAADC_NOISE_MV * (noise() + noise() + noise());
+        int32_t value = (int32_t)lround((pin_mv + offset_mv + noise_mv) / lsb_mv);
+        sum += MAX(MIN(value, full_scale - 1), -full_scale);
+    }
+    return (nrf_saadc_value_t)lround((double)sum / n);
+}
+
+static uint64_t saadc_sample_time_ns(void) {
+    uint32_t n_oversample = 1u << saadc.config.oversample;
+    return (uint64_t)n_oversample * (acq_time_ns[saadc.channel.acq_time] + SAADC_T_CONV_NS);
+}
+
+// the DONE and LIMIT events, in the order the nrfx IRQ handler reports them
+static void saadc_irq(void *p_context) {
+    typeof(saadc.irq) irq = saadc.irq;
+    saadc.irq = (typeof(saadc.irq)){ 0 };
+    sim_stats.v_store_wakeups++;
+
+    if (irq.p_done) {
+        nrfx_saadc_evt_t evt = {
+            .type = NRFX_SAADC_EVT_DONE,
+            .data.done = { .p_buffer = irq.p_done, .size = irq.done_size }
+        };
+        saadc.handler(&evt);
+    }
+    if (irq.limit) {
+        nrfx_saadc_evt_t evt = {
+            .type = NRFX_SAADC_EVT_LIMIT,
+            .data.limit = { .channel = 0, .limit_type = irq.limit_type }
+        };
+        saadc.handler(&evt);
+    }
+}
+
+// p_context is non-NULL for a conversion PPI triggered
+static void saadc_sample_done(void *p_context) {
+    saadc.busy = false;
+    if (saadc.p_buffer == NULL) return;     // uninit while converting
+
+    nrf_saadc_value_t value = saadc_convert();
+    saadc.p_buffer[saadc.buffer_pos++] = value;
+    sim_stats.saadc_samples++;
+    sim_energy_saadc_conversions(1u << saadc.config.oversample);
+
+    // the conversion's own error, quantization, offset and noise, scaled up to
+    // v_store. the divider lagging v_store is left out
+    if (saadc.channel.pin_p == GPIO_V_STORE_DIV_IN) {
+        double err_mv = fabs(value * saadc_lsb_mv() - saadc_pin_mv()) * V_STORE_DIV_INV;
+        sim_stats.saadc_v_store_reads++;
+        sim_stats.saadc_err_sum_mv += err_mv;
+        sim_stats.saadc_err_max_mv = MAX(sim_stats.saadc_err_max_mv, err_mv);
+    }
+
+    bool above = (saadc.limit_high != NRFX_SAADC_LIMITH_DISABLED && value >= saadc.limit_high);
+    bool below = (saadc.limit_low != NRFX_SAADC_LIMITL_DISABLED && value <= saadc.limit_low);
+    if (above || below) {
+        saadc.irq.limit = true;
+        saadc.irq.limit_type = above ? NRF_SAADC_LIMIT_HIGH : NRF_SAADC_LIMIT_LOW;
+    }
+    if (saadc.buffer_pos == saadc.buffer_size) {
+        saadc.irq.p_done = saadc.p_buffer;
+        saadc.irq.done_size = saadc.buffer_size;
+        saadc.p_buffer = saadc.p_next;
+        saadc.buffer_size = saadc.next_size;
+        saadc.buffer_pos = 0;
+        saadc.p_next = NULL;
+    }
+    if (!saadc.irq.p_done && !saadc.irq.limit) return;
+
+    if (p_context == NULL) {
+        saadc_irq(NULL);    // this event is the interrupt
+    } else if (saadc.irq.event_id == SIM_EVENT_INVALID) {
+        saadc.irq.event_id = sim_event_schedule(0, saadc_irq, NULL);
+    }
+}
+
+nrfx_err_t nrfx_saadc_init(nrfx_saadc_config_t const *p_config,
+                           nrfx_saadc_event_handler_t event_handler) {
+    if (saadc.initialized) return NRFX_ERROR_INVALID_STATE;
+    if (event_handler == NULL) return NRFX_ERROR_INVALID_PARAM;
+    sim_hw_init_done();
+
+    saadc.initialized = true;
+    saadc.config = *p_config;
+    saadc.handler = event_handler;
+    saadc.p_buffer = NULL;
+    saadc.p_next = NULL;
+    saadc.limit_low = NRFX_SAADC_LIMITL_DISABLED;
+    saadc.limit_high = NRFX_SAADC_LIMITH_DISABLED;
+    sim_stats.saadc_inits++;
+    if (noise_state == 0) noise_state = sim_config.seed ? sim_config.seed : 1;
+    return NRFX_SUCCESS;
+}
+
+void nrfx_saadc_uninit(void) {
+    saadc.initialized = false;
+    saadc.busy = false;
+    saadc.p_buffer = NULL;
+    saadc.p_next = NULL;
+    sim_event_cancel(saadc.irq.event_id);
+    saadc.irq = (typeof(saadc.irq)){ 0 };
+}
+
+nrfx_err_t nrfx_saadc_channel_init(uint8_t channel, nrf_saadc_channel_config_t const *p_config) {
+    if (!saadc.initialized) return NRFX_ERROR_INVALID_STATE;
+    if (channel != 0) return NRFX_ERROR_NOT_SUPPORTED;
+
+    saadc.channel = *p_config;
+    return NRFX_SUCCESS;
+}
+
+nrfx_err_t nrfx_saadc_buffer_convert(nrf_saadc_value_t *p_buffer, uint16_t size) {
+    if (!saadc.initialized) return NRFX_ERROR_INVALID_STATE;
+    if (saadc.p_buffer != NULL) {
+        if (saadc.p_next != NULL) return NRFX_ERROR_BUSY;
+        saadc.p_next = p_buffer;
+        saadc.next_size = size;
+        return NRFX_SUCCESS;
+    }
+
+    saadc.p_buffer = p_buffer;
+    saadc.buffer_size = size;
+    saadc.buffer_pos = 0;
+    return NRFX_SUCCESS;
+}
+
+nrfx_err_t nrfx_saadc_sample(void) {
+    if (!saadc.initialized || saadc.p_buffer == NULL) return NRFX_ERROR_INVALID_STATE;
+    if (saadc.busy) return NRFX_ERROR_BUSY;
+
+    saadc.busy = true;
+    sim_stats.v_store_wakeups++;    // the CPU woke up to trigger it
+    sim_event_schedule(saadc_sample_time_ns(), saadc_sample_done, NULL);
+    return NRFX_SUCCESS;
+}
+
+// SAMPLE task through PPI. a trigger while converting or without a buffer
+// is lost, as on the hardware
+void sim_saadc_task_sample(void) {
+    if (!saadc.initialized || saadc.p_buffer == NULL || saadc.busy) return;
+
+    saadc.busy = true;
+    sim_event_schedule_silent(saadc_sample_time_ns(), saadc_sample_done, &saadc);
+}
+
+uint32_t nrfx_saadc_sample_task_get(void) {
+    return NRF_SAADC_BASE + NRF_SAADC_TASK_SAMPLE;
+}
+
+void nrfx_saadc_limits_set(uint8_t channel, int16_t limit_low, int16_t limit_high) {
+    saadc.limit_low = limit_low;
+    saadc.limit_high = limit_high;
+}
+
+// blocking, the CPU spins through the conversions. returns nothing to the
+// buffer and raises no event
+nrfx_err_t nrfx_saadc_sample_convert(uint8_t channel, nrf_saadc_value_t *p_value) {
+    if (!saadc.initialized || channel != 0) return NRFX_ERROR_INVALID_STATE;
+    if (saadc.busy || saadc.p_buffer != NULL) return NRFX_ERROR_BUSY;
+
+    *p_value = saadc_convert();
+    sim_stats.saadc_samples++;
+    sim_energy_saadc_conversions(1u << saadc.config.oversample);
+    return NRFX_SUCCESS;
+}
+
+static void saadc_calibrate_done(void *p_context) {
+    if (!saadc.initialized) return;     // uninit while calibrating
+
+    saadc.busy = false;
+    saadc.calibrated = true;
+    sim_stats.v_store_wakeups++;
+    nrfx_saadc_evt_t evt = { .type = NRFX_SAADC_EVT_CALIBRATEDONE };
+    saadc.handler(&evt);
+}
+
+nrfx_err_t nrfx_saadc_calibrate_offset(void) {
+    if (!saadc.initialized) return NRFX_ERROR_INVALID_STATE;
+    if (saadc.busy || saadc.p_buffer != NULL) return NRFX_ERROR_BUSY;
+
+    saadc.busy = true;
+    sim_energy_saadc_conversions(1);
+    sim_event_schedule(SAADC_T_CALIBRATE_NS, saadc_calibrate_done, NULL);
+    return NRFX_SUCCESS;
+}
+
+bool nrfx_saadc_is_busy(void) {
+    return saadc.busy;
+}
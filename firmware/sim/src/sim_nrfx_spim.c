@@ -0,0 +1,115 @@
+/**
+ * host simulator -- nrfx_spim backend
+ *
+ * a transfer is exchanged with the device selected by ss_pin when it starts;
+ * NRFX_SPIM_EVENT_DONE fires once the bytes would have been clocked out at
+ * the current SPI clock (nrf_spim_frequency_set() changes it between
+ * transfers). HFCLK and the SPIM stay on for that long.
+ */
+
+#include "sim.h"
+#include "nrfx_spim.h"
+#include "app_common.h"
+
+#include <string.h>
+
+#define SPIM_XFER_OVERHEAD_NS   SIM_US(2)   // START task, CS setup/hold
+#define SPIM_INIT_NS            SIM_US(25)  // nrfx_spim_init() + uninit: pins, registers, IRQ
+
+static struct {
+    bool initialized;
+    bool busy;
+    nrfx_spim_config_t config;
+    nrfx_spim_evt_handler_t handler;
+    void *p_context;
+    nrfx_spim_evt_t evt;
+} spim;
+
+static uint32_t spim_freq_hz(nrf_spim_frequency_t frequency) {
+    switch (frequency) {
+    case NRF_SPIM_FREQ_125K:    return 125000;
+    case NRF_SPIM_FREQ_250K:    return 250000;
+    case NRF_SPIM_FREQ_500K:    return 500000;
+    case NRF_SPIM_FREQ_1M:      return 1000000;
+    case NRF_SPIM_FREQ_2M:      return 2000000;
+    case NRF_SPIM_FREQ_4M:      return 4000000;
+    case NRF_SPIM_FREQ_8M:      return 8000000;
+    default:                    return 1000000;
+    }
+}
+
+// HFCLK / SPIM on time of one transfer
+uint64_t sim_spim_xfer_ns(size_t len, nrf_spim_frequency_t frequency) {
+    return SPIM_XFER_OVERHEAD_NS + (uint64_t)len * 8 * SIM_NS_PER_S / spim_freq_hz(frequency);
+}
+
+static void spim_xfer_done(void *p_context) {
+    spim.busy = false;
+    if (spim.handler) spim.handler(&spim.evt, spim.p_context);
+}
+
+nrfx_err_t nrfx_spim_init(nrfx_spim_t const *p_instance,
+                          nrfx_spim_config_t const *p_config,
+                          nrfx_spim_evt_handler_t handler,
+                          void *p_context) {
+    if (spim.initialized) return NRFX_ERROR_INVALID_STATE;
+
+    spim.initialized = true;
+    spim.busy = false;
+    spim.config = *p_config;
+    spim.handler = handler;
+    spim.p_context = p_context;
+    sim_stats.spim_inits++;
+    sim_stats.spim_init_ns += SPIM_INIT_NS;
+    sim_energy_spim_init();
+    return NRFX_SUCCESS;
+}
+
+void nrfx_spim_uninit(nrfx_spim_t const *p_instance) {
+    spim.initialized = false;
+}
+
+void nrf_spim_frequency_set(NRF_SPIM_Type *p_reg, nrf_spim_frequency_t frequency) {
+    spim.config.frequency = frequency;
+}
+
+nrfx_err_t nrfx_spim_xfer(nrfx_spim_t const *p_instance,
+                          nrfx_spim_xfer_desc_t const *p_xfer_desc,
+                          uint32_t flags) {
+    if (!spim.initialized) return NRFX_ERROR_INVALID_STATE;
+    if (spim.busy) return NRFX_ERROR_BUSY;
+    if (p_xfer_desc->tx_length >= (1UL << SPIM1_EASYDMA_MAXCNT_SIZE) ||
+        p_xfer_desc->rx_length >= (1UL << SPIM1_EASYDMA_MAXCNT_SIZE)) {
+        return NRFX_ERROR_INVALID_LENGTH;
+    }
+
+    size_t len = MAX(p_xfer_desc->tx_length, p_xfer_desc->rx_length);
+    uint32_t fifo_xfers = sim_stats.bma_fifo_xfers;
+
+    if (spim.config.ss_pin == IMU_CS) {
+        sim_bma400_xfer(p_xfer_desc->p_tx_buffer, p_xfer_desc->tx_length,
+                        p_xfer_desc->p_rx_buffer, p_xfer_desc->rx_length,
+                        spim.config.orc);
+    } else if (p_xfer_desc->p_rx_buffer) {
+        memset(p_xfer_desc->p_rx_buffer, 0xFF, p_xfer_desc->rx_length);
+    }
+
+    uint64_t duration_ns = sim_spim_xfer_ns(len, spim.config.frequency);
+
+    sim_stats.spi_xfers++;
+    sim_stats.spi_bytes += len;
+    sim_stats.spi_active_ns += duration_ns;
+    if (sim_stats.bma_fifo_xfers != fifo_xfers) sim_stats.spi_fifo_active_ns += duration_ns;
+    sim_energy_spi_xfer(duration_ns);
+
+    spim.busy = true;
+    spim.evt.type = NRFX_SPIM_EVENT_DONE;
+    spim.evt.xfer_desc = *p_xfer_desc;
+
+    if (flags & NRFX_SPIM_FLAG_NO_XFER_EVT_HANDLER) {
+        spim.busy = false;
+        return NRFX_SUCCESS;
+    }
+    sim_event_schedule(duration_ns, spim_xfer_done, NULL);
+    return NRFX_SUCCESS;
+}
@@ -0,0 +1,424 @@
+/**
+ * host simulator -- activity classifier training and export (--train)
+ *
+ * builds a data set of labelled windows, reduces them with the firmware's own
+ * features_compute() and classifier_inputs(), grows a decision tree on the
+ * training part and writes it as the app_classifier.h model table. the
+ * windows come from the BMA400 motion model (desk, walking, running at 25, 50
+ * and 100 Hz, every window length, training and held-out windows an hour
+ * apart), each with a random gain of 0.5 to 1.5 and worn in a random one of
+ * the 24 axis orientations so the tree cannot lean on the model's exact
+ * amplitudes and axes, or from a recording (--data): one "<activity> <x> <y> <z>" sample
+ * per line, 12 bit LSB at +-4 g, at 25 Hz or the rate of the last "odr <hz>"
+ * line. a recording is cut into windows of every length per run of equal
+ * labels, every fourth window is held out.
+ *
+ * the tree is CART: the split with the lowest Gini impurity of all inputs
+ * and thresholds halfway between neighbouring values, down to
+ * TRAIN_DEPTH_MAX or TRAIN_LEAF_MIN windows. subtrees that end in one
+ * activity are merged into a leaf.
+ */
+
+#include "sim.h"
+#include "app_common.h"
+#include "app_classifier.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define TRAIN_DEPTH_MAX     6
+#define TRAIN_LEAF_MIN      4
+#define TRAIN_NODES_MAX     ((1 << (TRAIN_DEPTH_MAX + 1)) - 1)
+
+#define SYNTH_WINDOWS       48      // per activity, ODR and window length
+#define SYNTH_HELD_OUT_NS   SIM_S(3600)
+#define DATA_ODR_HZ         25
+#define DATA_HELD_OUT       4       // every fourth window of a recording
+
+#define SYNTH_1G_LSB        512     // at +-4 g
+
+static const uint16_t synth_odr_hz[] = { 25, 50, 100 };
+static uint32_t synth_state = 1;
+
+static const char *input_names[CLASSIFIER_INPUTS] = {
+    [CLASSIFIER_IN_MEAN_X]   = "CLASSIFIER_IN_MEAN_X",
+    [CLASSIFIER_IN_MEAN_Y]   = "CLASSIFIER_IN_MEAN_Y",
+    [CLASSIFIER_IN_MEAN_Z]   = "CLASSIFIER_IN_MEAN_Z",
+    [CLASSIFIER_IN_VAR_X]    = "CLASSIFIER_IN_VAR_X",
+    [CLASSIFIER_IN_VAR_Y]    = "CLASSIFIER_IN_VAR_Y",
+    [CLASSIFIER_IN_VAR_Z]    = "CLASSIFIER_IN_VAR_Z",
+    [CLASSIFIER_IN_VAR_SUM]  = "CLASSIFIER_IN_VAR_SUM",
+    [CLASSIFIER_IN_ZC_X]     = "CLASSIFIER_IN_ZC_X",
+    [CLASSIFIER_IN_ZC_Y]     = "CLASSIFIER_IN_ZC_Y",
+    [CLASSIFIER_IN_ZC_Z]     = "CLASSIFIER_IN_ZC_Z",
+    [CLASSIFIER_IN_FREQ_X]   = "CLASSIFIER_IN_FREQ_X",
+    [CLASSIFIER_IN_FREQ_Y]   = "CLASSIFIER_IN_FREQ_Y",
+    [CLASSIFIER_IN_FREQ_Z]   = "CLASSIFIER_IN_FREQ_Z",
+};
+
+static const char *activity_macros[ACTIVITY_COUNT] = {
+    [ACTIVITY_DESK]    = "ACTIVITY_DESK",
+    [ACTIVITY_WALKING] = "ACTIVITY_WALKING",
+    [ACTIVITY_RUNNING] = "ACTIVITY_RUNNING",
+};
+
+// data set -------------------------------------------------------------------
+
+static uint16_t odr_ticks(uint16_t hz) {
+    return (uint16_t)(CLASSIFIER_TICK_HZ / hz);
+}
+
+static void dataset_add(sim_dataset_t *p_set, int16_t const *p_xyz, uint8_t n_samples, uint16_t ticks,
+                        uint8_t activity) {
+    static uint8_t raw[6 * FEATURES_WINDOW_MAX];
+
+    if (p_set->n_windows == p_set->capacity) {
+        p_set->capacity = p_set->capacity ? 2 * p_set->capacity : 256;
+        p_set->p_windows = realloc(p_set->p_windows, p_set->capacity * sizeof(p_set->p_windows[0]));
+        if (!p_set->p_windows) abort();
+    }
+
+    // the send buffer's layout, so the firmware's features_compute() reads it
+    for (uint16_t i = 0; i < 3 * n_samples; i++) {
+        raw[2 * i] = (uint8_t)p_xyz[i];
+        raw[2 * i + 1] = (uint8_t)((uint16_t)p_xyz[i] >> 8);
+    }
+    sim_window_t *p_window = &p_set->p_windows[p_set->n_windows++];
+    features_compute(raw, n_samples, &p_window->features);
+    p_window->odr_ticks = ticks;
+    p_window->activity = activity;
+}
+
+static uint32_t synth_rand(void) {
+    synth_state = synth_state * 1664525u + 1013904223u;
+    return synth_state >> 8;
+}
+
+// SYNTH_WINDOWS consecutive windows of the motion model from t0_ns
+static void synth_add(sim_dataset_t *p_set, sim_activity_t activity, uint16_t hz, uint8_t n_samples,
+                      uint64_t t0_ns) {
+    int16_t xyz[3 * FEATURES_WINDOW_MAX];
+    uint64_t period_ns = SIM_NS_PER_S / hz;
+
+    for (uint16_t w = 0; w < SYNTH_WINDOWS; w++) {
+        // gain in 1/256, the axis the model's x, y and z end up on, and signs
+        int32_t gain = 128 + (int32_t)(synth_rand() % 257);
+        uint8_t axes = (uint8_t)(synth_rand() % 6);
+        uint8_t to[3] = { axes / 2, 0, 0 };
+        to[1] = (to[0] + 1 + axes % 2) % 3;
+        to[2] = 3 - to[0] - to[1];
+        uint8_t signs = (uint8_t)(synth_rand() % 4);
+
+        for (uint16_t n = 0; n < n_samples; n++) {
+            sim_sample_t sample;
+            sim_bma400_motion(activity, t0_ns + ((uint64_t)w * n_samples + n) * period_ns, &sample);
+            int32_t v[3] = { sample.x, sample.y, sample.z - SYNTH_1G_LSB };
+            for (uint8_t axis = 0; axis < 3; axis++) {
+                // a proper rotation: the third sign follows from the permutation and the other two
+                int32_t sign = (axis < 2) ? ((signs >> axis) & 1) ? -1 : 1
+                             : ((((signs & 1) ^ (signs >> 1)) ^ (axes % 2)) ? -1 : 1);
+                int32_t x = sign * (v[axis] * gain / 256 + ((axis == 2) ? SYNTH_1G_LSB : 0));
+                xyz[3 * n + to[axis]] = (int16_t)MIN(MAX(x, -2048), 2047);
+            }
+        }
+        dataset_add(p_set, xyz, n_samples, odr_ticks(hz), (uint8_t)(activity - SIM_ACTIVITY_DESK));
+    }
+}
+
+static void synth_build(sim_dataset_t *p_train, sim_dataset_t *p_test) {
+    for (sim_activity_t a = SIM_ACTIVITY_DESK; a <= SIM_ACTIVITY_RUNNING; a++) {
+        for (uint8_t i = 0; i < ARRAY_SIZE(synth_odr_hz); i++) {
+            for (uint16_t n = FEATURES_WINDOW_MIN; n <= FEATURES_WINDOW_MAX; n *= 2) {
+                synth_add(p_train, a, synth_odr_hz[i], (uint8_t)n, 0);
+                synth_add(p_test, a, synth_odr_hz[i], (uint8_t)n, SYNTH_HELD_OUT_NS);
+            }
+        }
+    }
+}
+
+// a run of samples with one label and ODR, cut into windows of every length
+static void data_run_add(sim_dataset_t *p_train, sim_dataset_t *p_test, int16_t const *p_xyz, uint32_t n_run,
+                         uint16_t ticks, uint8_t activity) {
+    for (uint16_t n = FEATURES_WINDOW_MIN; n <= FEATURES_WINDOW_MAX; n *= 2) {
+        for (uint32_t w = 0; (w + 1) * n <= n_run; w++) {
+            dataset_add((w % DATA_HELD_OUT == DATA_HELD_OUT - 1) ? p_test : p_train,
+                        &p_xyz[3 * w * n], (uint8_t)n, ticks, activity);
+        }
+    }
+}
+
+static bool data_load(const char *path, sim_dataset_t *p_train, sim_dataset_t *p_test) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    int16_t *p_xyz = NULL;
+    uint32_t n_run = 0, capacity = 0;
+    uint16_t ticks = odr_ticks(DATA_ODR_HZ);
+    uint8_t run_activity = ACTIVITY_UNKNOWN;
+    char line[128];
+    unsigned line_no = 0;
+    bool ok = true;
+
+    while (ok && fgets(line, sizeof(line), f)) {
+        char label[16];
+        int x, y, z;
+        unsigned hz;
+        line_no++;
+
+        uint8_t activity = ACTIVITY_UNKNOWN;
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') continue;
+        if (sscanf(line, "odr %u", &hz) == 1) {
+            ok = hz == 25 || hz == 50 || hz == 100;
+        } else if ((ok = sscanf(line, "%15s %d %d %d", label, &x, &y, &z) == 4
+                      && x >= -2048 && x <= 2047 && y >= -2048 && y <= 2047 && z >= -2048 && z <= 2047)) {
+            for (uint8_t i = 0; i < ACTIVITY_COUNT; i++) {
+                if (strcmp(label, sim_activity_name((sim_activity_t)(SIM_ACTIVITY_DESK + i))) == 0) activity = i;
+            }
+            ok = activity != ACTIVITY_UNKNOWN;
+        }
+        if (!ok) {
+            fprintf(stderr, "sim: %s:%u: expected \"<desk|walking|running> <x> <y> <z>\" or \"odr <25|50|100>\"\n",
+                    path, line_no);
+            break;
+        }
+
+        // a new label or ODR ends the run
+        bool is_odr = activity == ACTIVITY_UNKNOWN;
+        if (n_run && (is_odr ? odr_ticks((uint16_t)hz) != ticks : activity != run_activity)) {
+            data_run_add(p_train, p_test, p_xyz, n_run, ticks, run_activity);
+            n_run = 0;
+        }
+        if (is_odr) {
+            ticks = odr_ticks((uint16_t)hz);
+            continue;
+        }
+
+        if (n_run == capacity) {
+            capacity = capacity ? 2 * capacity : 4096;
+            p_xyz = realloc(p_xyz, 3 * capacity * sizeof(p_xyz[0]));
+            if (!p_xyz) abort();
+        }
+        p_xyz[3 * n_run] = (int16_t)x;
+        p_xyz[3 * n_run + 1] = (int16_t)y;
+        p_xyz[3 * n_run + 2] = (int16_t)z;
+        n_run++;
+        run_activity = activity;
+    }
+    if (ok && n_run) data_run_add(p_train, p_test, p_xyz, n_run, ticks, run_activity);
+
+    free(p_xyz);
+    fclose(f);
+    if (ok && (p_train->n_windows == 0 || p_test->n_windows == 0)) {
+        fprintf(stderr, "sim: %s: too short for a training and a held-out window\n", path);
+        ok = false;
+    }
+    return ok;
+}
+
+// training and held-out windows of the recording given with --data, or of
+// the motion model
+bool sim_dataset_build(sim_dataset_t *p_train, sim_dataset_t *p_test) {
+    memset(p_train, 0, sizeof(*p_train));
+    memset(p_test, 0, sizeof(*p_test));
+    if (sim_config.data_path) return data_load(sim_config.data_path, p_train, p_test);
+    synth_build(p_train, p_test);
+    return true;
+}
+
+void sim_dataset_free(sim_dataset_t *p_set) {
+    free(p_set->p_windows);
+    memset(p_set, 0, sizeof(*p_set));
+}
+
+// tree -----------------------------------------------------------------------
+
+typedef struct {
+    int32_t inputs[CLASSIFIER_INPUTS];
+    uint8_t activity;
+} train_row_t;
+
+static train_row_t *rows;
+static uint32_t *sorted;            // scratch of split_find()
+static classifier_node_t tree[TRAIN_NODES_MAX];
+static uint8_t tree_len = 0;
+static uint8_t tree_depth = 0;
+static uint8_t sort_input;
+
+static int row_compare(const void *a, const void *b) {
+    int32_t va = rows[*(uint32_t const *)a].inputs[sort_input];
+    int32_t vb = rows[*(uint32_t const *)b].inputs[sort_input];
+    return (va > vb) - (va < vb);
+}
+
+// n times the Gini impurity of n windows with counts[] per activity
+static double gini(uint32_t const *counts, uint32_t n) {
+    double sum_sq = 0.0;
+    for (uint8_t a = 0; a < ACTIVITY_COUNT; a++) sum_sq += (double)counts[a] * counts[a];
+    return n ? n - sum_sq / n : 0.0;
+}
+
+// best split of the n windows at p_idx. false if none lowers the impurity.
+static bool split_find(uint32_t *p_idx, uint32_t n, uint8_t *p_input, int32_t *p_threshold) {
+    uint32_t total[ACTIVITY_COUNT] = { 0 };
+    double best;
+    bool found = false;
+
+    for (uint32_t i = 0; i < n; i++) total[rows[p_idx[i]].activity]++;
+    best = gini(total, n);
+
+    for (uint8_t input = 0; input < CLASSIFIER_INPUTS; input++) {
+        uint32_t left[ACTIVITY_COUNT] = { 0 }, right[ACTIVITY_COUNT];
+        memcpy(sorted, p_idx, n * sizeof(sorted[0]));
+        sort_input = input;
+        qsort(sorted, n, sizeof(sorted[0]), row_compare);
+
+        for (uint32_t i = 0; i + 1 < n; i++) {
+            int32_t v = rows[sorted[i]].inputs[input], v_next = rows[sorted[i + 1]].inputs[input];
+            left[rows[sorted[i]].activity]++;
+            if (v == v_next || i + 1 < TRAIN_LEAF_MIN || n - i - 1 < TRAIN_LEAF_MIN) continue;
+
+            for (uint8_t a = 0; a < ACTIVITY_COUNT; a++) right[a] = total[a] - left[a];
+            double score = gini(left, i + 1) + gini(right, n - i - 1);
+            if (score < best - 1e-9) {
+                best = score;
+                found = true;
+                *p_input = input;
+                *p_threshold = (int32_t)(v + ((int64_t)v_next - v) / 2);
+            }
+        }
+    }
+    return found;
+}
+
+static uint8_t majority(uint32_t const *p_idx, uint32_t n) {
+    uint32_t counts[ACTIVITY_COUNT] = { 0 };
+    uint8_t best = 0;
+    for (uint32_t i = 0; i < n; i++) counts[rows[p_idx[i]].activity]++;
+    for (uint8_t a = 1; a < ACTIVITY_COUNT; a++) {
+        if (counts[a] > counts[best]) best = a;
+    }
+    return best;
+}
+
+// grow the subtree of the n windows at p_idx in preorder from tree_len
+static void node_build(uint32_t *p_idx, uint32_t n, uint8_t depth) {
+    uint8_t node = tree_len++;
+    uint8_t input;
+    int32_t threshold;
+
+    tree_depth = MAX(tree_depth, depth);
+    if (depth == TRAIN_DEPTH_MAX || n < 2 * TRAIN_LEAF_MIN || !split_find(p_idx, n, &input, &threshold)) {
+        tree[node] = (classifier_node_t){ CLASSIFIER_LEAF, 0, majority(p_idx, n) };
+        return;
+    }
+
+    uint32_t n_left = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (rows[p_idx[i]].inputs[input] <= threshold) {
+            uint32_t t = p_idx[n_left];
+            p_idx[n_left++] = p_idx[i];
+            p_idx[i] = t;
+        }
+    }
+
+    tree[node] = (classifier_node_t){ input, 0, threshold };
+    node_build(p_idx, n_left, depth + 1);
+    tree[node].right = tree_len;
+    node_build(&p_idx[n_left], n - n_left, depth + 1);
+
+    classifier_node_t const *p_left = &tree[node + 1], *p_right = &tree[tree[node].right];
+    if (p_left->input == CLASSIFIER_LEAF && p_right->input == CLASSIFIER_LEAF && p_left->threshold == p_right->threshold) {
+        tree[node] = *p_left;
+        tree_len = node + 1;
+    }
+}
+
+static uint8_t tree_predict(int32_t const *p_inputs) {
+    uint8_t i = 0;
+    while (tree[i].input != CLASSIFIER_LEAF) i = (p_inputs[tree[i].input] <= tree[i].threshold) ? i + 1 : tree[i].right;
+    return (uint8_t)tree[i].threshold;
+}
+
+static double tree_accuracy(sim_dataset_t const *p_set) {
+    uint32_t correct = 0;
+    for (uint32_t i = 0; i < p_set->n_windows; i++) {
+        sim_window_t const *p_window = &p_set->p_windows[i];
+        int32_t inputs[CLASSIFIER_INPUTS];
+        classifier_inputs(&p_window->features, p_window->odr_ticks, inputs);
+        correct += tree_predict(inputs) == p_window->activity;
+    }
+    return p_set->n_windows ? 100.0 * correct / p_set->n_windows : 0.0;
+}
+
+// export ---------------------------------------------------------------------
+
+static bool tree_write(const char *path, sim_dataset_t const *p_train, sim_dataset_t const *p_test, double accuracy) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    const char *source = sim_config.data_path ? strrchr(sim_config.data_path, '/') : NULL;
+    source = source ? source + 1 : sim_config.data_path ? sim_config.data_path : "the BMA400 motion model";
+    fprintf(f, "/**\n"
+               " * activity classifier model -- generated by keh_sim --train, do not edit\n"
+               " *\n"
+               " * %s: %" PRIu32 " training windows, %" PRIu32 " held out\n"
+               " * depth %u, %u nodes, held-out accuracy %.1f%%\n"
+               " */\n\n"
+               "#include \"app_classifier.h\"\n\n"
+               "const classifier_node_t classifier_model[] = {\n",
+            source, p_train->n_windows, p_test->n_windows, tree_depth, tree_len, accuracy);
+    for (uint8_t i = 0; i < tree_len; i++) {
+        if (tree[i].input == CLASSIFIER_LEAF) {
+            fprintf(f, "    /* %3u */ { CLASSIFIER_LEAF, 0, %s },\n", i, activity_macros[tree[i].threshold]);
+        } else {
+            fprintf(f, "    /* %3u */ { %s, %u, %" PRId32 " },\n", i, input_names[tree[i].input], tree[i].right,
+                    tree[i].threshold);
+        }
+    }
+    fprintf(f, "};\n\n"
+               "const uint8_t classifier_model_len = sizeof(classifier_model) / sizeof(classifier_model[0]);\n");
+    return fclose(f) == 0;
+}
+
+int sim_train_run(void) {
+    sim_dataset_t train, test;
+    if (!sim_dataset_build(&train, &test)) return EXIT_FAILURE;
+
+    rows = malloc(train.n_windows * sizeof(rows[0]));
+    uint32_t *p_idx = malloc(train.n_windows * sizeof(p_idx[0]));
+    sorted = malloc(train.n_windows * sizeof(sorted[0]));
+    if (!rows || !p_idx || !sorted) abort();
+    for (uint32_t i = 0; i < train.n_windows; i++) {
+        sim_window_t const *p_window = &train.p_windows[i];
+        classifier_inputs(&p_window->features, p_window->odr_ticks, rows[i].inputs);
+        rows[i].activity = p_window->activity;
+        p_idx[i] = i;
+    }
+
+    node_build(p_idx, train.n_windows, 0);
+    double train_accuracy = tree_accuracy(&train);
+    double test_accuracy = tree_accuracy(&test);
+
+    printf("train_windows           %" PRIu32 "\n", train.n_windows);
+    printf("test_windows            %" PRIu32 "\n", test.n_windows);
+    printf("tree_depth              %u\n", tree_depth);
+    printf("tree_nodes              %u\n", tree_len);
+    printf("train_accuracy          %.1f%%\n", train_accuracy);
+    printf("test_accuracy           %.1f%%\n", test_accuracy);
+
+    bool ok = tree_write(sim_config.train_path, &train, &test, test_accuracy);
+    free(sorted);
+    free(p_idx);
+    free(rows);
+    sim_dataset_free(&train);
+    sim_dataset_free(&test);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -9,6 +9,7 @@
 #include "app_spi.h"
 #include "app_callbacks.h"
 #include "nrfx_gpiote.h"
+#include "nrf_pwr_mgmt.h"
 
 
 BMA400_INTF_RET_TYPE bma400_spi_write(
@@ -26,18 +27,64 @@ void bma400_delay_us(
         void *intf_ptr);
 
 
-#define N_FRAMES    (ACCELEROMETER_N_SAMPLES * 6)
-#define FIFO_SIZE   ((N_FRAMES) + (BMA400_FIFO_BYTES_OVERREAD))
+// the watermark counts FIFO bytes, and every frame carries a header byte
+#define FIFO_FRAME(format)  (((format) == ACCELEROMETER_FORMAT_8_BIT) \
+                            ? BMA400_FIFO_XYZ_8_BIT_LEN : BMA400_FIFO_XYZ_12_BIT_LEN)
+#define FIFO_WATERMARK(n_samples, format) ((n_samples) * FIFO_FRAME(format))
+// whole frames per DMA transfer (incl. address, dummy byte) -- a partially
+// read frame is sent again on the next read
+#define FIFO_CHUNK(format)  ((APP_SPI_MAX_DMA_LEN - 2) / FIFO_FRAME(format) * FIFO_FRAME(format))
+// the first transfer of a fetch also carries the sensor time and FIFO length
+#define FIFO_CHUNK_FIRST(format) ((APP_SPI_MAX_DMA_LEN - ACCELEROMETER_FETCH_HEADROOM) \
+                                  / FIFO_FRAME(format) * FIFO_FRAME(format))
 
-struct bma400_sensor_data accel_data[ACCELEROMETER_N_SAMPLES] = { { 0 } };
+#define REG_SENSOR_TIME_0   (BMA400_REG_ACCEL_DATA + 6)
 
 struct bma400_int_enable int_en;
-struct bma400_fifo_data fifo_frame;
 struct bma400_device_conf fifo_conf;
 struct bma400_sensor_conf conf;
 
-uint8_t fifo_buff[FIFO_SIZE] = { 0 };
-uint16_t accel_frames_req = N_FRAMES;
+// sampling rate requested by the scheduler and format requested by the
+// central, applied on the next wake. fifo_format is the format of the data
+// currently in the FIFO.
+static uint8_t accel_odr = BMA400_ODR_25HZ;
+static uint16_t accel_burst_samples = ACCELEROMETER_N_SAMPLES;
+static accelerometer_format_t accel_format = ACCELEROMETER_FORMAT_12_BIT;
+static accelerometer_format_t fifo_format = ACCELEROMETER_FORMAT_12_BIT;
+static bool accel_conf_changed = false;
+
+// shadow copies of the configuration registers, ACC_CONFIG0 up to TAP_CONFIG1
+#define SHADOW_FIRST        BMA400_REG_ACCEL_CONFIG_0
+#define SHADOW_LAST         (BMA400_REG_TAP_CONFIG + 1)
+#define SHADOW_LEN          (SHADOW_LAST - SHADOW_FIRST + 1)
+
+static uint8_t shadow[SHADOW_LEN];
+static uint8_t shadow_valid[CEIL_DIV(SHADOW_LEN, 8)];
+
+// register/value pairs of the open write batch
+#define WRITE_BATCH_MAX     16
+
+static uint8_t write_batch[2 * WRITE_BATCH_MAX];
+static uint8_t write_batch_len = 0;
+static bool write_batch_open = false;
+
+// FIFO fetch in flight, see accelerometer_fetch_data()
+static struct {
+    uint8_t *data_ptr;
+    uint16_t max_len;
+    uint16_t n_bytes;           // FIFO bytes to read
+    uint16_t pos;               // FIFO bytes read
+    uint8_t saved[ACCELEROMETER_FETCH_HEADROOM];
+    uint8_t regs[2];            // dummy byte + register value
+    bool deinit_spi;
+    bool sleep;
+    callback_t fetch_done;
+    volatile bool active;
+    volatile bool xfers_done;
+    uint16_t payload_len;
+    uint32_t time;              // sensor time of the first sample read
+    uint8_t odr;                // BMA400_ODR_* the samples were taken at
+} fetch;
 
 static uint8_t              dev_addr    = IMU_CS;
 struct bma400_dev           bma         = {
@@ -49,6 +96,61 @@ struct bma400_dev           bma         = {
         .read_write_len = APP_SPI_MAX_TRANSFER_LEN - 1
 };
 
+// shadow registers -- the configuration registers only change when written,
+// so once read or written they are served from RAM. a soft reset puts the
+// sensor back to its defaults and empties the shadow.
+
+static bool shadow_get(uint8_t reg, uint8_t *data, uint32_t len) {
+    if (reg < SHADOW_FIRST || reg + len - 1 > SHADOW_LAST) return false;
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t idx = reg - SHADOW_FIRST + i;
+        if (!(shadow_valid[idx / 8] & (1 << (idx % 8)))) return false;
+    }
+    memcpy(data, &shadow[reg - SHADOW_FIRST], len);
+    return true;
+}
+
+static void shadow_put(uint8_t reg, uint8_t const *data, uint32_t len) {
+    for (uint16_t addr = reg; addr < reg + len; addr++) {
+        if (addr < SHADOW_FIRST || addr > SHADOW_LAST) continue;
+        uint8_t idx = addr - SHADOW_FIRST;
+        shadow[idx] = data[addr - reg];
+        shadow_valid[idx / 8] |= 1 << (idx % 8);
+    }
+}
+
+// one burst read of ACC_CONFIG0..FIFO_CONFIG2, the registers the driver
+// reads back while configuring. the interrupt and tap registers above are
+// only read once each, so preloading them costs more than it saves.
+static void shadow_load(void) {
+    uint8_t regs[BMA400_REG_FIFO_CONFIG_0 + 2 - SHADOW_FIRST + 1];
+    bma400_get_regs(SHADOW_FIRST, regs, sizeof(regs), &bma);
+}
+
+// batched register writes -- while a batch is open, register writes are
+// queued (and the shadow updated) instead of sent. the queue goes out back to
+// back through app_spi_write_regs(), one chip select frame per register as
+// the BMA400 takes no burst writes, with a single wait for the whole batch.
+// a read that misses the shadow, a command or a full queue send it early.
+
+static void write_batch_begin(void) {
+    write_batch_open = true;
+}
+
+static int8_t write_batch_issue(void) {
+    if (write_batch_len == 0) return BMA400_INTF_RET_SUCCESS;
+
+    int8_t rslt = (int8_t)app_spi_write_regs(write_batch, write_batch_len, NULL);
+    write_batch_len = 0;
+    return rslt;
+}
+
+static int8_t write_batch_flush(void) {
+    int8_t rslt = write_batch_issue();
+    write_batch_open = false;
+    return rslt;
+}
+
 // int1 interrupt
 
 nrfx_gpiote_in_config_t int1_config = NRFX_GPIOTE_CONFIG_IN_SENSE_LOTOHI(true);
@@ -59,19 +161,11 @@ static void int1_handler(nrfx_gpiote_pin_t pin, nrf_gpiote_polarity_t action) {
     CALLBACK_FUNC(ACCELEROMETER_DATA_READY)();
 }
 
-int accelerometer_init(void) {
-
-    app_spi_init();
+// sensor, FIFO and interrupt configuration, with the register writes batched
+static int8_t accelerometer_configure(void) {
 
     int8_t rslt;
 
-    // check for device existence
-    if (bma400_init(&bma) != BMA400_OK) {
-        debug_log("bma400 not found!");
-        debug_flush();
-        return -1;
-    }
-
     /* Select the type of configuration to be modified */
     conf.type = BMA400_ACCEL;
 
@@ -81,7 +175,7 @@ int accelerometer_init(void) {
 
     /* Modify the desired configurations as per macros
      * available in bma400_defs.h file */
-    conf.param.accel.odr = BMA400_ODR_25HZ;
+    conf.param.accel.odr = accel_odr;
     conf.param.accel.range = BMA400_RANGE_4G;
     conf.param.accel.data_src = BMA400_DATA_SRC_ACCEL_FILT_1;
 
@@ -99,7 +193,7 @@ int accelerometer_init(void) {
                                         | BMA400_FIFO_Z_EN
                                         | BMA400_FIFO_AUTO_FLUSH;   // flush on power mode change
     fifo_conf.param.fifo_conf.conf_status = BMA400_ENABLE;
-    fifo_conf.param.fifo_conf.fifo_watermark = N_FRAMES;
+    fifo_conf.param.fifo_conf.fifo_watermark = FIFO_WATERMARK(accel_burst_samples, fifo_format);
     fifo_conf.param.fifo_conf.fifo_wm_channel = BMA400_INT_CHANNEL_1;
 
     rslt = bma400_set_device_conf(&fifo_conf, 1, &bma);
@@ -108,26 +202,116 @@ int accelerometer_init(void) {
     rslt = bma400_set_power_mode(BMA400_MODE_NORMAL, &bma);
     if (rslt != BMA400_OK) return rslt;
 
-    fifo_frame.data = fifo_buff;
-    fifo_frame.length = FIFO_SIZE;
-
     int_en.type = BMA400_FIFO_WM_INT_EN;
     int_en.conf = BMA400_ENABLE;
 
     rslt = bma400_enable_interrupt(&int_en, 1, &bma);
     if (rslt != BMA400_OK) return rslt;
 
+    return BMA400_OK;
+}
+
+int accelerometer_init(void) {
+
+    app_spi_session_begin();
+
+    // check for device existence
+    if (bma400_init(&bma) != BMA400_OK) {
+        debug_log("bma400 not found!");
+        debug_flush();
+        app_spi_session_end();
+        return -1;
+    }
+
+    // fill the shadow registers in one burst read, then configure from them
+    shadow_load();
+    write_batch_begin();
+    int8_t rslt = accelerometer_configure();
+    if (write_batch_flush() != BMA400_OK) rslt = BMA400_E_COM_FAIL;
+    if (rslt != BMA400_OK) {
+        app_spi_session_end();
+        return rslt;
+    }
+
     // init done; sleep the accelerometer + deinit spi
     accelerometer_sleep(false, true);
 
     return 0;
 }
 
+void accelerometer_set_rate(uint8_t odr, uint16_t burst_samples) {
+    burst_samples = MIN(MAX(burst_samples, 1), ACCELEROMETER_MAX_SAMPLES);
+    if (odr == accel_odr && burst_samples == accel_burst_samples) return;
+
+    accel_odr = odr;
+    accel_burst_samples = burst_samples;
+    accel_conf_changed = true;
+}
+
+void accelerometer_set_format(accelerometer_format_t format) {
+    if (format == accel_format) return;
+
+    accel_format = format;
+    accel_conf_changed = true;
+}
+
+accelerometer_format_t accelerometer_get_format(void) {
+    return fifo_format;
+}
+
+// payload bytes per sample
+uint8_t accelerometer_sample_size(accelerometer_format_t format) {
+    return (format == ACCELEROMETER_FORMAT_8_BIT) ? 3 : 6;
+}
+
+// samples a full FIFO holds
+uint16_t accelerometer_max_samples(accelerometer_format_t format) {
+    return ACCELEROMETER_FIFO_BYTES / FIFO_FRAME(format);
+}
+
+static void accelerometer_apply_conf(void) {
+    if (!accel_conf_changed) return;
+
+    conf.param.accel.odr = accel_odr;
+    bma400_set_sensor_conf(&conf, 1, &bma);
+
+    fifo_format = accel_format;
+    if (fifo_format == ACCELEROMETER_FORMAT_8_BIT) {
+        fifo_conf.param.fifo_conf.conf_regs |= BMA400_FIFO_8_BIT_EN;
+    } else {
+        fifo_conf.param.fifo_conf.conf_regs &= ~BMA400_FIFO_8_BIT_EN;
+    }
+    fifo_conf.param.fifo_conf.fifo_watermark =
+        FIFO_WATERMARK(MIN(accel_burst_samples, accelerometer_max_samples(fifo_format)), fifo_format);
+    bma400_set_device_conf(&fifo_conf, 1, &bma);
+    accel_conf_changed = false;
+}
+
+// SPI session held from wake until the accelerometer sleeps again, so a
+// wake-fetch-sleep cycle brings the SPIM up once, whatever the callers ask for
+static bool burst_session = false;
+
+static void burst_session_begin(void) {
+    if (burst_session) return;
+    burst_session = true;
+    app_spi_session_begin();
+}
+
+static void burst_session_end(void) {
+    if (!burst_session) return;
+    burst_session = false;
+    app_spi_session_end();
+}
+
 void accelerometer_wake(bool init_spi, bool deinit_spi) {
     
-    if (init_spi) app_spi_init();
+    if (init_spi) app_spi_session_begin();
+    burst_session_begin();
+    write_batch_begin();
+    accelerometer_apply_conf();
     bma400_set_power_mode(BMA400_MODE_NORMAL, &bma);
-    if (deinit_spi) app_spi_deinit();
+    write_batch_flush();
+    if (deinit_spi) app_spi_session_end();
 
     // set up GPIO interrupts
     nrfx_gpiote_in_init(IMU_INT1, &int1_config, int1_handler);
@@ -136,36 +320,280 @@ void accelerometer_wake(bool init_spi, bool deinit_spi) {
 
 void accelerometer_sleep(bool init_spi, bool deinit_spi) {
 
-    if (init_spi) app_spi_init();
+    // let a fetch in flight finish its transfers first
+    while (fetch.active && !fetch.xfers_done) {
+        nrf_pwr_mgmt_run();
+    }
+
+    if (init_spi) app_spi_session_begin();
     bma400_set_power_mode(BMA400_MODE_SLEEP, &bma);
-    if (deinit_spi) app_spi_deinit();
+    burst_session_end();
+    if (deinit_spi) app_spi_session_end();
 
     // disable GPIO interrupts
     nrfx_gpiote_in_event_disable(IMU_INT1);
     nrfx_gpiote_in_uninit(IMU_INT1);
 }
 
-uint16_t accelerometer_fetch_data(bool init_spi, bool deinit_spi, bool sleep) {
+// FIFO fetch -----------------------------------------------------------------
+// the register sequence of a fetch is chained from the SPIM event handler, so
+// the CPU sleeps between transfers and the scheduler keeps running:
+//  1. sensor time, FIFO length and the first FIFO data in one burst from
+//     SENSOR_TIME0: the address runs on through the status registers (the
+//     interrupts are not latched, reading them has no effect) and
+//     FIFO_LENGTH to FIFO_DATA, where it stops. at the watermark interrupt the
+//     FIFO holds at least the watermark, so that much is read right away
+//  2. the rest of the FIFO (at most max_len) in DMA sized chunks. a single
+//     EasyDMA transfer covers the whole FIFO, so this is only what arrived
+//     after the watermark
+//  3. ACC_CONFIG0 write putting the accelerometer to sleep, from its shadow
+// steps 1 and 2 run at APP_SPI_FREQ_FIFO, the rest at APP_SPI_FREQ_REG.
+// the FIFO data is DMA'd straight to its place in data_ptr. each transfer also
+// clocks in the register and dummy (and length) bytes, which land in the bytes
+// in front of the chunk; those are saved and put back. the rest (SPI deinit,
+// interrupt pin, packing) runs in main context.
+
+static void fetch_length_read(void);
+static void fetch_chunk_done(void);
+static void fetch_sleep_read(void);
+static void fetch_sleep_written(void);
+static void fetch_xfers_end(void);
+
+static void fetch_headroom_save(uint8_t const *p_rx) {
+    memcpy(fetch.saved, p_rx, ACCELEROMETER_FETCH_HEADROOM);
+}
+
+static void fetch_headroom_restore(uint8_t *p_rx) {
+    memcpy(p_rx, fetch.saved, ACCELEROMETER_FETCH_HEADROOM);
+}
+
+static void fetch_sleep(void) {
+    uint8_t reg_data;
+
+    if (!shadow_get(BMA400_REG_ACCEL_CONFIG_0, &reg_data, 1)) {
+        if (app_spi_readwrite_reg(BMA400_REG_ACCEL_CONFIG_0 | BMA400_SPI_RD_MASK,
+                                  NULL, fetch.regs, 2, fetch_sleep_read)) {
+            fetch_xfers_end();
+        }
+        return;
+    }
+
+    reg_data = BMA400_SET_BITS_POS_0(reg_data, BMA400_POWER_MODE, BMA400_MODE_SLEEP);
+    fetch.regs[1] = reg_data;
+    if (app_spi_readwrite_reg(BMA400_REG_ACCEL_CONFIG_0, &reg_data, NULL, 1, fetch_sleep_written)) {
+        fetch_xfers_end();
+    }
+}
+
+// start the next chunk, or step on to the sleep sequence
+static void fetch_chunk_start(void) {
+    if (fetch.pos >= fetch.n_bytes) {
+        app_spi_set_frequency(APP_SPI_FREQ_REG);
+        if (fetch.sleep) {
+            fetch_sleep();
+        }
+        else {
+            fetch_xfers_end();
+        }
+        return;
+    }
+
+    uint16_t chunk = MIN(FIFO_CHUNK(fifo_format), fetch.n_bytes - fetch.pos);
+    uint8_t *p_rx = &fetch.data_ptr[fetch.pos - ACCELEROMETER_FETCH_HEADROOM];
+    fetch_headroom_save(p_rx);
+    if (app_spi_read_reg_direct(BMA400_REG_FIFO_DATA | BMA400_SPI_RD_MASK, &p_rx[ACCELEROMETER_FETCH_HEADROOM - 2],
+                                chunk + 1, fetch_chunk_done)) {
+        fetch_headroom_restore(p_rx);
+        fetch.n_bytes = fetch.pos;
+        fetch_chunk_start();
+    }
+}
+
+static void fetch_chunk_done(void) {
+    fetch_headroom_restore(&fetch.data_ptr[fetch.pos - ACCELEROMETER_FETCH_HEADROOM]);
+    fetch.pos += MIN(FIFO_CHUNK(fifo_format), fetch.n_bytes - fetch.pos);
+    fetch_chunk_start();
+}
+
+// sensor time, length + first data
+static void fetch_first_start(void) {
+    uint16_t frame = FIFO_FRAME(fifo_format);
+    uint16_t first = MIN(fifo_conf.param.fifo_conf.fifo_watermark / frame * frame, FIFO_CHUNK_FIRST(fifo_format));
+    uint8_t *p_rx = &fetch.data_ptr[-ACCELEROMETER_FETCH_HEADROOM];
+
+    fetch.n_bytes = MIN(first, fetch.max_len / frame * frame);
+    app_spi_set_frequency(APP_SPI_FREQ_FIFO);
+    fetch_headroom_save(p_rx);
+    if (app_spi_read_reg_direct(REG_SENSOR_TIME_0 | BMA400_SPI_RD_MASK, p_rx,
+                                fetch.n_bytes + ACCELEROMETER_FETCH_HEADROOM - 1, fetch_length_read)) {
+        fetch_headroom_restore(p_rx);
+        app_spi_set_frequency(APP_SPI_FREQ_REG);
+        fetch_xfers_end();
+    }
+}
+
+static void fetch_length_read(void) {
+    uint8_t *p_rx = &fetch.data_ptr[-ACCELEROMETER_FETCH_HEADROOM];
+    uint32_t now = ((uint32_t)p_rx[4] << 16) | ((uint32_t)p_rx[3] << 8) | p_rx[2];
+    uint16_t n_bytes = ((uint16_t)(p_rx[11] & BMA400_FIFO_BYTES_CNT_MSK) << 8) | p_rx[10];
+
+    fetch_headroom_restore(p_rx);
+    fetch.pos = fetch.n_bytes;
+
+    // sensor time and length are read together, so the newest sample in the
+    // FIFO is the last one on the sensor time grid. the fetch starts at the
+    // oldest.
+    uint16_t ticks = accelerometer_odr_ticks(fetch.odr);
+    uint16_t n_frames = MIN(n_bytes, ACCELEROMETER_FIFO_BYTES) / FIFO_FRAME(fifo_format);
+    fetch.time = (now / ticks * ticks - (uint32_t)(MAX(n_frames, 1) - 1) * ticks) & ACCELEROMETER_TICK_MASK;
+
+    // the length was latched before the first data was clocked out
+    n_bytes = MIN(n_bytes, ACCELEROMETER_FIFO_BYTES);
+    n_bytes = MIN(n_bytes, fetch.max_len / FIFO_FRAME(fifo_format) * FIFO_FRAME(fifo_format));
+    fetch.n_bytes = MAX(n_bytes, fetch.pos);
+    fetch_chunk_start();
+}
+
+static void fetch_sleep_read(void) {
+    shadow_put(BMA400_REG_ACCEL_CONFIG_0, &fetch.regs[1], 1);
+    fetch_sleep();
+}
+
+static void fetch_sleep_written(void) {
+    shadow_put(BMA400_REG_ACCEL_CONFIG_0, &fetch.regs[1], 1);
+    fetch_xfers_end();
+}
+
+// main context part of a fetch. returns the payload length in bytes.
+static uint16_t fetch_finish(void) {
+    if (fetch.sleep) {
+        burst_session_end();
+        nrfx_gpiote_in_event_disable(IMU_INT1);
+        nrfx_gpiote_in_uninit(IMU_INT1);
+    }
+
+    if (fetch.deinit_spi) app_spi_session_end();
+
+    fetch.payload_len = accelerometer_pack_fifo(fetch.data_ptr, fetch.pos, fifo_format);
+    fetch.active = false;
+    return fetch.payload_len;
+}
 
-    if (init_spi) app_spi_init();
-    bma400_get_fifo_data(&fifo_frame, &bma);
-    if (sleep) accelerometer_sleep(false, deinit_spi);
+static void fetch_finish_sched(void *p_event_data, uint16_t event_size) {
+    fetch_finish();
+    fetch.fetch_done();
+}
 
-    accel_frames_req = N_FRAMES;
-    bma400_extract_accel(&fifo_frame, accel_data, &accel_frames_req, &bma);
-    return 6 * accel_frames_req;
+// last transfer of the chain is done (interrupt context)
+static void fetch_xfers_end(void) {
+    fetch.xfers_done = true;
+    if (fetch.fetch_done) app_sched_event_put(NULL, 0, fetch_finish_sched);
 }
 
-void accelerometer_copy_data(uint8_t *data_ptr, uint16_t data_len) {
-    for (uint16_t i = 0; i < MIN(data_len / 6, ACCELEROMETER_N_SAMPLES); i++) {
-        memcpy(&data_ptr[6 * i],     &(accel_data[i].x), sizeof(accel_data[i].x));
-        memcpy(&data_ptr[6 * i + 2], &(accel_data[i].y), sizeof(accel_data[i].y));
-        memcpy(&data_ptr[6 * i + 4], &(accel_data[i].z), sizeof(accel_data[i].z));
+// read the FIFO into data_ptr and pack it there into payload samples.
+// fetch_done is called from main context once the payload is ready, see
+// accelerometer_fetch_len(); pass null to fetch_done to block, the payload
+// length in bytes is then returned.
+uint16_t accelerometer_fetch_data(uint8_t *data_ptr, uint16_t max_len, bool init_spi, bool deinit_spi, bool sleep,
+                                  callback_t fetch_done) {
+
+    if (init_spi) app_spi_session_begin();
+    fetch.data_ptr = data_ptr;
+    fetch.max_len = max_len;
+    fetch.n_bytes = fetch.pos = fetch.payload_len = 0;
+    fetch.deinit_spi = deinit_spi;
+    fetch.sleep = sleep;
+    fetch.fetch_done = fetch_done;
+    fetch.xfers_done = false;
+    fetch.active = true;
+    fetch.odr = conf.param.accel.odr;
+
+    fetch_first_start();
+
+    if (fetch_done) return 0;  // callback supplied; return to caller
+
+    // no callback, block
+    while (!fetch.xfers_done) {
+        nrf_pwr_mgmt_run();
     }
+
+    return fetch_finish();
 }
 
+// payload length of the last fetch in bytes
+uint16_t accelerometer_fetch_len(void) {
+    return fetch.payload_len;
+}
 
+// sensor time of the first sample of the last fetch, the rest follow every
+// accelerometer_odr_ticks(accelerometer_fetch_odr()) ticks
+uint32_t accelerometer_fetch_time(void) {
+    return fetch.time;
+}
 
+uint8_t accelerometer_fetch_odr(void) {
+    return fetch.odr;
+}
+
+// sample period in sensor time ticks: 2048 at 12.5 Hz, halved per ODR step
+uint16_t accelerometer_odr_ticks(uint8_t odr) {
+    return 2048 >> (MAX(odr, BMA400_ODR_12_5HZ) - BMA400_ODR_12_5HZ);
+}
+
+// frames the packer steps over; 0 for an empty frame, which ends the data
+static inline uint8_t fifo_skip_len(uint8_t header) {
+    if (header == BMA400_FIFO_CONTROL_FRAME) return 2;
+    if (header == BMA400_FIFO_SENSOR_TIME) return 4;
+    return 0;
+}
+
+// turn raw FIFO frames into payload samples in place: int16 little-endian
+// x/y/z for 12 bit frames, the int8 MSBs for 8 bit frames. a sample never
+// outgrows its frame, so the output never overtakes the input. control and
+// sensor time frames are skipped, an empty frame ends the data.
+uint16_t accelerometer_pack_fifo(uint8_t *data_ptr, uint16_t fifo_len, accelerometer_format_t format) {
+    uint8_t const *frame = data_ptr;
+    uint8_t const *end = data_ptr + fifo_len;
+    uint8_t *out = data_ptr;
+
+    if (format == ACCELEROMETER_FORMAT_8_BIT) {
+        while (end - frame >= BMA400_FIFO_XYZ_8_BIT_LEN) {
+            if (frame[0] != BMA400_FIFO_XYZ_8_BIT_FRAME) {
+                if (fifo_skip_len(frame[0]) == 0) break;
+                frame += fifo_skip_len(frame[0]);
+                continue;
+            }
+            out[0] = frame[1];
+            out[1] = frame[2];
+            out[2] = frame[3];
+            out += 3;
+            frame += BMA400_FIFO_XYZ_8_BIT_LEN;
+        }
+        return (uint16_t)(out - data_ptr);
+    }
+
+    while (end - frame >= BMA400_FIFO_XYZ_12_BIT_LEN) {
+        if (frame[0] != BMA400_FIFO_XYZ_12_BIT_FRAME) {
+            if (fifo_skip_len(frame[0]) == 0) break;
+            frame += fifo_skip_len(frame[0]);
+            continue;
+        }
+        // header, x lsb, x msb, y lsb, ... -- the lsb holds the low nibble.
+        // read the whole frame before the sample overwrites its first byte
+        int16_t x = (int16_t)(((((uint16_t)frame[2] << 4) | (frame[1] & 0x0F)) ^ 0x800) - 0x800);
+        int16_t y = (int16_t)(((((uint16_t)frame[4] << 4) | (frame[3] & 0x0F)) ^ 0x800) - 0x800);
+        int16_t z = (int16_t)(((((uint16_t)frame[6] << 4) | (frame[5] & 0x0F)) ^ 0x800) - 0x800);
+        out[0] = (uint8_t)x;
+        out[1] = (uint8_t)((uint16_t)x >> 8);
+        out[2] = (uint8_t)y;
+        out[3] = (uint8_t)((uint16_t)y >> 8);
+        out[4] = (uint8_t)z;
+        out[5] = (uint8_t)((uint16_t)z >> 8);
+        out += 6;
+        frame += BMA400_FIFO_XYZ_12_BIT_LEN;
+    }
+    return (uint16_t)(out - data_ptr);
+}
 
 // interface function implmementations
 
@@ -175,16 +603,44 @@ BMA400_INTF_RET_TYPE bma400_spi_write(
         uint32_t len, 
         void *intf_ptr) {
 
-    return (int8_t)app_spi_readwrite_reg(reg_addr, (uint8_t *)reg_data, NULL, len, NULL);
+    int8_t rslt = BMA400_INTF_RET_SUCCESS;
+    if (write_batch_open && reg_addr != BMA400_REG_COMMAND) {
+        for (uint32_t i = 0; i < len && rslt == BMA400_INTF_RET_SUCCESS; i++) {
+            if (write_batch_len == WRITE_BATCH_MAX) rslt = write_batch_issue();
+            write_batch[2 * write_batch_len] = reg_addr + i;
+            write_batch[2 * write_batch_len + 1] = reg_data[i];
+            write_batch_len++;
+        }
+    }
+    else {
+        if (write_batch_open) rslt = write_batch_issue();   // commands take effect right away
+        if (rslt == BMA400_INTF_RET_SUCCESS) {
+            rslt = (int8_t)app_spi_readwrite_reg(reg_addr, (uint8_t *)reg_data, NULL, len, NULL);
+        }
+    }
+
+    if (rslt == BMA400_INTF_RET_SUCCESS) shadow_put(reg_addr, reg_data, len);
+    if (reg_addr == BMA400_REG_COMMAND && reg_data[0] == BMA400_SOFT_RESET_CMD) {
+        memset(shadow_valid, 0, sizeof(shadow_valid));
+    }
+    return rslt;
 }
 
+// reg_data[0] takes the dummy byte
 BMA400_INTF_RET_TYPE bma400_spi_read(
         uint8_t reg_addr, 
         uint8_t *reg_data, 
         uint32_t len, 
         void *intf_ptr) {
-    
-    return (int8_t)app_spi_readwrite_reg(reg_addr, NULL, reg_data, len, NULL);
+
+    uint8_t reg = reg_addr & ~BMA400_SPI_RD_MASK;
+    if (len > 1 && shadow_get(reg, &reg_data[1], len - 1)) return BMA400_INTF_RET_SUCCESS;
+
+    // queued writes go out first
+    int8_t rslt = write_batch_issue();
+    if (rslt == BMA400_INTF_RET_SUCCESS) rslt = (int8_t)app_spi_readwrite_reg(reg_addr, NULL, reg_data, len, NULL);
+    if (rslt == BMA400_INTF_RET_SUCCESS && len > 1) shadow_put(reg, &reg_data[1], len - 1);
+    return rslt;
 }
 
 void bma400_delay_us(uint32_t period, void *intf_ptr) {
@@ -234,7 +234,7 @@ static int gap_params_init(void) {
 }
 
 
-WEAK_CALLBACK_DEF(BLE_NUS_EVT_RX_DATA)
+WEAK_CALLBACK_DATA_DEF(BLE_NUS_EVT_RX_DATA)
 WEAK_CALLBACK_DEF(BLE_NUS_EVT_TX_RDY)
 WEAK_CALLBACK_DEF(BLE_NUS_EVT_COMM_STARTED)
 WEAK_CALLBACK_DEF(BLE_NUS_EVT_COMM_STOPPED)
@@ -250,7 +250,8 @@ WEAK_CALLBACK_DEF(BLE_NUS_EVT_COMM_STOPPED)
 static void nus_data_handler(ble_nus_evt_t *p_evt) {
     switch (p_evt->type) {
     case BLE_NUS_EVT_RX_DATA:
-        CALLBACK_FUNC(BLE_NUS_EVT_RX_DATA)();
+        CALLBACK_FUNC(BLE_NUS_EVT_RX_DATA)(p_evt->params.rx_data.p_data,
+                                           MIN(p_evt->params.rx_data.length, BLE_RX_DATA_MAX_LEN));
         break;
     case BLE_NUS_EVT_TX_RDY:
         CALLBACK_FUNC(BLE_NUS_EVT_TX_RDY)();
@@ -479,6 +480,14 @@ static int ble_stack_init(void) {
     err_code = nrf_sdh_ble_default_cfg_set(APP_BLE_CONN_CFG_TAG, &ram_start);
     if (err_code != NRF_SUCCESS) return 1;
 
+    // queue several notifications so a burst leaves in one connection event
+    ble_cfg_t ble_cfg;
+    memset(&ble_cfg, 0, sizeof(ble_cfg));
+    ble_cfg.conn_cfg.conn_cfg_tag = APP_BLE_CONN_CFG_TAG;
+    ble_cfg.conn_cfg.params.gatts_conn_cfg.hvn_tx_queue_size = BLE_HVN_TX_QUEUE_SIZE;
+    err_code = sd_ble_cfg_set(BLE_CONN_CFG_GATTS, &ble_cfg, ram_start);
+    if (err_code != NRF_SUCCESS) return 1;
+
     // Enable BLE stack.
     err_code = nrf_sdh_ble_enable(&ram_start);
     if (err_code != NRF_SUCCESS) return 1;
@@ -648,6 +657,13 @@ ret_code_t ble_send(uint8_t *data, uint16_t length) {
     return ble_nus_data_send(&m_nus, data, &length, m_conn_handle);
 }
 
+/**
+ * @brief largest payload of one notification at the current ATT MTU
+ */
+uint16_t ble_get_max_data_len(void) {
+    return m_ble_nus_max_data_len;
+}
+
 /**
  * @brief force a ble disconnection
  */
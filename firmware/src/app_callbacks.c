@@ -4,39 +4,54 @@
 
 #include "app_callbacks.h"
 #include "app_debug.h"
-#include "app_ble_nus.h"
 #include "app_accelerometer.h"
 #include "app_voltage.h"
+#include "app_energy.h"
+#include "app_stream.h"
 #include "nrf_pwr_mgmt.h"
 
-// global buffers for sharing data
-
-uint8_t accelerometer_data_buf[ACCELEROMETER_N_SAMPLES * 6] = { 0 };
-uint16_t accelerometer_num_data = 0;
+void CALLBACK_FUNC(ACCELEROMETER_FETCH_DONE)(void);
 
 // BLE events
 
-static bool send_pend = false;
+// central wrote to the NUS RX characteristic: one or more commands, an
+// opcode and its argument each
+CALLBACK_DATA_DEF_APP_SCHED(BLE_NUS_EVT_RX_DATA, p_data, len) {
+    uint8_t const *cmd = p_data;
+
+    for (uint16_t i = 0; i + 2 <= len; i += 2) {
+        if (cmd[i] == BLE_CMD_SET_FORMAT) stream_set_format(cmd[i + 1]);
+        else if (cmd[i] == BLE_CMD_SET_WINDOW) stream_set_window(cmd[i + 1]);
+    }
+}
+
 static volatile bool accel_pend = false;
 static volatile bool connected = false;
+static volatile bool notifications_en = false;
 
 #if POWER_PROFILING_ENABLED == 0
 #pragma message "power profiling disabled -- running in one shot sampling mode"
 
 
 void app_sched_accelerometer_wake(void *p_event_data, uint16_t event_size) {
-    debug_log("waking accelerometer");
+    energy_plan_t const *p_plan = energy_get_plan();
+    debug_log("waking accelerometer (odr %d, %d samples, ~%d uW)",
+              p_plan->odr, p_plan->burst_samples, energy_get_harvest_uw());
     accel_pend = true;
+    accelerometer_set_rate(p_plan->odr, p_plan->burst_samples);
     accelerometer_wake(true, true);
+    energy_note_burst_start();
 }
 
-// Fresh ADC sample -- check schedule condition to wake accelerometer
-CALLBACK_DEF(NRFX_SAADC_EVT_DONE) {
-    if (!connected) return;
-    int32_t v_store = voltage_read_v_store();
-    
-    // debug_log("v store: %d mv", v_store);
-    if (!accel_pend && v_store > V_STORE_LVL_SAMPLE) {
+// Fresh ADC sample -- update the energy estimate, wake accelerometer if a burst is affordable.
+// scheduled, so the planner state is only touched from main context
+CALLBACK_DEF_APP_SCHED(NRFX_SAADC_EVT_DONE) {
+    energy_update(voltage_read_v_store_uv());
+
+    // connection setup keeps drawing from the capacitor until the central subscribes
+    if (!connected || !notifications_en) return;
+
+    if (!accel_pend && energy_burst_ready()) {
         app_sched_event_put(NULL, 0, app_sched_accelerometer_wake);
     }
 }
@@ -50,29 +65,38 @@ CALLBACK_DEF_APP_SCHED(BLE_GAP_EVT_CONNECTED) {
 // NUS notifications enabled -- send data
 CALLBACK_DEF_APP_SCHED(BLE_NUS_EVT_COMM_STARTED) {
     debug_log("NUS notifications enabled");
-    if (send_pend) {    // notifications enabled after watermark interrupt
-        debug_log("notifications enabled, sending pending data");
-        send_pend = false;
-        ble_send(accelerometer_data_buf, accelerometer_num_data);
+    notifications_en = true;
+    // the first burst does not wait for a sample the plan has spaced out
+    voltage_request_sample(APP_TIMER_TICKS(ENERGY_POLL_MIN_MS), 0);
+    if (stream_send()) {  // notifications enabled after watermark interrupt
+        debug_log("notifications enabled, sent pending data");
     }
 }
 
-// Accelerometer watermark interrupt raised
+// SoftDevice queue has room again -- continue a burst
+CALLBACK_DEF_APP_SCHED(BLE_NUS_EVT_TX_RDY) {
+    stream_send();
+}
+
+// Accelerometer watermark interrupt raised -- start reading the FIFO
 CALLBACK_DEF_APP_SCHED(ACCELEROMETER_DATA_READY) {
-    // fetch accelerometer data -- 1. init spi, 2. fetch data, 3. sleep accel, 4. deinit spi
-    accelerometer_num_data = accelerometer_fetch_data(true, true, true);
-    accelerometer_copy_data(accelerometer_data_buf, accelerometer_num_data);
-    debug_log("ACCELEROMETER_DATA_READY: %d", accelerometer_num_data);
+    stream_fetch_start(CALLBACK_FUNC(ACCELEROMETER_FETCH_DONE));
+}
+
+// burst read and packed (main context) -- send it
+CALLBACK_DEF(ACCELEROMETER_FETCH_DONE) {
+    uint16_t num_samples = stream_fetch_done();
 
     accel_pend = false;
-    send_pend = ble_send(accelerometer_data_buf, accelerometer_num_data) == NRF_SUCCESS;
+    energy_note_burst(num_samples);
+    stream_send();
 }
 
 // NUS disconnected -- reset
 CALLBACK_DEF_APP_SCHED(BLE_GAP_EVT_DISCONNECTED) {
     debug_log("NUS disconnected");
     accelerometer_sleep(true, true);
-    send_pend = connected = false;
+    connected = notifications_en = false;
 
     // kill everything
     nrf_pwr_mgmt_shutdown(NRF_PWR_MGMT_SHUTDOWN_GOTO_SYSOFF);
@@ -88,15 +112,16 @@ CALLBACK_DEF_APP_SCHED(BLE_NUS_EVT_COMM_STARTED)    { debug_log("NUS notificatio
 // NUS disconnected -- reset
 CALLBACK_DEF_APP_SCHED(BLE_GAP_EVT_DISCONNECTED)    { debug_log("NUS disconnected. Resetting."); }
 
-// Accelerometer watermark interrupt raised
-CALLBACK_DEF_APP_SCHED(ACCELEROMETER_DATA_READY) {
-    // fetch accelerometer data -- 1. init spi, 2. fetch data, 3. sleep accel, 4. deinit spi
-    accelerometer_num_data = accelerometer_fetch_data(true, true, true);
-    accelerometer_copy_data(accelerometer_data_buf, accelerometer_num_data);
-    debug_log("ACCELEROMETER_DATA_READY: %d", accelerometer_num_data);
-
-    ble_send(accelerometer_data_buf, accelerometer_num_data);
+// Accelerometer watermark interrupt raised -- start reading the FIFO
+CALLBACK_DEF_APP_SCHED(ACCELEROMETER_DATA_READY)    { stream_fetch_start(CALLBACK_FUNC(ACCELEROMETER_FETCH_DONE)); }
+// burst read and packed (main context) -- send it
+CALLBACK_DEF(ACCELEROMETER_FETCH_DONE) {
+    stream_fetch_done();
+    stream_send();
 }
 
+// SoftDevice queue has room again -- continue a burst
+CALLBACK_DEF_APP_SCHED(BLE_NUS_EVT_TX_RDY)          { stream_send(); }
+
 #endif
 
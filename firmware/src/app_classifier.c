@@ -0,0 +1,51 @@
+/**
+ * on-device activity classifier, see app_classifier.h for the inputs and the
+ * model table
+ */
+
+#include "app_classifier.h"
+
+// per axis inputs. odr_ticks is the sample period in sensor time ticks, the
+// window lasts n * odr_ticks ticks.
+void classifier_inputs(features_t const *p_features, uint16_t odr_ticks, int32_t *p_inputs) {
+    uint32_t window_ticks = (uint32_t)p_features->window * odr_ticks;
+
+    p_inputs[CLASSIFIER_IN_VAR_SUM] = 0;
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        features_axis_t const *p_axis = &p_features->axis[axis];
+        p_inputs[CLASSIFIER_IN_MEAN_X + axis] = p_axis->mean;
+        p_inputs[CLASSIFIER_IN_VAR_X + axis] = (int32_t)p_axis->variance;
+        p_inputs[CLASSIFIER_IN_VAR_SUM] += (int32_t)p_axis->variance;
+        p_inputs[CLASSIFIER_IN_ZC_X + axis] = (int32_t)(p_axis->zero_crossings * (10u * CLASSIFIER_TICK_HZ) / window_ticks);
+        p_inputs[CLASSIFIER_IN_FREQ_X + axis] = (int32_t)(p_axis->dominant_bin * (100u * CLASSIFIER_TICK_HZ) / window_ticks);
+    }
+}
+
+uint8_t classifier_predict(int32_t const *p_inputs) {
+    uint8_t i = 0;
+    while (classifier_model[i].input != CLASSIFIER_LEAF) {
+        i = (p_inputs[classifier_model[i].input] <= classifier_model[i].threshold) ? i + 1 : classifier_model[i].right;
+    }
+    return (uint8_t)classifier_model[i].threshold;
+}
+
+uint8_t classifier_run(features_t const *p_features, uint16_t odr_ticks) {
+    int32_t inputs[CLASSIFIER_INPUTS];
+    classifier_inputs(p_features, odr_ticks, inputs);
+    return classifier_predict(inputs);
+}
+
+// ACTIVITY_LEN bytes to p_buf
+void activity_encode(activity_record_t const *p_record, uint8_t *p_buf) {
+    p_buf[0] = p_record->window;
+    p_buf[1] = p_record->activity;
+    p_buf[2] = p_record->windows;
+}
+
+// parse a received record. false if the firmware cannot have sent it.
+bool activity_decode(uint8_t const *p_buf, activity_record_t *p_record) {
+    p_record->window = p_buf[0];
+    p_record->activity = p_buf[1];
+    p_record->windows = p_buf[2];
+    return features_window_valid(p_record->window) && p_record->activity < ACTIVITY_COUNT && p_record->windows;
+}
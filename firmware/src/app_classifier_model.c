@@ -0,0 +1,22 @@
+/**
+ * activity classifier model -- generated by keh_sim --train, do not edit
+ *
+ * the BMA400 motion model: 1728 training windows, 1728 held out
+ * depth 4, 9 nodes, held-out accuracy 99.9%
+ */
+
+#include "app_classifier.h"
+
+const classifier_node_t classifier_model[] = {
+    /*   0 */ { CLASSIFIER_IN_VAR_SUM, 2, 811 },
+    /*   1 */ { CLASSIFIER_LEAF, 0, ACTIVITY_DESK },
+    /*   2 */ { CLASSIFIER_IN_VAR_SUM, 8, 42952 },
+    /*   3 */ { CLASSIFIER_IN_FREQ_X, 5, 468 },
+    /*   4 */ { CLASSIFIER_LEAF, 0, ACTIVITY_WALKING },
+    /*   5 */ { CLASSIFIER_IN_VAR_SUM, 7, 17169 },
+    /*   6 */ { CLASSIFIER_LEAF, 0, ACTIVITY_WALKING },
+    /*   7 */ { CLASSIFIER_LEAF, 0, ACTIVITY_RUNNING },
+    /*   8 */ { CLASSIFIER_LEAF, 0, ACTIVITY_RUNNING },
+};
+
+const uint8_t classifier_model_len = sizeof(classifier_model) / sizeof(classifier_model[0]);
@@ -0,0 +1,369 @@
+/**
+ * energy-aware sampling scheduler
+ *
+ * estimates the harvested power from the slope of successive v_store samples
+ * (plus what the firmware knowingly spent in between) and plans the next
+ * bursts from it:
+ *  - ODR: the highest rate the estimated harvest sustains while streaming
+ *    continuously, otherwise 25Hz duty cycled by the capacitor charge. a full
+ *    capacitor hides the harvest (the LTC3109 clamps it), so the fastest
+ *    rate is used rather than wasting the surplus
+ *  - burst size: the largest whole number of notifications the FIFO holds.
+ *    the connection event dominates the cost of a notification, so several
+ *    full notifications per event amortise it over far more samples. the
+ *    sample format sets the FIFO frames, the payload bytes per sample are
+ *    learned from the notifications sent (Rice coded samples vary in size).
+ *    when features or activities are sent, the burst is a whole number of
+ *    feature windows instead, so a window never spans the accelerometer
+ *    sleeping
+ *  - poll period: the next v_store sample comes three quarters of the way
+ *    to when the harvest estimate expects the burst (or BLE init) threshold
+ *    to be reached, up to ENERGY_POLL_MAX_MS ahead, and every
+ *    ENERGY_POLL_MIN_MS close to it. where polling costs more than the
+ *    LPCOMP, the LPCOMP waits for v_store to rise past the highest level it
+ *    can see below the burst (or BLE init) threshold instead, and polling
+ *    resumes from there. while a burst runs nothing waits for v_store, it is
+ *    only sampled as a backstop ENERGY_POLL_MAX_MS out: the burst is read
+ *    well before that, and a sample in between would hold up the next burst
+ *    for the divider. sampled into the ring, a sample reaching the threshold
+ *    is reported without waiting for the ring. the v_store divider is
+ *    switched off between these sparse samples unless the harvest covers the
+ *    fastest ODR, where its settling would only hold up the next burst
+ * a burst only starts if its estimated cost leaves at least
+ * V_STORE_LVL_SAMPLE on the capacitor, plus one notification more than
+ * planned. the cost counts the notifications the burst completes together
+ * with the samples still buffered, and the time mark in front of it.
+ */
+
+#include "app_energy.h"
+#include "app_accelerometer.h"
+#include "app_voltage.h"
+#include "app_frame.h"
+#include "app_debug.h"
+#include "bma400_defs.h"
+#include "nrf_pwr_mgmt.h"
+#include "app_scheduler.h"
+#include "sdk_config.h"
+
+#define PACKET_DATA_LEN     (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3 - FRAME_HEADER_LEN)
+#define PACKETS_PER_EVENT   MIN(BLE_HVN_TX_QUEUE_SIZE, \
+                                NRF_SDH_BLE_GAP_EVENT_LENGTH * 1250 / ENERGY_BLE_PACKET_US)
+
+static const struct {
+    uint8_t odr;
+    uint16_t hz_x10;
+} odr_table[] = {   // fastest first
+    { BMA400_ODR_100HZ, 1000 },
+    { BMA400_ODR_50HZ,  500 },
+    { BMA400_ODR_25HZ,  250 },
+};
+
+static const uint16_t poll_table_ms[] = {     // slowest first
+    30000, 20000, 10000, 5000, 3000, 2000, 1000, 500, 200, 100
+};
+
+static energy_plan_t plan = {
+    .odr = BMA400_ODR_25HZ,
+    .burst_samples = PACKET_DATA_LEN / 6,
+    .poll_ms = V_STORE_SAMP_PERIOD_MS,
+    .wake_mv = 0,
+};
+static uint16_t payload_x16 = 6 * 16;       // payload bytes per sample, 1/16 units
+static uint16_t window_samples = 0;         // feature window, 0 when sending samples
+static uint16_t backlog_samples = 0;        // buffered, not yet sent
+
+static int32_t energy_last_nj = -1;
+static int32_t energy_now_nj = 0;
+static int32_t energy_now_uj = 0;
+static uint32_t sample_last_ticks = 0;
+static uint32_t spent_uj = 0;
+static int32_t harvest_uw = 0;
+static uint32_t settled_ms = 0;
+static bool ble_init_pending = false;       // in energy_wait_for_ble_init()
+static bool burst_running = false;          // accelerometer filling its FIFO
+static bool div_gating = true;              // divider switched off between sparse samples
+
+// unit conversions -----------------------------------------------------------
+
+static inline int32_t energy_from_mv(int32_t mv) {
+    return (int32_t)((int64_t)ENERGY_CAP_UF * mv * mv / 2000000);
+}
+
+// in nJ: a 12 bit sample resolves less than 1uJ
+static inline int32_t energy_nj_from_uv(int32_t uv) {
+    return (int32_t)((int64_t)ENERGY_CAP_UF * uv * uv / 2000000000);
+}
+
+static int32_t mv_from_energy(int32_t energy_uj) {
+    // integer sqrt of 2E/C, in mV
+    uint32_t sq = (uint32_t)MAX(energy_uj, 0) * (2000000 / ENERGY_CAP_UF);
+    uint32_t mv = 0;
+    for (uint32_t bit = 1u << 14; bit; bit >>= 1) {
+        if ((mv + bit) * (mv + bit) <= sq) mv += bit;
+    }
+    return (int32_t)mv;
+}
+
+static inline uint32_t ticks_to_ms(uint32_t ticks) {
+    return (uint32_t)((uint64_t)ticks * 1000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1) / APP_TIMER_CLOCK_FREQ);
+}
+
+static inline int32_t notify_cost_uj(uint16_t n_packets) {
+    return CEIL_DIV(n_packets, PACKETS_PER_EVENT) * ENERGY_BLE_EVENT_UJ + n_packets * ENERGY_BLE_PACKET_UJ;
+}
+
+static inline uint16_t samples_per_packet(void) {
+    return PACKET_DATA_LEN * 16 / payload_x16;
+}
+
+// FIFO read and payload bytes of one sample in the current format
+static inline int32_t sample_cost_nj(void) {
+    accelerometer_format_t format = accelerometer_get_format();
+    return ENERGY_BURST_SAMPLE_NJ
+         + (1 + accelerometer_sample_size(format)) * ENERGY_FIFO_BYTE_NJ
+         + payload_x16 * ENERGY_PAYLOAD_BYTE_NJ / 16;
+}
+
+// the notifications go out once the burst has been read: the backlog and the
+// burst fill whole ones, the burst's time mark taking the room of samples.
+// what is left over waits for the next burst
+static inline int32_t burst_cost_uj(uint16_t n_samples) {
+    uint16_t mark_samples = CEIL_DIV(FRAME_MARK_LEN * 16, payload_x16);
+    uint16_t n_packets = (backlog_samples + n_samples + mark_samples) / samples_per_packet();
+    return ENERGY_BURST_FIXED_UJ + (int32_t)n_samples * sample_cost_nj() / 1000 + notify_cost_uj(n_packets);
+}
+
+// what a burst has to leave on the capacitor: V_STORE_LVL_SAMPLE, and one
+// notification more than planned, in a connection event of its own
+static inline int32_t burst_floor_uj(void) {
+    return energy_from_mv(V_STORE_LVL_SAMPLE) + notify_cost_uj(1) + PACKET_DATA_LEN * ENERGY_PAYLOAD_BYTE_NJ / 1000;
+}
+
+static inline int32_t harvest_planned_uw(void) {
+    return harvest_uw * ENERGY_HARVEST_MARGIN_PCT / 100;
+}
+
+// a v_store sample, with the conversions oversampling averages
+static inline int32_t adc_sample_nj(void) {
+    return ENERGY_ADC_SAMPLE_NJ + ((1 << VOLTAGE_SAADC_OVERSAMPLE) - 1) * ENERGY_ADC_OVERSAMPLE_NJ;
+}
+
+// v_store divider at the last sample, on throughout or only while settling
+// ahead of each sample
+static inline int32_t divider_nw(uint16_t poll_ms, bool lpcomp) {
+    // V^2 / R, V^2 = 2E / C
+    int32_t on_nw = MAX(energy_now_uj, 0) * (2000000 / ENERGY_CAP_UF)
+                  / (VOLTAGE_DIV_R_TOP_KOHM + VOLTAGE_DIV_R_BOTTOM_KOHM);
+    if (!div_gating || !voltage_divider_gated(poll_ms, lpcomp)) return on_nw;
+    return on_nw * (VOLTAGE_DIV_SETTLE_US / 1000) / poll_ms;
+}
+
+// leakage and watching v_store
+static inline int32_t base_load_nw(void) {
+    return ENERGY_IDLE_NW + adc_sample_nj() * 1000 / plan.poll_ms + (plan.wake_mv ? ENERGY_LPCOMP_NW : 0)
+         + divider_nw(plan.poll_ms, plan.wake_mv != 0);
+}
+
+// planning -------------------------------------------------------------------
+
+static void plan_update(void) {
+    int32_t floor_uj = burst_floor_uj();
+
+    // largest whole number of notifications (feature windows) the FIFO holds
+    // and the full capacitor can pay for
+    int32_t budget_uj = energy_from_mv(ENERGY_V_STORE_MAX_MV) - floor_uj;
+    uint16_t unit = window_samples ? window_samples : samples_per_packet();
+    uint16_t max_samples = accelerometer_max_samples(accelerometer_get_format());
+    plan.burst_samples = MIN(unit, max_samples);
+    for (uint16_t n = max_samples / unit * unit; n > unit; n -= unit) {
+        if (burst_cost_uj(n) <= budget_uj) {
+            plan.burst_samples = n;
+            break;
+        }
+    }
+
+    // fastest ODR the harvest sustains when streaming continuously
+    int32_t sample_nj = burst_cost_uj(plan.burst_samples) * 1000 / plan.burst_samples;
+    int32_t base_nw = base_load_nw();
+    int32_t avail_nw = harvest_planned_uw() * 1000 - base_nw;
+
+    // the capacitor counts as full if only the last burst's cost is missing
+    bool full = energy_now_uj + burst_cost_uj(plan.burst_samples) >= energy_from_mv(ENERGY_V_STORE_MAX_MV);
+    plan.odr = BMA400_ODR_25HZ;
+    for (uint8_t i = 0; i < ARRAY_SIZE(odr_table); i++) {
+        int32_t demand_nw = odr_table[i].hz_x10 * sample_nj / 10 + ENERGY_ACCEL_NW;
+        if (demand_nw <= avail_nw || full) {
+            plan.odr = odr_table[i].odr;
+            break;
+        }
+    }
+
+    // with energy to spare the divider's leakage does not matter, but a
+    // sample waiting for it to settle holds up the next burst
+    div_gating = (plan.odr != odr_table[0].odr);
+    voltage_divider_gating(div_gating);
+
+    // the next sample three quarters of the way to when the burst (or BLE
+    // init) threshold is expected to be reached at the estimated charge rate:
+    // rarely while v_store is far below it, every ENERGY_POLL_MIN_MS close to
+    // it. the harvest estimate takes the energy spent out of the v_store slope,
+    // and spending not seen in a sample yet counts as missing
+    int32_t need_uj = ble_init_pending ? energy_from_mv(energy_ble_init_thresh_mv())
+                    : floor_uj + burst_cost_uj(plan.burst_samples);
+    int32_t missing_uj = need_uj - energy_now_uj + (int32_t)spent_uj;
+    int32_t net_uw = harvest_planned_uw() - base_nw / 1000;
+    uint32_t wait_ms = ENERGY_POLL_MIN_MS;
+    if (missing_uj > 0 && settled_ms < ENERGY_TAU_MS) {
+        wait_ms = ENERGY_POLL_UNSETTLED_MS;
+    } else if (missing_uj > 0) {
+        wait_ms = (net_uw > 0) ? (uint32_t)missing_uj * 750 / net_uw : ENERGY_POLL_MAX_MS;
+    }
+
+    uint8_t i = 0;
+    while (i < ARRAY_SIZE(poll_table_ms) - 1 && poll_table_ms[i] > wait_ms) i++;
+    uint16_t wait_poll_ms = poll_table_ms[i];
+
+    // but at most one step slower at a time: a single sample off the trend
+    // (BLE init drawing on the capacitor, a dip in the harvest) does not put
+    // polling to sleep
+    while (i < ARRAY_SIZE(poll_table_ms) - 1 && poll_table_ms[i + 1] > plan.poll_ms) i++;
+    uint16_t poll_ms = poll_table_ms[i];
+
+    // v_store the wait is for (the lowest that makes the burst ready). a
+    // sample reaching it is reported right away; after spending, the last
+    // sample no longer tells whether it has been reached
+    int32_t target_mv = ble_init_pending ? energy_ble_init_thresh_mv() : mv_from_energy(need_uj) + 1;
+    bool waiting = ble_init_pending || (!burst_running && (missing_uj > 0 || spent_uj > 0));
+    voltage_report_above(waiting ? target_mv : 0);
+
+    // hand the wait over to the LPCOMP where it costs less than polling at
+    // the period the wait allows, even with the backstop samples that keep
+    // the harvest estimate going and the divider kept on for it
+    int32_t poll_nw = adc_sample_nj() * 1000 / wait_poll_ms + divider_nw(wait_poll_ms, false);
+    int32_t lpcomp_nw = ENERGY_LPCOMP_NW + adc_sample_nj() * 1000 / ENERGY_POLL_WAKE_MS
+                      + divider_nw(ENERGY_POLL_WAKE_MS, true);
+    int32_t wake_mv = 0;
+    if (!burst_running && poll_nw > lpcomp_nw) {
+        int32_t level_mv = voltage_wake_level_mv(target_mv);
+        if (level_mv >= mv_from_energy(energy_now_uj) + ENERGY_WAKE_MARGIN_MV) wake_mv = level_mv;
+    }
+    if (wake_mv != plan.wake_mv) {
+        plan.wake_mv = voltage_wake_above(wake_mv) ? wake_mv : 0;
+    }
+    if (plan.wake_mv) poll_ms = ENERGY_POLL_WAKE_MS;
+    if (burst_running) poll_ms = ENERGY_POLL_MAX_MS;
+
+    if (poll_ms != plan.poll_ms) {
+        plan.poll_ms = poll_ms;
+        voltage_set_sample_period(poll_ms);
+    }
+}
+
+// estimator ------------------------------------------------------------------
+
+// fresh v_store sample
+void energy_update(int32_t v_store_uv) {
+    uint32_t now_ticks = app_timer_cnt_get();
+    energy_now_nj = energy_nj_from_uv(v_store_uv);
+    energy_now_uj = energy_now_nj / 1000;
+
+    // while the capacitor sits at the clamp the surplus is thrown away and
+    // the slope only shows a lower bound of the harvest
+    int32_t clamp_nj = energy_from_mv(ENERGY_V_STORE_CLAMP_MV) * 1000;
+    if (energy_last_nj >= 0 && energy_last_nj < clamp_nj && energy_now_nj < clamp_nj) {
+        uint32_t dt_ms = ticks_to_ms(app_timer_cnt_diff_compute(now_ticks, sample_last_ticks));
+        if (dt_ms > 0) {
+            // harvest = change in stored energy + known spending + background load
+            int32_t load_uw = base_load_nw() / 1000;
+            int32_t p_uw = (energy_now_nj - energy_last_nj + (int32_t)spent_uj * 1000) / (int32_t)dt_ms
+                         + load_uw;
+            int32_t weight_ms = MIN(dt_ms, ENERGY_TAU_MS);
+            harvest_uw += (p_uw - harvest_uw) * weight_ms / ENERGY_TAU_MS;
+            harvest_uw = MAX(harvest_uw, 0);
+            settled_ms = MIN(settled_ms + dt_ms, ENERGY_TAU_MS);
+        }
+    }
+    energy_last_nj = energy_now_nj;
+    sample_last_ticks = now_ticks;
+    spent_uj = 0;
+
+    plan_update();
+}
+
+void energy_note_spend(uint32_t energy_uj) {
+    spent_uj += energy_uj;
+}
+
+// accelerometer woken for a burst
+void energy_note_burst_start(void) {
+    burst_running = true;
+    plan_update();
+}
+
+// FIFO drain; the notifications are booked as they are queued. polling
+// resumes, so the next sample sees them spent
+void energy_note_burst(uint16_t n_samples) {
+    energy_note_spend(ENERGY_BURST_FIXED_UJ + (uint32_t)n_samples * sample_cost_nj() / 1000);
+    burst_running = false;
+    plan_update();
+}
+
+// samples and their payload bytes in one notification. a quarter of the step
+// per notification: a format switch settles within a few bursts
+void energy_note_payload(uint16_t n_samples, uint16_t n_bytes) {
+    int32_t x16 = (int32_t)n_bytes * 16 / n_samples;
+    payload_x16 = (uint16_t)MAX(payload_x16 + (x16 - (int32_t)payload_x16) / 4, 1);
+}
+
+// samples (or the windows of feature records) buffered and not sent yet,
+// after the notifications just queued
+void energy_note_backlog(uint16_t n_samples) {
+    backlog_samples = n_samples;
+}
+
+// plan bursts in whole feature windows of n_samples, 0 in notifications
+void energy_set_window(uint16_t n_samples) {
+    window_samples = n_samples;
+}
+
+void energy_note_notifications(uint8_t n_packets) {
+    energy_note_spend(notify_cost_uj(n_packets));
+}
+
+bool energy_burst_ready(void) {
+    return energy_now_uj - burst_cost_uj(plan.burst_samples) >= burst_floor_uj();
+}
+
+energy_plan_t const *energy_get_plan(void) {
+    return &plan;
+}
+
+int32_t energy_get_harvest_uw(void) {
+    return harvest_uw;
+}
+
+// BLE init -------------------------------------------------------------------
+
+// v_store needed to get through BLE init while harvesting at the estimated
+// rate. until the estimate has settled, assume no harvest at all.
+int32_t energy_ble_init_thresh_mv(void) {
+    int32_t harvest_during_uj = (settled_ms >= ENERGY_TAU_MS)
+                              ? harvest_planned_uw() * ENERGY_BLE_INIT_MS / 1000 : 0;
+    int32_t load_during_uj = base_load_nw() / 1000 * ENERGY_BLE_INIT_MS / 1000;
+    int32_t need_uj = energy_from_mv(V_STORE_LVL_SAMPLE) + ENERGY_BLE_INIT_UJ + load_during_uj
+                    - harvest_during_uj;
+    return MIN(MAX(mv_from_energy(need_uj), V_STORE_LVL_BLE_INIT), ENERGY_V_STORE_MAX_MV);
+}
+
+void energy_wait_for_ble_init(void) {
+    ble_init_pending = true;
+    // the v_store samples reach energy_update() through the scheduler, and the
+    // main loop only starts after BLE init
+    while (voltage_read_v_store() < energy_ble_init_thresh_mv()) {
+        app_sched_execute();
+        nrf_pwr_mgmt_run();
+    }
+    ble_init_pending = false;
+    debug_log("BLE init at %d mV, harvest ~%d uW", voltage_read_v_store(), harvest_uw);
+    energy_note_spend(ENERGY_BLE_INIT_UJ);
+}
@@ -0,0 +1,157 @@
+/**
+ * windowed activity recognition features, see app_features.h for the
+ * definitions and the record layout
+ */
+
+#include "app_features.h"
+
+#define DFT_POINTS          128     // sine table period
+
+// round(4096 * sin(2 pi j / 128)), one period and a quarter: the cosine is
+// sin_q12[j + DFT_POINTS / 4]
+static const int16_t sin_q12[DFT_POINTS + DFT_POINTS / 4] = {
+    0, 201, 401, 601, 799, 995, 1189, 1380, 1567, 1751, 1931, 2106, 2276, 2440, 2598, 2751,
+    2896, 3035, 3166, 3290, 3406, 3513, 3612, 3703, 3784, 3857, 3920, 3973, 4017, 4052, 4076, 4091,
+    4096, 4091, 4076, 4052, 4017, 3973, 3920, 3857, 3784, 3703, 3612, 3513, 3406, 3290, 3166, 3035,
+    2896, 2751, 2598, 2440, 2276, 2106, 1931, 1751, 1567, 1380, 1189, 995, 799, 601, 401, 201,
+    0, -201, -401, -601, -799, -995, -1189, -1380, -1567, -1751, -1931, -2106, -2276, -2440, -2598, -2751,
+    -2896, -3035, -3166, -3290, -3406, -3513, -3612, -3703, -3784, -3857, -3920, -3973, -4017, -4052, -4076, -4091,
+    -4096, -4091, -4076, -4052, -4017, -3973, -3920, -3857, -3784, -3703, -3612, -3513, -3406, -3290, -3166, -3035,
+    -2896, -2751, -2598, -2440, -2276, -2106, -1931, -1751, -1567, -1380, -1189, -995, -799, -601, -401, -201,
+    0, 201, 401, 601, 799, 995, 1189, 1380, 1567, 1751, 1931, 2106, 2276, 2440, 2598, 2751,
+    2896, 3035, 3166, 3290, 3406, 3513, 3612, 3703, 3784, 3857, 3920, 3973, 4017, 4052, 4076, 4091,
+};
+
+static inline int16_t raw_axis(uint8_t const *p) {
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint8_t log2_window(uint16_t n_samples) {
+    uint8_t shift = 0;
+    while ((1u << shift) < n_samples) shift++;
+    return shift;
+}
+
+bool features_window_valid(uint16_t n_samples) {
+    return n_samples >= FEATURES_WINDOW_MIN && n_samples <= FEATURES_WINDOW_MAX
+        && (n_samples & (n_samples - 1)) == 0;
+}
+
+// bin 1 .. n/2 with the most power in the mean free values d. the input is
+// real, so d[i] and d[n - i] share their cosine and have opposite sines:
+// summing their sum and difference takes half the multiply-adds of the plain
+// DFT and gives the same, exact values.
+static uint8_t dominant_bin(int16_t const *d, uint8_t n_samples) {
+    uint8_t half = n_samples / 2;
+    uint8_t step = DFT_POINTS / n_samples;
+    int16_t sum[FEATURES_WINDOW_MAX / 2], diff[FEATURES_WINDOW_MAX / 2];
+    uint64_t best = 0;
+    uint8_t best_k = 0;
+
+    for (uint8_t i = 1; i < half; i++) {
+        sum[i] = d[i] + d[n_samples - i];
+        diff[i] = d[i] - d[n_samples - i];
+    }
+
+    for (uint8_t k = 1; k <= half; k++) {
+        uint8_t dj = k * step;
+        int32_t re = (d[0] + ((k & 1) ? -d[half] : d[half])) * sin_q12[DFT_POINTS / 4];
+        int32_t im = 0;
+        for (uint8_t i = 1, j = dj; i < half; i++, j = (j + dj) & (DFT_POINTS - 1)) {
+            re += sum[i] * sin_q12[j + DFT_POINTS / 4];
+            im += diff[i] * sin_q12[j];
+        }
+        uint64_t power = (uint64_t)((int64_t)re * re) + (uint64_t)((int64_t)im * im);
+        if (power > best) {
+            best = power;
+            best_k = k;
+        }
+    }
+    return best_k;
+}
+
+// features of n_samples 12 bit samples (int16 x, y, z little-endian, as in
+// the send buffer). n_samples has to pass features_window_valid().
+void features_compute(uint8_t const *p_raw, uint8_t n_samples, features_t *p_features) {
+    uint8_t shift = log2_window(n_samples);
+    int16_t d[FEATURES_WINDOW_MAX];
+
+    p_features->window = n_samples;
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        features_axis_t *p_axis = &p_features->axis[axis];
+        uint8_t const *p = &p_raw[2 * axis];
+        int32_t sum = 0;
+        uint32_t sum_sq = 0;
+        for (uint8_t i = 0; i < n_samples; i++, p += 6) {
+            int16_t x = raw_axis(p);
+            d[i] = x;
+            sum += x;
+            sum_sq += (uint32_t)(x * x);
+        }
+
+        p_axis->mean = (int16_t)(sum / n_samples);
+        p_axis->variance = (uint32_t)(((uint64_t)sum_sq * n_samples - (uint64_t)((int64_t)sum * sum)) >> (2 * shift));
+        p_axis->energy = sum_sq >> shift;
+
+        int8_t sign = 0;
+        p_axis->zero_crossings = 0;
+        for (uint8_t i = 0; i < n_samples; i++) {
+            int32_t centred = d[i] * n_samples - sum;
+            int8_t s = (centred > 0) - (centred < 0);
+            if (s && sign && s != sign) p_axis->zero_crossings++;
+            if (s) sign = s;
+            d[i] -= p_axis->mean;
+        }
+
+        p_axis->dominant_bin = dominant_bin(d, n_samples);
+    }
+}
+
+static inline uint8_t *put_u24(uint8_t *p, uint32_t value) {
+    *p++ = (uint8_t)value;
+    *p++ = (uint8_t)(value >> 8);
+    *p++ = (uint8_t)(value >> 16);
+    return p;
+}
+
+static inline uint32_t get_u24(uint8_t const *p) {
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+}
+
+// FEATURES_LEN bytes to p_buf
+void features_encode(features_t const *p_features, uint8_t *p_buf) {
+    uint8_t *p = p_buf;
+
+    *p++ = p_features->window;
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        features_axis_t const *p_axis = &p_features->axis[axis];
+        *p++ = (uint8_t)p_axis->mean;
+        *p++ = (uint8_t)((uint16_t)p_axis->mean >> 8);
+        p = put_u24(p, p_axis->variance);
+        p = put_u24(p, p_axis->energy);
+        *p++ = p_axis->zero_crossings;
+        *p++ = p_axis->dominant_bin;
+    }
+}
+
+// parse a received record. false if it cannot come from 12 bit samples.
+bool features_decode(uint8_t const *p_buf, features_t *p_features) {
+    uint8_t const *p = p_buf;
+
+    p_features->window = *p++;
+    if (!features_window_valid(p_features->window)) return false;
+    for (uint8_t axis = 0; axis < 3; axis++, p += FEATURES_AXIS_LEN) {
+        features_axis_t *p_axis = &p_features->axis[axis];
+        p_axis->mean = raw_axis(p);
+        p_axis->variance = get_u24(&p[2]);
+        p_axis->energy = get_u24(&p[5]);
+        p_axis->zero_crossings = p[8];
+        p_axis->dominant_bin = p[9];
+        if (p_axis->mean < -2048 || p_axis->mean > 2047 || p_axis->energy > 2048 * 2048
+            || p_axis->variance > p_axis->energy || p_axis->zero_crossings >= p_features->window
+            || p_axis->dominant_bin > p_features->window / 2) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,303 @@
+/**
+ * notification payload framing, see app_frame.h for the layout
+ */
+
+#include "app_frame.h"
+#include "app_features.h"
+#include "app_classifier.h"
+
+#include <string.h>
+
+#define RICE_RAW_BITS       12      // first sample of a frame, per axis
+#define RICE_ESCAPE_BITS    13      // zig-zag difference of two 12 bit values
+#define RICE_K_MAX          RICE_RAW_BITS
+
+// bytes per sample (per feature or activity record), 0 for unknown formats
+// and the variable length Rice format
+uint8_t frame_sample_len(uint8_t format) {
+    switch (format) {
+    case FRAME_FORMAT_12_BIT:   return 6;
+    case FRAME_FORMAT_8_BIT:    return 3;
+    case FRAME_FORMAT_FEATURES: return FEATURES_LEN;
+    case FRAME_FORMAT_ACTIVITY: return ACTIVITY_LEN;
+    default:                    return 0;
+    }
+}
+
+uint16_t frame_header_len(uint8_t n_marks) {
+    return FRAME_HEADER_LEN + n_marks * FRAME_MARK_LEN;
+}
+
+// write the header and marks to p_buf, the samples are expected right
+// behind them. returns the header length.
+uint16_t frame_write_header(frame_t const *p_frame, uint8_t *p_buf) {
+    uint8_t *p = p_buf;
+
+    *p++ = (uint8_t)((FRAME_VERSION << 4) | (p_frame->flags & 0x0F));
+    *p++ = p_frame->seq;
+    *p++ = (uint8_t)((p_frame->format << 4) | (p_frame->n_marks & 0x0F));
+    *p++ = p_frame->n_samples;
+    for (uint8_t i = 0; i < p_frame->n_marks; i++) {
+        frame_mark_t const *p_mark = &p_frame->marks[i];
+        *p++ = p_mark->index;
+        *p++ = p_mark->odr;
+        *p++ = (uint8_t)p_mark->time;
+        *p++ = (uint8_t)(p_mark->time >> 8);
+        *p++ = (uint8_t)(p_mark->time >> 16);
+    }
+    return (uint16_t)(p - p_buf);
+}
+
+// header and a copy of the p_frame->data_len bytes at p_frame->p_samples,
+// which are already in the frame's format. returns the frame length, 0 if it
+// does not fit into size bytes.
+uint16_t frame_encode(frame_t const *p_frame, uint8_t *p_buf, uint16_t size) {
+    uint16_t header_len = frame_header_len(p_frame->n_marks);
+
+    if (p_frame->n_marks > FRAME_MARKS_MAX || header_len + p_frame->data_len > size) return 0;
+    frame_write_header(p_frame, p_buf);
+    memcpy(&p_buf[header_len], p_frame->p_samples, p_frame->data_len);
+    return header_len + p_frame->data_len;
+}
+
+// parse and check a received payload. on FRAME_OK, p_frame->p_samples points
+// at the samples in p_buf. Rice coded samples are checked by frame_samples().
+frame_result_t frame_decode(uint8_t const *p_buf, uint16_t len, frame_t *p_frame) {
+    if (len < FRAME_HEADER_LEN) return FRAME_ERR_SHORT;
+    if ((p_buf[0] >> 4) != FRAME_VERSION) return FRAME_ERR_VERSION;
+
+    p_frame->flags = p_buf[0] & 0x0F;
+    p_frame->seq = p_buf[1];
+    p_frame->format = p_buf[2] >> 4;
+    p_frame->n_marks = p_buf[2] & 0x0F;
+    p_frame->n_samples = p_buf[3];
+
+    uint8_t sample_len = frame_sample_len(p_frame->format);
+    if (sample_len == 0 && p_frame->format != FRAME_FORMAT_12_BIT_RICE) return FRAME_ERR_FORMAT;
+    if (p_frame->n_marks > FRAME_MARKS_MAX) return FRAME_ERR_MARK;
+    if (p_frame->format == FRAME_FORMAT_ACTIVITY && p_frame->n_marks != p_frame->n_samples) return FRAME_ERR_MARK;
+
+    uint16_t header_len = frame_header_len(p_frame->n_marks);
+    if (len < header_len) return FRAME_ERR_SHORT;
+    p_frame->data_len = len - header_len;
+    if (sample_len && p_frame->data_len != p_frame->n_samples * sample_len) return FRAME_ERR_LENGTH;
+
+    uint8_t const *p = &p_buf[FRAME_HEADER_LEN];
+    for (uint8_t i = 0; i < p_frame->n_marks; i++, p += FRAME_MARK_LEN) {
+        frame_mark_t *p_mark = &p_frame->marks[i];
+        p_mark->index = p[0];
+        p_mark->odr = p[1];
+        p_mark->time = p[2] | ((uint32_t)p[3] << 8) | ((uint32_t)p[4] << 16);
+        if (p_mark->index >= p_frame->n_samples || (i && p_mark->index <= p_mark[-1].index)) {
+            return FRAME_ERR_MARK;
+        }
+    }
+    p_frame->p_samples = &p_buf[header_len];
+    return FRAME_OK;
+}
+
+// frames missing between two received sequence numbers: 0 in order, > 0
+// lost, < 0 a repeated or reordered frame
+int16_t frame_seq_gap(uint8_t last_seq, uint8_t seq) {
+    return (int8_t)(uint8_t)(seq - last_seq - 1);
+}
+
+// Rice coding ----------------------------------------------------------------
+
+// adaptive parameter of one axis
+typedef struct {
+    uint32_t a;
+    uint8_t n;
+} rice_state_t;
+
+static void rice_init(rice_state_t *p_state) {
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        p_state[axis].a = FRAME_RICE_A_INIT;
+        p_state[axis].n = 1;
+    }
+}
+
+static inline uint8_t rice_k(rice_state_t const *p_state) {
+    uint8_t k = 0;
+    while (((uint32_t)p_state->n << k) < p_state->a && k < RICE_K_MAX) k++;
+    return k;
+}
+
+static inline void rice_update(rice_state_t *p_state, uint16_t u) {
+    p_state->a += u;
+    if (++p_state->n == FRAME_RICE_N_RESET) {
+        p_state->a >>= 1;
+        p_state->n >>= 1;
+    }
+}
+
+static inline uint16_t zigzag(int16_t d) {
+    return (uint16_t)(((uint16_t)d << 1) ^ (uint16_t)(d >> 15));
+}
+
+static inline int16_t unzigzag(uint16_t u) {
+    return (int16_t)((u >> 1) ^ -(int16_t)(u & 1));
+}
+
+static inline uint8_t rice_len(uint16_t u, uint8_t k) {
+    uint16_t q = u >> k;
+    return (q < FRAME_RICE_ESCAPE) ? q + 1 + k : FRAME_RICE_ESCAPE + RICE_ESCAPE_BITS;
+}
+
+typedef struct {
+    uint8_t *p;
+    uint32_t acc;
+    uint8_t n;                  // bits in acc not written yet, < 8
+} bit_writer_t;
+
+// append the n_bits low bits of value, n_bits <= 24
+static inline void bits_put(bit_writer_t *p_w, uint32_t value, uint8_t n_bits) {
+    p_w->acc = (p_w->acc << n_bits) | (value & ((1UL << n_bits) - 1));
+    p_w->n += n_bits;
+    while (p_w->n >= 8) {
+        p_w->n -= 8;
+        *p_w->p++ = (uint8_t)(p_w->acc >> p_w->n);
+    }
+}
+
+static inline void rice_put(bit_writer_t *p_w, uint16_t u, uint8_t k) {
+    uint16_t q = u >> k;
+    if (q < FRAME_RICE_ESCAPE) {
+        bits_put(p_w, (1UL << (q + 1)) - 2, q + 1);     // q ones, a zero
+        bits_put(p_w, u, k);
+    } else {
+        bits_put(p_w, (1UL << FRAME_RICE_ESCAPE) - 1, FRAME_RICE_ESCAPE);
+        bits_put(p_w, u, RICE_ESCAPE_BITS);
+    }
+}
+
+static inline int16_t raw_axis(uint8_t const *p) {
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+// code 12 bit samples (int16 x, y, z little-endian, as in FRAME_FORMAT_12_BIT)
+// into p_out, as many of the n_raw as fit into out_len bytes. returns the
+// number of samples coded, *p_data_len the bytes used.
+uint8_t frame_rice_encode(uint8_t const *p_raw, uint8_t n_raw, uint8_t *p_out, uint16_t out_len,
+                          uint16_t *p_data_len) {
+    bit_writer_t w = { .p = p_out };
+    uint32_t bits_left = (uint32_t)out_len * 8;
+    rice_state_t state[3];
+    uint8_t n = 0;
+
+    *p_data_len = 0;
+    if (n_raw == 0 || bits_left < 3 * RICE_RAW_BITS) return 0;
+
+    for (uint8_t axis = 0; axis < 3; axis++) bits_put(&w, (uint16_t)raw_axis(&p_raw[2 * axis]), RICE_RAW_BITS);
+    bits_left -= 3 * RICE_RAW_BITS;
+    rice_init(state);
+
+    for (n = 1; n < n_raw; n++) {
+        uint8_t const *p = &p_raw[6 * n];
+        uint16_t u[3];
+        uint8_t k[3];
+        uint8_t len = 0;
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            u[axis] = zigzag(raw_axis(&p[2 * axis]) - raw_axis(&p[2 * axis - 6]));
+            k[axis] = rice_k(&state[axis]);
+            len += rice_len(u[axis], k[axis]);
+        }
+        if (len > bits_left) break;
+
+        bits_left -= len;
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            rice_put(&w, u[axis], k[axis]);
+            rice_update(&state[axis], u[axis]);
+        }
+    }
+
+    if (w.n) bits_put(&w, 0, 8 - w.n);
+    *p_data_len = (uint16_t)(w.p - p_out);
+    return n;
+}
+
+typedef struct {
+    uint8_t const *p;
+    uint8_t const *end;
+    uint32_t acc;
+    uint8_t n;                  // bits in acc not read yet
+} bit_reader_t;
+
+// next n_bits bits, n_bits <= 24. false past the end of the data.
+static inline bool bits_get(bit_reader_t *p_r, uint8_t n_bits, uint32_t *p_value) {
+    while (p_r->n < n_bits) {
+        if (p_r->p == p_r->end) return false;
+        p_r->acc = (p_r->acc << 8) | *p_r->p++;
+        p_r->n += 8;
+    }
+    p_r->n -= n_bits;
+    *p_value = (p_r->acc >> p_r->n) & ((1UL << n_bits) - 1);
+    return true;
+}
+
+// only the code the encoder would produce is accepted, so a frame decodes to
+// one set of samples and codes back to the same bytes
+static bool rice_get(bit_reader_t *p_r, uint8_t k, uint16_t *p_u) {
+    uint32_t bit, low;
+    uint16_t q = 0;
+    for (;;) {
+        if (!bits_get(p_r, 1, &bit)) return false;
+        if (!bit) break;
+        if (++q == FRAME_RICE_ESCAPE) {
+            if (!bits_get(p_r, RICE_ESCAPE_BITS, &low)) return false;
+            *p_u = (uint16_t)low;
+            return (*p_u >> k) >= FRAME_RICE_ESCAPE;
+        }
+    }
+    if (!bits_get(p_r, k, &low)) return false;
+    *p_u = (uint16_t)((q << k) | low);
+    return true;
+}
+
+static frame_result_t rice_decode(frame_t const *p_frame, int16_t *p_xyz) {
+    bit_reader_t r = { .p = p_frame->p_samples, .end = p_frame->p_samples + p_frame->data_len };
+    rice_state_t state[3];
+    uint32_t value;
+
+    rice_init(state);
+    for (uint16_t n = 0; n < p_frame->n_samples; n++) {
+        for (uint8_t axis = 0; axis < 3; axis++, p_xyz++) {
+            if (n == 0) {
+                if (!bits_get(&r, RICE_RAW_BITS, &value)) return FRAME_ERR_CODE;
+                *p_xyz = (int16_t)((value ^ 0x800) - 0x800);
+                continue;
+            }
+
+            uint16_t u;
+            if (!rice_get(&r, rice_k(&state[axis]), &u)) return FRAME_ERR_CODE;
+            int16_t v = p_xyz[-3] + unzigzag(u);
+            if (v < -2048 || v > 2047) return FRAME_ERR_CODE;
+            *p_xyz = v;
+            rice_update(&state[axis], u);
+        }
+    }
+
+    // whole bytes, zero padded
+    if (r.p != r.end || r.n >= 8 || (r.acc & ((1UL << r.n) - 1))) return FRAME_ERR_CODE;
+    return FRAME_OK;
+}
+
+// samples of a decoded frame as int16 x, y, z triples (the int8 values in the
+// 8 bit format). p_xyz takes 3 * n_samples values. feature and activity
+// records are read with features_decode() and activity_decode().
+frame_result_t frame_samples(frame_t const *p_frame, int16_t *p_xyz) {
+    uint8_t const *p = p_frame->p_samples;
+
+    switch (p_frame->format) {
+    case FRAME_FORMAT_12_BIT:
+        for (uint16_t i = 0; i < 3 * p_frame->n_samples; i++, p += 2) p_xyz[i] = raw_axis(p);
+        return FRAME_OK;
+    case FRAME_FORMAT_8_BIT:
+        for (uint16_t i = 0; i < 3 * p_frame->n_samples; i++) p_xyz[i] = (int8_t)p[i];
+        return FRAME_OK;
+    case FRAME_FORMAT_12_BIT_RICE:
+        return rice_decode(p_frame, p_xyz);
+    default:
+        return FRAME_ERR_FORMAT;
+    }
+}
@@ -15,13 +15,29 @@ static uint8_t m_rx_buf[APP_SPI_MAX_TRANSFER_LEN] = {0};
 
 static uint8_t *rx_req = NULL;
 static uint8_t rx_ofs = 0;
-static uint8_t xfer_len = 0;
+static uint16_t xfer_len = 0;
 
 static bool initialized = false;
+static uint8_t session_refs = 0;
+static nrf_spim_frequency_t frequency = APP_SPI_FREQ_REG;
+
+// rest of a app_spi_write_regs() batch
+static uint8_t const *batch_pairs = NULL;
+static uint8_t batch_left = 0;
+static volatile int batch_result = 0;
 
 callback_t spi_xfer_callback = NULL;
 static volatile bool spi_xfer_done = false;
 void spim_event_handler(nrfx_spim_evt_t const * p_event, void *p_context) {
+    if (batch_left) {   // next write of a batch, straight from here
+        nrfx_spim_xfer_desc_t xfer_desc = NRFX_SPIM_XFER_TX(batch_pairs, 2);
+        batch_pairs += 2;
+        batch_left--;
+        batch_result = (int)nrfx_spim_xfer(&spi, &xfer_desc, 0);
+        if (batch_result == NRFX_SUCCESS) return;
+        batch_left = 0;
+    }
+
     spi_xfer_done = true;
 
     if (rx_req) {   // copy back received bytes
@@ -33,8 +49,8 @@ void spim_event_handler(nrfx_spim_evt_t const * p_event, void *p_context) {
 
 void app_spi_init(void) {
     if (initialized) return;
-    static const nrfx_spim_config_t spi_config = {
-        .frequency      = NRF_SPIM_FREQ_1M, .ss_active_high = false,
+    nrfx_spim_config_t spi_config = {
+        .frequency      = frequency,        .ss_active_high = false,
         .ss_pin         = IMU_CS,           .miso_pin       = SPI_MISO,
         .mosi_pin       = SPI_MOSI,         .sck_pin        = SPI_SCK,
         
@@ -54,6 +70,25 @@ void app_spi_deinit(void) {
     nrfx_spim_uninit(&spi);
 }
 
+// reference counted init / deinit: the first session brings the peripheral
+// up, the last one takes it down again. nested users (wake, fetch and sleep
+// within one burst) share a single bring-up.
+void app_spi_session_begin(void) {
+    if (session_refs++ == 0) app_spi_init();
+}
+
+void app_spi_session_end(void) {
+    if (session_refs == 0) return;
+    if (--session_refs == 0) app_spi_deinit();
+}
+
+// SPI clock of the following transfers. takes effect right away if the
+// peripheral is up (between transfers only), otherwise at the next init.
+void app_spi_set_frequency(nrf_spim_frequency_t freq) {
+    frequency = freq;
+    if (initialized) nrf_spim_frequency_set(spi.p_reg, freq);
+}
+
 // perform readwrite on spi. 
 // xfer_done callback is called upon transfer completion.
 // pass null to xfer_done to block.
@@ -123,4 +158,66 @@ int app_spi_readwrite_reg(uint8_t reg, uint8_t *tx, uint8_t *rx, uint8_t len, ca
     return 0;
 }
 
+// read after a register byte, DMA'd straight into rx without the bounce
+// buffer. rx[0] receives the byte clocked in with the register byte, so rx
+// must hold len + 1 bytes. the rest of the transfer clocks out orc.
+// len + 1 is limited by APP_SPI_MAX_DMA_LEN rather than the bounce buffer.
+// xfer_done callback is called upon transfer completion.
+// pass null to xfer_done to block.
+int app_spi_read_reg_direct(uint8_t reg, uint8_t *rx, uint16_t len, callback_t xfer_done) {
+    nrfx_err_t result;
+    if ((uint32_t)len + 1 > APP_SPI_MAX_DMA_LEN) return (int)NRFX_ERROR_INVALID_LENGTH;
+
+    spi_xfer_done = false;
+    spi_xfer_callback = xfer_done;
+
+    xfer_len = len + 1;
+    rx_req = NULL;
+    m_tx_buf[0] = reg;
+
+    nrfx_spim_xfer_desc_t xfer_desc = NRFX_SPIM_XFER_TRX(m_tx_buf, 1, rx, len + 1);
+    result = nrfx_spim_xfer(&spi, &xfer_desc, 0);
+    if (result != NRFX_SUCCESS) return (int)result;
+
+    if (xfer_done) return 0;  // callback supplied; return to caller
+
+    // no callback, block
+    while (!spi_xfer_done) {
+        nrf_pwr_mgmt_run();
+    }
+
+    return 0;
+}
+
+// write register/value pairs, one chip select frame each. the writes follow
+// each other from the SPIM event handler, so a blocking caller waits once for
+// the whole batch. pairs must stay valid until the batch is done.
+// xfer_done callback is called upon completion of the last write.
+// pass null to xfer_done to block.
+int app_spi_write_regs(uint8_t const *pairs, uint8_t n_pairs, callback_t xfer_done) {
+    nrfx_err_t result;
+    if (n_pairs == 0) return 0;
+
+    spi_xfer_done = false;
+    spi_xfer_callback = xfer_done;
+    rx_req = NULL;
+    batch_pairs = &pairs[2];
+    batch_left = n_pairs - 1;
+    batch_result = NRFX_SUCCESS;
+
+    nrfx_spim_xfer_desc_t xfer_desc = NRFX_SPIM_XFER_TX(pairs, 2);
+    result = nrfx_spim_xfer(&spi, &xfer_desc, 0);
+    if (result != NRFX_SUCCESS) {
+        batch_left = 0;
+        return (int)result;
+    }
+
+    if (xfer_done) return 0;  // callback supplied; return to caller
+
+    // no callback, block
+    while (!spi_xfer_done) {
+        nrf_pwr_mgmt_run();
+    }
 
+    return batch_result;
+}
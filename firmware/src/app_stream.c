@@ -0,0 +1,463 @@
+/**
+ * sample stream: the buffered samples and the notifications made from them
+ *
+ * bursts are fetched straight into the send buffer behind the samples still
+ * buffered (stream_fetch_start(), stream_fetch_done()). stream_send() frames
+ * them in the format the central asked for (stream_set_format(),
+ * stream_set_window()) and hands the notifications to the SoftDevice: plain
+ * or Rice coded samples, or the feature or activity records of every
+ * complete window.
+ */
+
+#include "app_stream.h"
+#include "app_debug.h"
+#include "app_ble_nus.h"
+#include "app_energy.h"
+#include "app_features.h"
+#include "app_classifier.h"
+#include "sdk_config.h"
+
+// the FIFO is read straight into the send buffer and packed there, so a
+// burst reaches ble_send() without intermediate copies. samples that do not
+// fill a notification are carried over and packed with the next burst. the
+// headroom in front takes the register and dummy bytes every SPI transfer
+// clocks in ahead of the FIFO data, and the frame header, which is written
+// over already sent bytes in front of a notification.
+// Rice coded notifications are the exception: they are coded into packet_buf,
+// and feature and activity records are queued in record_buf. the buffer
+// layout is in app_stream.h.
+
+static uint8_t send_buf[STREAM_SEND_HEADROOM + STREAM_SEND_BUF_LEN] = { 0 };
+static uint8_t *const accelerometer_data_buf = &send_buf[STREAM_SEND_HEADROOM];
+static uint16_t accelerometer_num_data = 0;
+static uint16_t accelerometer_tx_start = 0;     // first byte not handed to the SoftDevice yet
+static accelerometer_format_t accelerometer_format = ACCELEROMETER_FORMAT_12_BIT;
+static uint8_t accelerometer_sample_len = 6;
+
+static uint8_t packet_buf[FRAME_HEADER_MAX_LEN + NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3];
+static uint8_t frame_requested = FRAME_FORMAT_12_BIT;    // by the central
+static uint8_t frame_format = FRAME_FORMAT_12_BIT;       // of the buffered samples
+
+static bool accelerometer_fetch_pending = false;     // a burst is being read in behind accelerometer_num_data
+
+// where each buffered burst starts, with the sensor time and ODR of its first
+// sample. samples without a mark continue the previous notification's timeline
+#define TIME_MARKS_QUEUE    8
+
+static struct {
+    uint16_t pos;               // byte offset in accelerometer_data_buf
+    uint8_t odr;
+    uint32_t time;
+} time_marks[TIME_MARKS_QUEUE];
+static uint8_t n_time_marks = 0;
+
+// sequence number of the next notification, and whether samples were dropped
+// since the last one (FRAME_FLAG_RESYNC). set at power-on.
+static uint8_t frame_seq = 0;
+static bool frame_resync = true;
+
+// FRAME_FORMAT_FEATURES: every complete window of buffered samples is reduced
+// to a record, queued behind room for the header until the records fill a
+// notification. a record that does not follow the previous one directly
+// starts a new stretch of the timeline and gets a mark.
+// FRAME_FORMAT_ACTIVITY: the windows are classified instead, and a record
+// with a mark of its own is queued and sent right away when the activity
+// changes or a keep-alive is due.
+#define RECORD_QUEUE        16
+
+static uint8_t features_window = FEATURES_WINDOW_DEFAULT;
+static uint8_t record_buf[FRAME_HEADER_MAX_LEN + RECORD_QUEUE * FEATURES_LEN];
+static uint8_t *const records = &record_buf[FRAME_HEADER_MAX_LEN];
+static struct {
+    uint8_t odr;
+    uint32_t time;              // sensor time of the window's first sample
+    bool mark;
+} record_times[RECORD_QUEUE];
+static uint8_t n_records = 0;
+
+// FRAME_FORMAT_ACTIVITY: the activity last sent, and a different one the
+// latest windows were classified as
+static struct {
+    uint8_t activity;           // ACTIVITY_UNKNOWN until the first record
+    uint8_t windows;            // classified since the last record
+    uint8_t candidate;
+    uint8_t n_candidate;        // windows in a row classified as the candidate
+    uint8_t odr;
+    uint32_t time;              // sensor time of the candidate's first window
+} activity_state = { .activity = ACTIVITY_UNKNOWN };
+
+// sensor time of the sample at accelerometer_tx_start, where the next window
+// starts. invalid until the mark in front of the samples is read.
+static struct {
+    bool valid;
+    bool mark;                  // the next record does not continue the last one
+    uint8_t odr;
+    uint32_t time;
+} window_next;
+
+
+// drop the buffered samples and records, the next frame is flagged
+static void buffer_drop(void) {
+    accelerometer_tx_start = accelerometer_num_data = 0;
+    n_time_marks = 0;
+    n_records = 0;
+    window_next.valid = false;
+    activity_state.activity = ACTIVITY_UNKNOWN;
+    activity_state.windows = activity_state.n_candidate = 0;
+    frame_resync = true;
+}
+
+static inline bool format_records(uint8_t format) {
+    return format == FRAME_FORMAT_FEATURES || format == FRAME_FORMAT_ACTIVITY;
+}
+
+static void time_marks_pop(uint8_t n_marks) {
+    n_time_marks -= n_marks;
+    memmove(time_marks, &time_marks[n_marks], n_time_marks * sizeof(time_marks[0]));
+}
+
+// start fetching a burst behind the buffered samples, fetch_done follows. samples left over in the previous FIFO format when the central
+// switched formats cannot share a notification with the new ones and are
+// dropped, as are samples and records when switching to or from records;
+// 12 bit samples carry over between plain and Rice coded frames.
+void stream_fetch_start(callback_t fetch_done) {
+    accelerometer_format_t format = accelerometer_get_format();
+    uint8_t next_format = (format == ACCELEROMETER_FORMAT_12_BIT && frame_requested != FRAME_FORMAT_8_BIT)
+                        ? frame_requested : (uint8_t)format;
+    if (format != accelerometer_format
+        || (next_format != frame_format && (format_records(next_format) || format_records(frame_format)))) {
+        accelerometer_format = format;
+        accelerometer_sample_len = accelerometer_sample_size(format);
+        buffer_drop();
+    }
+    frame_format = next_format;
+
+    // no mark left for this burst -- only if notifications stalled for several
+    // bursts. drop the backlog rather than put samples on the wrong timeline
+    if (n_time_marks == TIME_MARKS_QUEUE) buffer_drop();
+
+    // move what is still unsent to the front -- normally less than one
+    // notification, so the burst gets the whole buffer
+    if (accelerometer_tx_start) {
+        accelerometer_num_data -= accelerometer_tx_start;
+        memmove(accelerometer_data_buf, &accelerometer_data_buf[accelerometer_tx_start], accelerometer_num_data);
+        for (uint8_t i = 0; i < n_time_marks; i++) time_marks[i].pos -= accelerometer_tx_start;
+        accelerometer_tx_start = 0;
+    }
+
+    // fetch accelerometer data -- 1. init spi, 2. fetch data, 3. sleep accel, 4. deinit spi
+    accelerometer_fetch_pending = true;
+    accelerometer_fetch_data(&accelerometer_data_buf[accelerometer_num_data], STREAM_SEND_BUF_LEN - accelerometer_num_data,
+                             true, true, true, fetch_done);
+}
+
+// append the fetched burst. returns the number of samples added.
+uint16_t stream_fetch_done(void) {
+    uint16_t num_data = accelerometer_fetch_len();
+
+    accelerometer_fetch_pending = false;
+    if (num_data) {
+        time_marks[n_time_marks].pos = accelerometer_num_data;
+        time_marks[n_time_marks].odr = accelerometer_fetch_odr();
+        time_marks[n_time_marks].time = accelerometer_fetch_time();
+        n_time_marks++;
+    }
+    accelerometer_num_data += num_data;
+    debug_log("ACCELEROMETER_FETCH_DONE: %d (%d buffered)", num_data, accelerometer_num_data);
+    return num_data / accelerometer_sample_len;
+}
+
+// samples of the next notification in bytes, and the time marks among them
+static uint16_t packet_data_len(uint8_t *p_n_marks) {
+    uint16_t max_len = MIN(ble_get_max_data_len() - FRAME_HEADER_LEN, FRAME_SAMPLES_MAX * accelerometer_sample_len);
+    uint16_t data_len = max_len / accelerometer_sample_len * accelerometer_sample_len;
+    uint8_t n_marks = 0;
+
+    // make room for the marks that fall into the notification, and end it
+    // before a mark that no longer fits into the header
+    while (n_marks < n_time_marks && time_marks[n_marks].pos < accelerometer_tx_start + data_len) {
+        if (n_marks == FRAME_MARKS_MAX) {
+            data_len = time_marks[n_marks].pos - accelerometer_tx_start;
+            break;
+        }
+        n_marks++;
+        data_len = MIN(data_len, (max_len - n_marks * FRAME_MARK_LEN)
+                                 / accelerometer_sample_len * accelerometer_sample_len);
+    }
+    while (n_marks && time_marks[n_marks - 1].pos >= accelerometer_tx_start + data_len) n_marks--;
+
+    *p_n_marks = n_marks;
+    return data_len;
+}
+
+// time marks among the next n_samples samples
+static uint8_t packet_marks(uint16_t n_samples) {
+    uint8_t n_marks = 0;
+    while (n_marks < n_time_marks
+           && time_marks[n_marks].pos < accelerometer_tx_start + n_samples * accelerometer_sample_len) {
+        n_marks++;
+    }
+    return n_marks;
+}
+
+// Rice code the next notification into packet_buf, behind room for the
+// header. returns the number of samples it takes, 0 if the avail_len bytes
+// of buffered samples do not fill it yet.
+static uint8_t packet_rice(uint16_t avail_len, uint8_t *p_n_marks, uint16_t *p_data_len) {
+    uint16_t n_avail = avail_len / accelerometer_sample_len;
+    uint16_t limit = MIN(n_avail, FRAME_SAMPLES_MAX);
+
+    // end the notification before a mark that does not fit into the header
+    uint8_t n_marks = packet_marks(limit);
+    if (n_marks > FRAME_MARKS_MAX) {
+        n_marks = FRAME_MARKS_MAX;
+        limit = (time_marks[FRAME_MARKS_MAX].pos - accelerometer_tx_start) / accelerometer_sample_len;
+    }
+
+    uint16_t space = ble_get_max_data_len() - frame_header_len(n_marks);
+    uint8_t n_samples = frame_rice_encode(&accelerometer_data_buf[accelerometer_tx_start], (uint8_t)limit,
+                                          &packet_buf[FRAME_HEADER_MAX_LEN], space, p_data_len);
+    if (n_samples == n_avail) return 0;
+
+    *p_n_marks = packet_marks(n_samples);
+    return n_samples;
+}
+
+// write the frame header in front of the notification's data at p_data:
+// already sent bytes for plain samples, free room in packet_buf or record_buf
+// otherwise. returns the header length.
+static uint16_t packet_header(frame_t *p_frame, uint8_t *p_data) {
+    p_frame->seq = frame_seq;
+    p_frame->flags = frame_resync ? FRAME_FLAG_RESYNC : 0;
+    p_frame->format = frame_format;
+    return frame_write_header(p_frame, p_data - frame_header_len(p_frame->n_marks));
+}
+
+// the first n_marks time marks, relative to the notification's first sample
+static void packet_sample_marks(frame_t *p_frame, uint8_t n_marks) {
+    p_frame->n_marks = n_marks;
+    for (uint8_t i = 0; i < n_marks; i++) {
+        p_frame->marks[i].index = (uint8_t)((time_marks[i].pos - accelerometer_tx_start) / accelerometer_sample_len);
+        p_frame->marks[i].odr = time_marks[i].odr;
+        p_frame->marks[i].time = time_marks[i].time;
+    }
+}
+
+// a notification was queued
+static void packet_sent(uint16_t n_samples, uint16_t data_len) {
+    energy_note_payload(n_samples, data_len);
+    frame_seq++;
+    frame_resync = false;
+}
+
+static uint8_t send_samples(uint16_t reserved) {
+    uint8_t n_packets = 0;
+    uint8_t n_marks;
+
+    for (;;) {
+        uint16_t buffered = accelerometer_num_data - accelerometer_tx_start;
+        uint16_t avail_len = (buffered > reserved) ? buffered - reserved : 0;
+        uint8_t *p_data = &accelerometer_data_buf[accelerometer_tx_start];
+        uint16_t data_len;
+        uint8_t n_samples;
+
+        if (frame_format == FRAME_FORMAT_12_BIT_RICE) {
+            n_samples = packet_rice(avail_len, &n_marks, &data_len);
+            p_data = &packet_buf[FRAME_HEADER_MAX_LEN];
+        } else {
+            data_len = packet_data_len(&n_marks);
+            n_samples = (data_len <= avail_len) ? data_len / accelerometer_sample_len : 0;
+        }
+        if (n_samples == 0) break;
+
+        frame_t frame = { .n_samples = n_samples };
+        packet_sample_marks(&frame, n_marks);
+        uint16_t header_len = packet_header(&frame, p_data);
+        if (ble_send(p_data - header_len, header_len + data_len) != NRF_SUCCESS) break;
+        packet_sent(n_samples, data_len);
+        accelerometer_tx_start += n_samples * accelerometer_sample_len;
+        time_marks_pop(n_marks);
+        n_packets++;
+    }
+    return n_packets;
+}
+
+// queue the record of the window at window_next: its features, or its
+// activity if that changed or a keep-alive is due
+static void record_put(features_t const *p_features, uint16_t ticks) {
+    if (frame_format == FRAME_FORMAT_FEATURES) {
+        features_encode(p_features, &records[n_records * FEATURES_LEN]);
+        record_times[n_records].odr = window_next.odr;
+        record_times[n_records].time = window_next.time;
+        record_times[n_records].mark = window_next.mark;
+        n_records++;
+        return;
+    }
+
+    uint8_t activity = classifier_run(p_features, ticks);
+    if (activity_state.windows < UINT8_MAX) activity_state.windows++;
+    if (activity == activity_state.activity) {
+        activity_state.n_candidate = 0;
+        if (activity_state.windows < ACTIVITY_KEEPALIVE) return;
+        record_times[n_records].odr = window_next.odr;
+        record_times[n_records].time = window_next.time;
+    } else {
+        if (activity_state.n_candidate == 0 || activity != activity_state.candidate) {
+            activity_state.candidate = activity;
+            activity_state.n_candidate = 0;
+            activity_state.odr = window_next.odr;
+            activity_state.time = window_next.time;
+        }
+        if (++activity_state.n_candidate < ACTIVITY_DEBOUNCE) return;
+        debug_log("activity %d", activity);
+        activity_state.activity = activity;
+        activity_state.n_candidate = 0;
+        record_times[n_records].odr = activity_state.odr;
+        record_times[n_records].time = activity_state.time;
+    }
+
+    activity_record_t record = { features_window, activity, activity_state.windows };
+    activity_encode(&record, &records[n_records * ACTIVITY_LEN]);
+    record_times[n_records].mark = true;
+    n_records++;
+    activity_state.windows = 0;
+}
+
+// reduce every complete window of the buffered samples in front of end to a
+// record. a window does not span a time mark that breaks the timeline (the
+// accelerometer slept in between): the samples in front of that mark are
+// dropped.
+static void features_reduce(uint16_t end) {
+    uint16_t window_len = features_window * accelerometer_sample_len;
+
+    for (;;) {
+        if (n_time_marks && time_marks[0].pos == accelerometer_tx_start) {
+            if (!window_next.valid || time_marks[0].odr != window_next.odr || time_marks[0].time != window_next.time) {
+                window_next.valid = window_next.mark = true;
+                window_next.odr = time_marks[0].odr;
+                window_next.time = time_marks[0].time;
+            }
+            time_marks_pop(1);
+            continue;
+        }
+        if (!window_next.valid) break;
+
+        uint16_t window_end = accelerometer_tx_start + window_len;
+        uint16_t ticks = accelerometer_odr_ticks(window_next.odr);
+        if (n_time_marks && time_marks[0].pos < window_end) {
+            uint16_t n = (time_marks[0].pos - accelerometer_tx_start) / accelerometer_sample_len;
+            if (time_marks[0].odr == window_next.odr
+                && time_marks[0].time == ((window_next.time + (uint32_t)n * ticks) & ACCELEROMETER_TICK_MASK)) {
+                time_marks_pop(1);
+            } else {
+                accelerometer_tx_start = time_marks[0].pos;
+            }
+            continue;
+        }
+        if (window_end > end) break;
+
+        // notifications stalled: drop the queued records
+        if (n_records == RECORD_QUEUE) {
+            n_records = 0;
+            frame_resync = window_next.mark = true;
+        }
+
+        features_t features;
+        features_compute(&accelerometer_data_buf[accelerometer_tx_start], features_window, &features);
+        record_put(&features, ticks);
+
+        window_next.mark = false;
+        window_next.time = (window_next.time + (uint32_t)features_window * ticks) & ACCELEROMETER_TICK_MASK;
+        accelerometer_tx_start = window_end;
+    }
+}
+
+// records of the next notification, ending it before a mark that no longer
+// fits into the header. returns their number, 0 if the queued records do not
+// fill it yet -- activity records go out as soon as there is one.
+static uint8_t packet_records(frame_t *p_frame) {
+    uint16_t max_len = ble_get_max_data_len();
+    uint8_t record_len = frame_sample_len(frame_format);
+    uint8_t n = 0;
+
+    p_frame->n_marks = 0;
+    for (; n < n_records; n++) {
+        uint8_t n_marks = p_frame->n_marks + record_times[n].mark;
+        if (n_marks > FRAME_MARKS_MAX || frame_header_len(n_marks) + (n + 1) * record_len > max_len) break;
+        if (record_times[n].mark) {
+            p_frame->marks[p_frame->n_marks++] = (frame_mark_t){ n, record_times[n].odr, record_times[n].time };
+        }
+    }
+    p_frame->n_samples = n;
+    return (n < n_records || frame_format == FRAME_FORMAT_ACTIVITY) ? n : 0;
+}
+
+static uint8_t send_records(void) {
+    uint8_t record_len = frame_sample_len(frame_format);
+    uint8_t n_packets = 0;
+    frame_t frame;
+
+    while (packet_records(&frame)) {
+        uint16_t data_len = frame.n_samples * record_len;
+        uint16_t header_len = packet_header(&frame, records);
+        if (ble_send(records - header_len, header_len + data_len) != NRF_SUCCESS) break;
+
+        // samples the records stand for: their windows, times the windows
+        // classified for an activity record
+        uint32_t n_samples = 0;
+        for (uint8_t i = 0; i < frame.n_samples; i++) {
+            uint8_t const *p_record = &records[i * record_len];
+            n_samples += p_record[0] * ((frame_format == FRAME_FORMAT_ACTIVITY) ? p_record[2] : 1u);
+        }
+        packet_sent((uint16_t)MIN(n_samples, UINT16_MAX), data_len);
+        n_records -= frame.n_samples;
+        memmove(records, &records[data_len], n_records * record_len);
+        memmove(record_times, &record_times[frame.n_samples], n_records * sizeof(record_times[0]));
+        n_packets++;
+    }
+    return n_packets;
+}
+
+// hand every full notification in the buffer to the SoftDevice queue. stops
+// early if the queue is full (continued on TX_RDY) or notifications are off
+// (continued on COMM_STARTED). returns the number of notifications queued.
+// while a fetch is in flight, the bytes in front of it belong to the SPI
+// framing and wait for the fetch to finish.
+uint8_t stream_send(void) {
+    uint16_t reserved = accelerometer_fetch_pending ? ACCELEROMETER_FETCH_HEADROOM : 0;
+    uint8_t n_packets;
+
+    if (format_records(frame_format)) {
+        features_reduce((accelerometer_num_data > reserved) ? accelerometer_num_data - reserved : 0);
+        n_packets = send_records();
+    } else {
+        n_packets = send_samples(reserved);
+    }
+
+    if (accelerometer_tx_start == accelerometer_num_data && !accelerometer_fetch_pending) {
+        accelerometer_tx_start = accelerometer_num_data = 0;
+    }
+    if (n_packets) energy_note_notifications(n_packets);
+    energy_note_backlog(format_records(frame_format)
+                        ? n_records * features_window
+                        : (accelerometer_num_data - accelerometer_tx_start) / accelerometer_sample_len);
+    return n_packets;
+}
+
+// central commands, applied from the next burst
+
+void stream_set_format(uint8_t format) {
+    if (format > FRAME_FORMAT_ACTIVITY) return;
+    debug_log("sample format %d", format);
+    frame_requested = format;
+    accelerometer_set_format((format == FRAME_FORMAT_8_BIT) ? ACCELEROMETER_FORMAT_8_BIT
+                                                            : ACCELEROMETER_FORMAT_12_BIT);
+    energy_set_window(format_records(format) ? features_window : 0);
+}
+
+void stream_set_window(uint8_t n_samples) {
+    if (!features_window_valid(n_samples)) return;
+    debug_log("feature window %d", n_samples);
+    features_window = n_samples;
+    if (format_records(frame_requested)) energy_set_window(features_window);
+}
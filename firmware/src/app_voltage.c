@@ -7,6 +7,13 @@
 #include "app_debug.h"
 
 #include "nrfx_saadc.h"
+#if V_STORE_LPCOMP_ENABLED
+#include "nrfx_lpcomp.h"
+#endif
+#if V_STORE_SAMP_RING_ENABLED
+#include "nrfx_ppi.h"
+#include "nrf_rtc.h"
+#endif
 #include "nrf_gpio.h"
 #include "nrf_pwr_mgmt.h"
 
@@ -17,39 +24,189 @@ static volatile nrf_saadc_value_t * volatile read_pt = &adc_ping_pong_buffer[0];
 static volatile nrf_saadc_value_t * volatile write_pt = &adc_ping_pong_buffer[1];
 static volatile bool adc_sample_pend = false;
 static volatile uint32_t adc_sample_timestamp_ticks = 0;
-APP_TIMER_DEF(v_samp_timer_id);
+static uint32_t v_samp_period_ms = V_STORE_SAMP_PERIOD_MS;
+static uint32_t v_samp_period_ticks = APP_TIMER_TICKS(V_STORE_SAMP_PERIOD_MS);
+static int32_t wake_level_mv = 0;       // v_store the LPCOMP watches for, 0 when off
+static nrf_saadc_value_t adc_offset = 0;    // left after the SAADC's offset calibration
+static bool div_on = false;
+static bool div_gate_enabled = true;
+static bool div_gated = false;          // divider only on around samples
+static uint32_t div_on_ticks = 0;       // when it was switched on
+static uint32_t next_from_ticks = 0;    // the next sample is reported next_in_ticks after
+static uint32_t next_in_ticks = 0;
+APP_TIMER_DEF(v_samp_timer_id);         // with the ring, only while the divider is gated
+#if V_STORE_SAMP_RING_ENABLED
+#define RING_EMPTY  INT16_MIN          // not a conversion result
+static nrf_saadc_value_t adc_ring[2][VOLTAGE_RING_SAMPLES];     // EasyDMA fills them in turn
+static uint8_t ring_filling = 0;
+static uint32_t ring_evt_mask = 0;
+static int32_t report_mv = 0;           // v_store the LIMIT event reports, 0 when off
+#else
+APP_TIMER_DEF(v_settle_timer_id);
+#endif
 
 // unit conversions -----------------------------------------------------------
 static inline int32_t convert_adc_to_mv(int32_t adc, int32_t v_scale);
+static inline int32_t convert_adc_to_uv(int32_t adc, int32_t v_scale);
 static inline int32_t convert_mv_to_adc(int32_t mv, int32_t v_scale_inv);
 #define SWAP(x, y) do { typeof(x) _s = x; x = y; y = _s; } while (0)
 
 // handlers -------------------------------------------------------------------
 static void saadc_handler(nrfx_saadc_evt_t const *p_event);
 static void v_samp_timer_handler(void *p_context);
+#if !V_STORE_SAMP_RING_ENABLED
+static void v_settle_timer_handler(void *p_context);
+#endif
+#if V_STORE_LPCOMP_ENABLED
+static void lpcomp_handler(nrf_lpcomp_event_t event);
+#endif
 
 static void voltage_saadc_init(void) {
     const nrf_saadc_channel_config_t channel_config = {
         // Vcap max is 5.25V, so we can use gain 1/3 (with internal reference 0.6V):
         // 5.25V / 3 = 1.75V < 0.6V * 3 = 1.8V
         .gain = VOLTAGE_SAADC_GAIN,
-        // Vcap is run through a voltage divider so RC is very large
-        // This value may need to be increased
+        // Vcap is run through a voltage divider so RC is very large, but C20
+        // holds the charge the acquisition takes once the divider has settled
         .acq_time = VOLTAGE_SAADC_ACQ_TIME,
         .pin_p = GPIO_V_STORE_DIV_IN,
         .resistor_p = NRF_SAADC_RESISTOR_DISABLED,  .resistor_n = NRF_SAADC_RESISTOR_DISABLED,
         .reference = NRF_SAADC_REFERENCE_INTERNAL,  .mode = NRF_SAADC_MODE_SINGLE_ENDED,
-        .burst = NRF_SAADC_BURST_DISABLED,          .pin_n = NRF_SAADC_INPUT_DISABLED
+        // one SAMPLE task runs all the conversions oversampling averages
+        .burst = VOLTAGE_SAADC_OVERSAMPLE ? NRF_SAADC_BURST_ENABLED : NRF_SAADC_BURST_DISABLED,
+        .pin_n = NRF_SAADC_INPUT_DISABLED
     };
-    const nrfx_saadc_config_t saadc_config = NRFX_SAADC_DEFAULT_CONFIG;
+    nrfx_saadc_config_t saadc_config = NRFX_SAADC_DEFAULT_CONFIG;
+    saadc_config.resolution = CONCAT_3(NRF_SAADC_RESOLUTION_, VOLTAGE_SAADC_RESOLUTION, BIT);
+    saadc_config.oversample = (nrf_saadc_oversample_t)VOLTAGE_SAADC_OVERSAMPLE;
+#if V_STORE_SAMP_RING_ENABLED
+    saadc_config.low_power_mode = false;    // started once, SAMPLE comes through PPI
+#endif
 
     nrfx_saadc_init(&saadc_config, saadc_handler);
     nrfx_saadc_channel_init(0, &channel_config);
 }
 
-static bool voltage_trig_sample(void) {
+// once, with the SAADC initialized and idle: the SAADC's own offset
+// calibration, then the offset it leaves, read off the divider output while
+// that is switched off and C20 has discharged through R2 since power-on
+static void voltage_saadc_calibrate(void) {
+    nrf_saadc_value_t zero = 0;
+
+    if (nrfx_saadc_calibrate_offset() == NRFX_SUCCESS) {
+        while (nrfx_saadc_is_busy()) nrf_pwr_mgmt_run();
+    }
+    if (nrfx_saadc_sample_convert(0, &zero) != NRFX_SUCCESS) return;
+
+    // anything larger is not the offset: the divider did not discharge
+    if (zero >= -VOLTAGE_SAADC_OFFSET_MAX && zero <= VOLTAGE_SAADC_OFFSET_MAX) adc_offset = zero;
+}
+
+// the next sample is reported in_ticks from now
+static inline void voltage_next_sample_in(uint32_t in_ticks) {
+    next_from_ticks = app_timer_cnt_get();
+    next_in_ticks = in_ticks;
+}
+
+// ticks until the next sample is reported, 0 if it is due
+static uint32_t voltage_next_sample_ticks(void) {
+    uint32_t elapsed_ticks = app_timer_cnt_diff_compute(app_timer_cnt_get(), next_from_ticks);
+    return (elapsed_ticks < next_in_ticks) ? next_in_ticks - elapsed_ticks : 0;
+}
+
+#if V_STORE_SAMP_RING_ENABLED
+// conversions the ring being filled still takes
+static uint8_t voltage_ring_free(void) {
+    nrf_saadc_value_t const *p_ring = adc_ring[ring_filling];
+    uint8_t n = 0;
+    while (n < VOLTAGE_RING_SAMPLES && p_ring[n] != RING_EMPTY) n++;
+    return VOLTAGE_RING_SAMPLES - n;
+}
+
+// n_samples compares on the free RTC1 channels, first_ticks from now and
+// step_ticks apart: what the ring still takes (voltage_ring_free()), so it
+// fills with the last one. a full ring is about to be handed over, its
+// successor starts with the first compare
+static void voltage_ring_arm(uint32_t first_ticks, uint32_t step_ticks, uint8_t n_samples) {
+    uint32_t now_ticks = nrf_rtc_counter_get(NRF_RTC1);
+    uint32_t evt_mask = 0;
+    n_samples = MAX(n_samples, 1);
+    nrf_rtc_event_disable(NRF_RTC1, ring_evt_mask);
+    for (uint8_t i = 0; i < n_samples; i++) {
+        uint32_t cc_ticks = (now_ticks + first_ticks + i * step_ticks) & NRF_RTC_COUNTER_MAX;
+        nrf_rtc_event_clear(NRF_RTC1, NRF_RTC_CHANNEL_EVENT_ADDR(VOLTAGE_RING_CC_FIRST + i));
+        nrf_rtc_cc_set(NRF_RTC1, VOLTAGE_RING_CC_FIRST + i, cc_ticks);
+        evt_mask |= NRF_RTC_CHANNEL_INT_MASK(VOLTAGE_RING_CC_FIRST + i);
+    }
+    // events only, the interrupt stays with app_timer
+    nrf_rtc_event_enable(NRF_RTC1, evt_mask);
+    voltage_next_sample_in(first_ticks + (n_samples - 1) * step_ticks);
+}
+
+// no samples until the next voltage_ring_arm(): compares left over would
+// sample the divider switched off
+static inline void voltage_ring_disarm(void) {
+    nrf_rtc_event_disable(NRF_RTC1, ring_evt_mask);
+}
+
+static bool voltage_ring_init(void) {
     nrfx_err_t err = NRFX_SUCCESS;
-    adc_sample_pend = true;
+
+    for (uint8_t i = 0; i < VOLTAGE_RING_SAMPLES; i++) {
+        adc_ring[0][i] = adc_ring[1][i] = RING_EMPTY;
+    }
+
+    err |= nrfx_saadc_buffer_convert(adc_ring[0], VOLTAGE_RING_SAMPLES);
+    err |= nrfx_saadc_buffer_convert(adc_ring[1], VOLTAGE_RING_SAMPLES);
+
+    for (uint8_t i = 0; i < VOLTAGE_RING_SAMPLES; i++) {
+        uint8_t cc = VOLTAGE_RING_CC_FIRST + i;
+        nrf_ppi_channel_t ppi_channel;
+        err |= nrfx_ppi_channel_alloc(&ppi_channel);
+        err |= nrfx_ppi_channel_assign(ppi_channel,
+                    nrf_rtc_event_address_get(NRF_RTC1, NRF_RTC_CHANNEL_EVENT_ADDR(cc)),
+                    nrfx_saadc_sample_task_get());
+        err |= nrfx_ppi_channel_enable(ppi_channel);
+        ring_evt_mask |= NRF_RTC_CHANNEL_INT_MASK(cc);
+    }
+
+    return (err == NRFX_SUCCESS);
+}
+#endif
+
+// PMOS from capacitors to voltage divider, enabled low
+static void voltage_divider_set(bool on) {
+    if (on == div_on) return;
+    div_on = on;
+    if (on) {
+        div_on_ticks = app_timer_cnt_get();
+        nrf_gpio_pin_clear(GPIO_DIV_EN);
+    } else {
+        nrf_gpio_pin_set(GPIO_DIV_EN);
+    }
+}
+
+// ticks until the divider output has settled, 0 if it has
+static uint32_t voltage_divider_settle_ticks(void) {
+    const uint32_t settle_ticks = APP_TIMER_TICKS(CEIL_DIV(VOLTAGE_DIV_SETTLE_US, 1000));
+    uint32_t on_ticks = app_timer_cnt_diff_compute(app_timer_cnt_get(), div_on_ticks);
+    return (on_ticks < settle_ticks) ? settle_ticks - on_ticks : 0;
+}
+
+// convert delay_ticks from now, 0 for right away
+static bool voltage_convert(uint32_t delay_ticks) {
+#if V_STORE_SAMP_RING_ENABLED
+    // fill the rest of the ring, at the nearest compares the RTC is sure to
+    // match
+    voltage_ring_arm(MAX(delay_ticks, 2), 1, voltage_ring_free());
+    return true;
+#else
+    nrfx_err_t err = NRFX_SUCCESS;
+
+    voltage_next_sample_in(delay_ticks);
+    if (delay_ticks) {
+        return (app_timer_start(v_settle_timer_id, delay_ticks, NULL) == NRF_SUCCESS);
+    }
     
     voltage_saadc_init();
 
@@ -57,6 +214,49 @@ static bool voltage_trig_sample(void) {
     err |= nrfx_saadc_sample();
 
     return (err == NRFX_SUCCESS);
+#endif
+}
+
+static bool voltage_trig_sample(void) {
+    adc_sample_pend = true;
+    voltage_divider_set(true);
+    return voltage_convert(voltage_divider_settle_ticks());
+}
+
+static inline bool voltage_div_gate(void) {
+    return div_gate_enabled && voltage_divider_gated(v_samp_period_ms, wake_level_mv != 0);
+}
+
+// one sample v_samp_period_ticks from now: the timer fires ahead of it by
+// the time a divider switched off takes to settle
+static void voltage_samp_timer_start(void) {
+    uint32_t settle_ticks = div_on ? 0 : APP_TIMER_TICKS(CEIL_DIV(VOLTAGE_DIV_SETTLE_US, 1000));
+    uint32_t timeout_ticks = (v_samp_period_ticks > settle_ticks) ? v_samp_period_ticks - settle_ticks : 0;
+    timeout_ticks = MAX(timeout_ticks, APP_TIMER_MIN_TIMEOUT_TICKS);
+
+    app_timer_stop(v_samp_timer_id);
+    app_timer_start(v_samp_timer_id, timeout_ticks, NULL);
+    voltage_next_sample_in(timeout_ticks + settle_ticks);
+}
+
+// sample every v_samp_period_ticks from now on, the divider on throughout
+// or only around each sample. a pending sample schedules the next when done
+static void voltage_sampling_restart(void) {
+    div_gated = voltage_div_gate();
+    if (!div_gated) voltage_divider_set(true);
+    else if (!adc_sample_pend) voltage_divider_set(false);
+
+    app_timer_stop(v_samp_timer_id);
+    if (adc_sample_pend) return;
+#if V_STORE_SAMP_RING_ENABLED
+    if (!div_gated) {
+        voltage_ring_arm(MAX(v_samp_period_ticks, voltage_divider_settle_ticks()), v_samp_period_ticks,
+                         voltage_ring_free());
+        return;
+    }
+    voltage_ring_disarm();
+#endif
+    voltage_samp_timer_start();
 }
 
 void voltage_init(void) {
@@ -65,43 +265,72 @@ void voltage_init(void) {
     ret_code_t err_code = 0;
 
     if (initial_init) {
-        // enable PMOS from capacitors to voltage divider
+        nrf_gpio_pin_set(GPIO_DIV_EN);
         nrf_gpio_cfg_output(GPIO_DIV_EN);
-        nrf_gpio_pin_clear(GPIO_DIV_EN);
 
         // timer config
         err_code |= app_timer_create(&v_samp_timer_id,
-                                    APP_TIMER_MODE_REPEATED,
+                                    APP_TIMER_MODE_SINGLE_SHOT,
                                     v_samp_timer_handler);
+
+        voltage_saadc_init();
+        voltage_saadc_calibrate();
+#if V_STORE_SAMP_RING_ENABLED
+        voltage_ring_init();
+#else
+        nrfx_saadc_uninit();
+        err_code |= app_timer_create(&v_settle_timer_id,
+                                    APP_TIMER_MODE_SINGLE_SHOT,
+                                    v_settle_timer_handler);
+#endif
         initial_init = false;
+
+        // a first sample once the divider has settled
+        voltage_trig_sample();
+#if !V_STORE_SAMP_RING_ENABLED
+    } else if (adc_sample_pend) {
+        // app_timer_init() dropped the settle timer
+        voltage_convert(voltage_divider_settle_ticks());
+#endif
     }
 
-    err_code |= app_timer_start(v_samp_timer_id,
-                                APP_TIMER_TICKS(V_STORE_SAMP_PERIOD_MS), 
-                                NULL);
+    voltage_sampling_restart();
 }
 
-voltage_ret_t voltage_force_sample(uint32_t staleness_ticks, uint32_t wait_ticks, uint32_t *age) {
+void voltage_set_sample_period(uint32_t period_ms) {
+    uint32_t period_ticks = APP_TIMER_TICKS(period_ms);
+    if (period_ticks == v_samp_period_ticks) return;
 
-    voltage_ret_t ret;
-    static const uint32_t pd_ticks = APP_TIMER_TICKS(V_STORE_SAMP_PERIOD_MS);
-    uint32_t sample_age = voltage_get_measurement_age_ticks();
+    v_samp_period_ms = period_ms;
+    v_samp_period_ticks = period_ticks;
+    voltage_sampling_restart();
+}
 
-    if (sample_age < staleness_ticks) {
-        // sample is still relatively fresh
-        *age = sample_age;
+// make sure of a sample no older than staleness_ticks: the last one if it
+// is, otherwise the next one if it is reported within wait_ticks (or is
+// already being taken), otherwise one triggered now. the sample arrives
+// through the NRFX_SAADC_EVT_DONE callback as usual
+voltage_ret_t voltage_request_sample(uint32_t staleness_ticks, uint32_t wait_ticks) {
+    if (voltage_get_measurement_age_ticks() < staleness_ticks) {
         return VOLTAGE_RET_PREV_SAMPLE;
-    } else if ((sample_age + wait_ticks) >= pd_ticks) {
-        // wait for new sample to be triggered via app timer
-        ret = VOLTAGE_RET_WAITED_FOR_SAMPLE;
-    } else {
-        // manually trigger sample
-        voltage_trig_sample();
-        ret = VOLTAGE_RET_FRESH_SAMPLE;
+    }
+    if (adc_sample_pend || voltage_next_sample_ticks() <= wait_ticks) {
+        return VOLTAGE_RET_WAITED_FOR_SAMPLE;
     }
 
-    // wait for sample to be valid
-    while (adc_sample_pend) nrf_pwr_mgmt_run();
+    app_timer_stop(v_samp_timer_id);    // the sample done schedules the next
+    voltage_trig_sample();
+    return VOLTAGE_RET_FRESH_SAMPLE;
+}
+
+// voltage_request_sample(), then wait for the sample
+voltage_ret_t voltage_force_sample(uint32_t staleness_ticks, uint32_t wait_ticks, uint32_t *age) {
+    uint32_t timestamp_ticks = adc_sample_timestamp_ticks;
+    voltage_ret_t ret = voltage_request_sample(staleness_ticks, wait_ticks);
+
+    if (ret != VOLTAGE_RET_PREV_SAMPLE) {
+        while (adc_sample_pend || adc_sample_timestamp_ticks == timestamp_ticks) nrf_pwr_mgmt_run();
+    }
 
     *age = voltage_get_measurement_age_ticks();
     return ret;
@@ -111,6 +340,11 @@ int32_t voltage_read_v_store(void) {
     return convert_adc_to_mv(*read_pt, V_STORE_DIV_INV);
 }
 
+// the same sample in uV, for energy estimates finer than its mV
+int32_t voltage_read_v_store_uv(void) {
+    return convert_adc_to_uv(*read_pt, V_STORE_DIV_INV);
+}
+
 void voltage_wait_for_v_store_thresh(int32_t thresh_mv) {
     int32_t thresh_adc = convert_mv_to_adc(thresh_mv, V_STORE_DIV_INV);
     while (adc_sample_pend) nrf_pwr_mgmt_run(); // wait for any valid sample
@@ -126,18 +360,116 @@ uint32_t voltage_get_measurement_age_ticks() {
             adc_sample_timestamp_ticks);
 }
 
+// LPCOMP wake-up --------------------------------------------------------------
+
+// v_store the LPCOMP trips at with a reference of n/16 of the regulated VDD
+static inline int32_t lpcomp_level_mv(uint8_t sixteenths) {
+    return VOLTAGE_LPCOMP_VDD_MV * sixteenths * V_STORE_DIV_INV / 16;
+}
+
+// highest level the LPCOMP can wait for at or below max_mv, 0 if there is none
+int32_t voltage_wake_level_mv(int32_t max_mv) {
+#if V_STORE_LPCOMP_ENABLED
+    for (uint8_t n = VOLTAGE_LPCOMP_MAX_16THS; n >= VOLTAGE_LPCOMP_MIN_16THS; n--) {
+        if (lpcomp_level_mv(n) <= max_mv) return lpcomp_level_mv(n);
+    }
+#endif
+    return 0;
+}
+
+// sample v_store as soon as it rises past level_mv, one of the
+// voltage_wake_level_mv() levels, 0 to stop watching. the crossing has to
+// be ahead: the LPCOMP only reports edges. false if the LPCOMP is not
+// available -- keep polling then.
+bool voltage_wake_above(int32_t level_mv) {
+#if V_STORE_LPCOMP_ENABLED
+    static const nrf_lpcomp_ref_t refs[] = {    // from VOLTAGE_LPCOMP_MIN_16THS
+        NRF_LPCOMP_REF_SUPPLY_3_8,  NRF_LPCOMP_REF_SUPPLY_7_16, NRF_LPCOMP_REF_SUPPLY_4_8,
+        NRF_LPCOMP_REF_SUPPLY_9_16, NRF_LPCOMP_REF_SUPPLY_5_8,  NRF_LPCOMP_REF_SUPPLY_11_16,
+    };
+
+    if (level_mv == wake_level_mv) return true;
+    if (wake_level_mv) nrfx_lpcomp_uninit();
+    wake_level_mv = 0;
+    if (level_mv == 0) {
+        if (voltage_div_gate() != div_gated) voltage_sampling_restart();
+        return true;
+    }
+
+    uint8_t n = VOLTAGE_LPCOMP_MIN_16THS;
+    while (n < VOLTAGE_LPCOMP_MAX_16THS && lpcomp_level_mv(n) != level_mv) n++;
+    if (lpcomp_level_mv(n) != level_mv) return false;
+
+    const nrfx_lpcomp_config_t config = {
+        .hal = {
+            .reference = refs[n - VOLTAGE_LPCOMP_MIN_16THS],
+            .detection = NRF_LPCOMP_DETECT_UP,
+            .hyst = NRF_LPCOMP_HYST_NOHYST,
+        },
+        .input = GPIO_V_STORE_LPCOMP_IN,
+        .interrupt_priority = LPCOMP_CONFIG_IRQ_PRIORITY,
+    };
+    if (nrfx_lpcomp_init(&config, lpcomp_handler) != NRFX_SUCCESS) return false;
+    wake_level_mv = level_mv;
+    if (div_gated) voltage_sampling_restart();     // the LPCOMP needs the divider on
+    nrfx_lpcomp_enable();
+    return true;
+#else
+    return level_mv == 0;
+#endif
+}
+
+// report a sample as soon as it reaches thresh_mv rather than with the rest
+// of its ring, 0 for none. without the ring every sample is reported anyway
+void voltage_report_above(int32_t thresh_mv) {
+#if V_STORE_SAMP_RING_ENABLED
+    if (thresh_mv == report_mv) return;
+    report_mv = thresh_mv;
+
+    int16_t limit_adc = NRFX_SAADC_LIMITH_DISABLED;
+    if (thresh_mv) {
+        // lowest reading at or above thresh_mv
+        limit_adc = convert_mv_to_adc(thresh_mv, V_STORE_DIV_INV);
+        if (convert_adc_to_mv(limit_adc, V_STORE_DIV_INV) < thresh_mv) limit_adc++;
+        if (limit_adc == NRFX_SAADC_LIMITH_DISABLED) limit_adc++;   // 12 bit readings reach it
+    }
+    nrfx_saadc_limits_set(0, NRFX_SAADC_LIMITL_DISABLED, limit_adc);
+#endif
+}
+
+// whether sampling every period_ms switches the divider off in between. the
+// LPCOMP watching v_store needs it on
+bool voltage_divider_gated(uint32_t period_ms, bool lpcomp) {
+    return !lpcomp && period_ms >= VOLTAGE_DIV_GATE_MIN_MS;
+}
+
+// false keeps the divider on whatever the period: a sample is then never
+// held up by it settling
+void voltage_divider_gating(bool enable) {
+    div_gate_enabled = enable;
+    if (voltage_div_gate() != div_gated) voltage_sampling_restart();
+}
+
 // unit conversions -----------------------------------------------------------
 
+// readings include adc_offset, anything below it is noise around 0V
 static inline int32_t convert_adc_to_mv(int32_t adc, int32_t v_scale) {
     const int32_t adc_full_range = (1 << VOLTAGE_SAADC_RESOLUTION) - 1;
     const int32_t adc_range_scaler = VOLTAGE_SAADC_REF_MV * VOLTAGE_SAADC_GAIN_INVERSE;
-    return ROUNDED_DIV(adc * adc_range_scaler * v_scale, adc_full_range);
+    return ROUNDED_DIV(MAX(adc - adc_offset, 0) * adc_range_scaler * v_scale, adc_full_range);
+}
+
+static inline int32_t convert_adc_to_uv(int32_t adc, int32_t v_scale) {
+    const int64_t adc_full_range = (1 << VOLTAGE_SAADC_RESOLUTION) - 1;
+    const int64_t adc_range_scaler = VOLTAGE_SAADC_REF_MV * VOLTAGE_SAADC_GAIN_INVERSE * 1000;
+    int64_t uv = MAX(adc - adc_offset, 0) * adc_range_scaler * v_scale;
+    return (int32_t)((uv + adc_full_range / 2) / adc_full_range);
 }
 
 static inline int32_t convert_mv_to_adc(int32_t mv, int32_t v_scale_inv) {
     const int32_t adc_full_range = (1 << VOLTAGE_SAADC_RESOLUTION) - 1;
     const int32_t adc_range_scaler = VOLTAGE_SAADC_REF_MV * VOLTAGE_SAADC_GAIN_INVERSE;
-    return ROUNDED_DIV(mv * adc_full_range, adc_range_scaler * v_scale_inv);
+    return ROUNDED_DIV(mv * adc_full_range, adc_range_scaler * v_scale_inv) + adc_offset;
 }
 
 // handlers -------------------------------------------------------------------
@@ -145,8 +477,37 @@ static inline int32_t convert_mv_to_adc(int32_t mv, int32_t v_scale_inv) {
 WEAK_CALLBACK_DEF(NRFX_SAADC_EVT_DONE)
 
 static void saadc_handler(nrfx_saadc_evt_t const *p_event) {
+#if V_STORE_SAMP_RING_ENABLED
+    if (p_event->type == NRFX_SAADC_EVT_LIMIT) {
+        // v_store reached the level: report the sample that did, the latest
+        // in the ring. if it completed the ring, it has been reported already
+        uint8_t n = VOLTAGE_RING_SAMPLES - voltage_ring_free();
+        voltage_report_above(0);
+        if (n == 0) return;
+        *write_pt = adc_ring[ring_filling][n - 1];
+    } else if (p_event->type == NRFX_SAADC_EVT_DONE) {
+        // hand the buffer back emptied, the SAADC fills the other one meanwhile
+        nrf_saadc_value_t *p_ring = p_event->data.done.p_buffer;
+        *write_pt = p_ring[VOLTAGE_RING_SAMPLES - 1];
+        for (uint8_t i = 0; i < VOLTAGE_RING_SAMPLES; i++) p_ring[i] = RING_EMPTY;
+        ring_filling = (p_ring == adc_ring[0]);
+        nrfx_saadc_buffer_convert(p_ring, VOLTAGE_RING_SAMPLES);
+        if (div_gated) {
+            voltage_ring_disarm();
+            voltage_divider_set(false);
+            voltage_samp_timer_start();
+        } else {
+            voltage_ring_arm(v_samp_period_ticks, v_samp_period_ticks, voltage_ring_free());
+        }
+    } else {
+        return;
+    }
+#else
     if (p_event->type != NRFX_SAADC_EVT_DONE) return;
     nrfx_saadc_uninit();
+    if (div_gated) voltage_divider_set(false);
+    voltage_samp_timer_start();
+#endif
 
     adc_sample_timestamp_ticks = app_timer_cnt_get();
     adc_sample_pend = false;    // address any waits on a sample
@@ -158,6 +519,22 @@ static void saadc_handler(nrfx_saadc_evt_t const *p_event) {
 }
 
 static void v_samp_timer_handler(void *p_context) {
-    voltage_trig_sample();
+    if (!adc_sample_pend) voltage_trig_sample();
+}
+
+#if !V_STORE_SAMP_RING_ENABLED
+static void v_settle_timer_handler(void *p_context) {
+    voltage_convert(0);
+}
+#endif
+
+#if V_STORE_LPCOMP_ENABLED
+// v_store rose past the level -- take the exact value, while the divider is
+// still on
+static void lpcomp_handler(nrf_lpcomp_event_t event) {
+    if (event != NRF_LPCOMP_EVENT_UP) return;
+    if (!adc_sample_pend) voltage_trig_sample();
+    voltage_wake_above(0);
 }
+#endif
 